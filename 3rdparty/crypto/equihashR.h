@@ -42,6 +42,8 @@ void CompressArray(const unsigned char* in, size_t in_len,
                    size_t bit_len, size_t byte_pad=0);
 
 eh_index ArrayToEhIndex(const unsigned char* array);
+void GenerateHash(const eh_HashState& base_state, eh_index g,
+                  unsigned char* hash, size_t hLen, size_t N, size_t R);
 eh_trunc TruncateIndex(const eh_index i, const unsigned int ilen);
 
 std::vector<eh_index> GetIndicesFromMinimal(std::vector<unsigned char> minimal,
@@ -220,7 +222,13 @@ bool IsValidBranch(const FullStepRow<WIDTH>& a, const size_t len, const unsigned
 class PoWScheme {
 public:
     virtual int InitialiseState(eh_HashState& base_state) = 0;
-    virtual bool IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln) = 0;	
+    virtual bool IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln) = 0;
+
+    // The verification in phases, so that the hashes for several solutions can be generated together.
+    // DecodeIndices expands the minimal representation into (1 << K) indices, and checks their range.
+    // IsValidCollisions verifies the solution given the GenerateHash() output of each index group, HashOutput bytes per index.
+    virtual bool DecodeIndices(const unsigned char* soln, size_t solnLen, eh_index* pIndices) = 0;
+    virtual bool IsValidCollisions(const eh_index* pIndices, unsigned char* pHashes) = 0;
 
 #ifdef ENABLE_MINING
     virtual bool OptimisedSolve(const eh_HashState& base_state,
@@ -254,7 +262,9 @@ public:
     EquihashR() { }
 
     int InitialiseState(eh_HashState& base_state);
-    bool IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+    bool IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
+    bool DecodeIndices(const unsigned char* soln, size_t solnLen, eh_index* pIndices);
+    bool IsValidCollisions(const eh_index* pIndices, unsigned char* pHashes);
 #ifdef ENABLE_MINING
     bool OptimisedSolve(const eh_HashState& base_state,
                         const std::function<bool(const std::vector<unsigned char>&)> validBlock,
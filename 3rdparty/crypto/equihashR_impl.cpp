@@ -644,28 +644,66 @@ invalidsolution:
 #endif // ENABLE_MINING
 
 template<unsigned int N, unsigned int K, unsigned int R>
-bool EquihashR<N,K,R>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln)
+bool EquihashR<N,K,R>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln)
 {
-    if (soln.size() != SolutionWidth) {
+    eh_index indices[1 << K];
+    if (!DecodeIndices(soln.data(), soln.size(), indices)) {
         return false;
     }
 
-    std::vector<FullStepRow<FinalFullWidth>> X;
-    X.reserve(1 << K);
-    unsigned char tmpHash[HashOutput];
-    for (eh_index i : GetIndicesFromMinimal(soln, CollisionBitLength)) {
-	if (i >= (1U << (CollisionBitLength + 1 - R))) {
+    unsigned char hashes[(1 << K) * HashOutput];
+    for (size_t i = 0; i < (1 << K); i++) {
+        GenerateHash(base_state, indices[i]/IndicesPerHashOutput, hashes + i*HashOutput, HashOutput, N, R);
+    }
+
+    return IsValidCollisions(indices, hashes);
+}
+
+template<unsigned int N, unsigned int K, unsigned int R>
+bool EquihashR<N,K,R>::DecodeIndices(const unsigned char* soln, size_t solnLen, eh_index* pIndices)
+{
+    if (solnLen != SolutionWidth) {
+        return false;
+    }
+
+    const size_t cBitLen = CollisionBitLength;
+    static_assert(((cBitLen+1)+7)/8 <= sizeof(eh_index));
+    const size_t lenIndices = sizeof(eh_index) * (1 << K);
+    const size_t bytePad = sizeof(eh_index) - ((cBitLen+1)+7)/8;
+
+    unsigned char array[lenIndices];
+    ExpandArray(soln, solnLen, array, lenIndices, cBitLen+1, bytePad);
+
+    for (size_t i = 0; i < (1 << K); i++) {
+        pIndices[i] = ArrayToEhIndex(array + i*sizeof(eh_index));
+        if (pIndices[i] >= (1U << (CollisionBitLength + 1 - R))) {
             return false;
-	}
-        GenerateHash(base_state, i/IndicesPerHashOutput, tmpHash, HashOutput, N, R);
-        X.emplace_back(tmpHash+((i % IndicesPerHashOutput) * GetSizeInBytes(N)),
+        }
+    }
+
+    return true;
+}
+
+template<unsigned int N, unsigned int K, unsigned int R>
+bool EquihashR<N,K,R>::IsValidCollisions(const eh_index* pIndices, unsigned char* pHashes)
+{
+    std::vector<FullStepRow<FinalFullWidth>> X, Xc;
+    X.reserve(1 << K);
+    Xc.reserve(1 << (K-1));
+
+    for (size_t j = 0; j < (1 << K); j++) {
+        eh_index i = pIndices[j];
+        unsigned char* pHash = pHashes + j*HashOutput;
+        ZeroizeUnusedBits(N, R, pHash, HashOutput);
+
+        X.emplace_back(pHash+((i % IndicesPerHashOutput) * GetSizeInBytes(N)),
                        GetSizeInBytes(N), HashLength, CollisionBitLength, i);
     }
 
     size_t hashLen = HashLength;
     size_t lenIndices = sizeof(eh_index);
     while (X.size() > 1) {
-        std::vector<FullStepRow<FinalFullWidth>> Xc;
+        Xc.clear();
         for (size_t i = 0; i < X.size(); i += 2) {
             if (!HasCollision(X[i], X[i+1], CollisionByteLength)) { 
                 return false;
@@ -678,7 +716,7 @@ bool EquihashR<N,K,R>::IsValidSolution(const eh_HashState& base_state, std::vect
             }
             Xc.emplace_back(X[i], X[i+1], hashLen, lenIndices, CollisionByteLength);
         }
-        X = Xc;
+        X.swap(Xc);
         hashLen -= CollisionByteLength;
         lenIndices *= 2;
     }
@@ -689,7 +727,9 @@ bool EquihashR<N,K,R>::IsValidSolution(const eh_HashState& base_state, std::vect
 
 // Explicit instantiations for BeamHashI
 template int EquihashR<150,5,0>::InitialiseState(eh_HashState& base_state);
-template bool EquihashR<150,5,0>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool EquihashR<150,5,0>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
+template bool EquihashR<150,5,0>::DecodeIndices(const unsigned char* soln, size_t solnLen, eh_index* pIndices);
+template bool EquihashR<150,5,0>::IsValidCollisions(const eh_index* pIndices, unsigned char* pHashes);
 #ifdef ENABLE_MINING
 template bool EquihashR<150,5,0>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(const std::vector<unsigned char>&)> validBlock,
@@ -699,7 +739,9 @@ template bool EquihashR<150,5,0>::OptimisedSolve(const eh_HashState& base_state,
 
 // Explicit instantiations for BeamHashII
 template int EquihashR<150,5,3>::InitialiseState(eh_HashState& base_state);
-template bool EquihashR<150,5,3>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool EquihashR<150,5,3>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
+template bool EquihashR<150,5,3>::DecodeIndices(const unsigned char* soln, size_t solnLen, eh_index* pIndices);
+template bool EquihashR<150,5,3>::IsValidCollisions(const eh_index* pIndices, unsigned char* pHashes);
 #ifdef ENABLE_MINING
 template bool EquihashR<150,5,3>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(const std::vector<unsigned char>&)> validBlock,
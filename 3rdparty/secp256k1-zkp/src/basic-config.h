@@ -21,12 +21,23 @@
 #undef USE_SCALAR_8X32
 #undef USE_SCALAR_INV_BUILTIN
 #undef USE_SCALAR_INV_NUM
+#undef HAVE___INT128
 
 #define USE_NUM_NONE 1
 #define USE_FIELD_INV_BUILTIN 1
 #define USE_SCALAR_INV_BUILTIN 1
+
+#ifdef BEAM_SECP256K1_64BIT // must match the secp256k1 library build
+#define HAVE___INT128 1
+#define USE_FIELD_5X52 1
+#define USE_SCALAR_4X64 1
+#ifdef BEAM_SECP256K1_ASM
+#define USE_ASM_X86_64 1
+#endif
+#else // BEAM_SECP256K1_64BIT
 #define USE_FIELD_10X26 1
 #define USE_SCALAR_8X32 1
+#endif // BEAM_SECP256K1_64BIT
 
 #endif // USE_BASIC_CONFIG
 #endif // _SECP256K1_BASIC_CONFIG_
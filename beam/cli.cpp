@@ -130,7 +130,14 @@ private:
             s.m_Done >>= 1;
         }
         int p = static_cast<int>((s.m_Done * 100) / s.m_Total);
-        LOG_INFO() << "Updating node: " << p << "% (" << s.m_Done << "/" << s.m_Total << ")";
+        if (s.m_HdrsPerSec)
+        {
+            LOG_INFO() << "Updating node: " << p << "% (" << s.m_Done << "/" << s.m_Total << "), " << s.m_HdrsPerSec << " hdrs/sec";
+        }
+        else
+        {
+            LOG_INFO() << "Updating node: " << p << "% (" << s.m_Done << "/" << s.m_Total << ")";
+        }
     }
 
     Node* m_pNode;
@@ -236,6 +243,7 @@ int main_impl(int argc, char* argv[])
 					node.m_Cfg.m_sPathLocal = vm[cli::STORAGE].as<string>();
 					node.m_Cfg.m_MiningThreads = 0; // by default disabled
 					node.m_Cfg.m_VerificationThreads = vm[cli::VERIFICATION_THREADS].as<int>();
+					node.m_Cfg.m_IoThreads = vm[cli::IO_THREADS].as<uint32_t>();
 
 					node.m_Cfg.m_LogEvents = vm[cli::LOG_UTXOS].as<bool>();
 
@@ -322,6 +330,18 @@ int main_impl(int argc, char* argv[])
 					if (vm.count(cli::VACUUM))
 						node.m_Cfg.m_ProcessorParams.m_Vacuum = vm[cli::VACUUM].as<bool>();
 
+					if (vm.count(cli::VACUUM_ONLINE_PAGES))
+						node.m_Cfg.m_Vacuum.m_PagesPerStep = vm[cli::VACUUM_ONLINE_PAGES].as<uint32_t>();
+
+					if (vm.count(cli::UTXO_HUGE_PAGES))
+						node.m_Cfg.m_ProcessorParams.m_UtxoHugePages = vm[cli::UTXO_HUGE_PAGES].as<bool>();
+
+					if (vm.count(cli::UTXO_PREFAULT))
+						node.m_Cfg.m_ProcessorParams.m_UtxoPrefault = vm[cli::UTXO_PREFAULT].as<bool>();
+
+					if (vm.count(cli::SNAPSHOT_IMPORT_PATH))
+						node.m_Cfg.m_ProcessorParams.m_sSnapshot = vm[cli::SNAPSHOT_IMPORT_PATH].as<string>();
+
 					if (vm.count(cli::RESET_ID))
 						node.m_Cfg.m_ProcessorParams.m_ResetSelfID = vm[cli::RESET_ID].as<bool>();
 
@@ -353,6 +373,12 @@ int main_impl(int argc, char* argv[])
 						LOG_INFO() << "Recovery info written";
 					}
 
+					if (vm.count(cli::SNAPSHOT_EXPORT_PATH))
+					{
+						string sPath = vm[cli::SNAPSHOT_EXPORT_PATH].as<string>();
+						node.ExportSnapshot(sPath.c_str());
+					}
+
 					if (vm.count(cli::RECOVERY_AUTO_PATH))
 					{
 						node.m_Cfg.m_Recovery.m_sPathOutput = vm[cli::RECOVERY_AUTO_PATH].as<string>();
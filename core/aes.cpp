@@ -541,10 +541,223 @@ void AES::Decoder::Init(const Encoder& enc)
 }
 
 
+/* Hardware-accelerated paths (AES-NI, ARMv8 crypto extensions).
+*  They use the same key schedule as the software version: round keys are big-endian words, their byte representation is what the hardware expects.
+*  The decryption schedule is already in the "equivalent inverse cipher" form (InvMixColumns applied), which fits aesdec/vaesdq directly.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define AES_HW_X86
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#		define AES_HW_TARGET
+#	else
+#		include <cpuid.h>
+#		define AES_HW_TARGET __attribute__((target("aes,ssse3")))
+#	endif
+#	include <wmmintrin.h>
+#	include <tmmintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+	// only if the compiler is allowed to emit the crypto instructions (i.e. -march=armv8-a+crypto). The CPU support is still checked in runtime
+#	define AES_HW_ARM
+#	include <arm_neon.h>
+#	if defined(__linux__)
+#		include <sys/auxv.h>
+#		include <asm/hwcap.h>
+#	endif
+#endif
+
+namespace AesHw
+{
+#ifdef AES_HW_X86
+
+	bool IsSupported()
+	{
+		// AES-NI: CPUID.1:ECX.AESNI[bit 25], we also need SSSE3 (bit 9) for byte shuffling
+		const uint32_t nMask = (1U << 25) | (1U << 9);
+		uint32_t nEcx;
+
+#	ifdef _MSC_VER
+		int pRegs[4];
+		__cpuid(pRegs, 1);
+		nEcx = pRegs[2];
+#	else
+		uint32_t nEax, nEbx, nEdx;
+		if (!__get_cpuid(1, &nEax, &nEbx, &nEcx, &nEdx))
+			return false;
+#	endif
+
+		return (nEcx & nMask) == nMask;
+	}
+
+	struct Keys
+	{
+		__m128i m_p[AES::Nr + 1];
+
+		AES_HW_TARGET void Load(const uint32_t* pRk)
+		{
+			const __m128i bswap32 = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+			for (int i = 0; i <= AES::Nr; i++)
+				m_p[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (pRk + i * 4)), bswap32);
+		}
+	};
+
+	AES_HW_TARGET void Encode(const uint32_t* pRk, uint8_t* pDst, const uint8_t* pSrc)
+	{
+		Keys k;
+		k.Load(pRk);
+
+		__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*) pSrc), k.m_p[0]);
+		for (int i = 1; i < AES::Nr; i++)
+			x = _mm_aesenc_si128(x, k.m_p[i]);
+
+		_mm_storeu_si128((__m128i*) pDst, _mm_aesenclast_si128(x, k.m_p[AES::Nr]));
+	}
+
+	AES_HW_TARGET void Decode(const uint32_t* pRk, uint8_t* pDst, const uint8_t* pSrc)
+	{
+		Keys k;
+		k.Load(pRk);
+
+		__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*) pSrc), k.m_p[0]);
+		for (int i = 1; i < AES::Nr; i++)
+			x = _mm_aesdec_si128(x, k.m_p[i]);
+
+		_mm_storeu_si128((__m128i*) pDst, _mm_aesdeclast_si128(x, k.m_p[AES::Nr]));
+	}
+
+	AES_HW_TARGET void XCryptCtr(const uint32_t* pRk, beam::uintBig_t<AES::s_BlockSize>& ctr, uint8_t* pBuf, uint32_t nBlocks)
+	{
+		Keys k;
+		k.Load(pRk);
+
+		// several independent blocks in flight, to hide the aesenc latency
+		const uint32_t nPipe = 4;
+		__m128i pX[nPipe];
+
+		for (; nBlocks; )
+		{
+			uint32_t n = std::min(nBlocks, nPipe);
+
+			for (uint32_t j = 0; j < n; j++)
+			{
+				pX[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i*) ctr.m_pData), k.m_p[0]);
+				ctr.Inc();
+			}
+
+			for (int i = 1; i < AES::Nr; i++)
+				for (uint32_t j = 0; j < n; j++)
+					pX[j] = _mm_aesenc_si128(pX[j], k.m_p[i]);
+
+			for (uint32_t j = 0; j < n; j++)
+			{
+				__m128i* pDst = (__m128i*) (pBuf + j * AES::s_BlockSize);
+				__m128i x = _mm_aesenclast_si128(pX[j], k.m_p[AES::Nr]);
+				_mm_storeu_si128(pDst, _mm_xor_si128(x, _mm_loadu_si128(pDst)));
+			}
+
+			pBuf += n * AES::s_BlockSize;
+			nBlocks -= n;
+		}
+	}
+
+#elif defined(AES_HW_ARM)
+
+	bool IsSupported()
+	{
+#	if defined(__linux__)
+		return 0 != (getauxval(AT_HWCAP) & HWCAP_AES);
+#	else
+		return true; // compiled for a target with crypto extensions
+#	endif
+	}
+
+	struct Keys
+	{
+		uint8x16_t m_p[AES::Nr + 1];
+
+		void Load(const uint32_t* pRk)
+		{
+			for (int i = 0; i <= AES::Nr; i++)
+				m_p[i] = vrev32q_u8(vld1q_u8((const uint8_t*) (pRk + i * 4)));
+		}
+	};
+
+	void Encode(const uint32_t* pRk, uint8_t* pDst, const uint8_t* pSrc)
+	{
+		Keys k;
+		k.Load(pRk);
+
+		uint8x16_t x = vld1q_u8(pSrc);
+		for (int i = 0; i < AES::Nr - 1; i++)
+			x = vaesmcq_u8(vaeseq_u8(x, k.m_p[i]));
+
+		x = vaeseq_u8(x, k.m_p[AES::Nr - 1]);
+		vst1q_u8(pDst, veorq_u8(x, k.m_p[AES::Nr]));
+	}
+
+	void Decode(const uint32_t* pRk, uint8_t* pDst, const uint8_t* pSrc)
+	{
+		Keys k;
+		k.Load(pRk);
+
+		uint8x16_t x = vld1q_u8(pSrc);
+		for (int i = 0; i < AES::Nr - 1; i++)
+			x = vaesimcq_u8(vaesdq_u8(x, k.m_p[i]));
+
+		x = vaesdq_u8(x, k.m_p[AES::Nr - 1]);
+		vst1q_u8(pDst, veorq_u8(x, k.m_p[AES::Nr]));
+	}
+
+	void XCryptCtr(const uint32_t* pRk, beam::uintBig_t<AES::s_BlockSize>& ctr, uint8_t* pBuf, uint32_t nBlocks)
+	{
+		Keys k;
+		k.Load(pRk);
+
+		for (; nBlocks--; pBuf += AES::s_BlockSize)
+		{
+			uint8x16_t x = vld1q_u8(ctr.m_pData);
+			ctr.Inc();
+
+			for (int i = 0; i < AES::Nr - 1; i++)
+				x = vaesmcq_u8(vaeseq_u8(x, k.m_p[i]));
+
+			x = vaeseq_u8(x, k.m_p[AES::Nr - 1]);
+			x = veorq_u8(x, k.m_p[AES::Nr]);
+
+			vst1q_u8(pBuf, veorq_u8(x, vld1q_u8(pBuf)));
+		}
+	}
+
+#else
+
+	bool IsSupported() { return false; }
+	void Encode(const uint32_t*, uint8_t*, const uint8_t*) {}
+	void Decode(const uint32_t*, uint8_t*, const uint8_t*) {}
+	void XCryptCtr(const uint32_t*, beam::uintBig_t<AES::s_BlockSize>&, uint8_t*, uint32_t) {}
+
+#endif
+} // namespace AesHw
+
+bool AES::IsHwSupported()
+{
+	static const bool s_bSupported = AesHw::IsSupported();
+	return s_bSupported;
+}
+
+bool AES::s_UseHw = AES::IsHwSupported();
+
 /* AES 128-bit block encryption routine */
 
 void AES::Encoder::Proceed(uint8_t* pDst, const uint8_t* pSrc) const
 {
+	if (s_UseHw)
+	{
+		AesHw::Encode(m_erk, pDst, pSrc);
+		return;
+	}
+
 	uint32_t X0, X1, X2, X3, Y0, Y1, Y2, Y3;
 
 	const uint32_t* RK = m_erk;
@@ -628,6 +841,12 @@ void AES::Encoder::Proceed(uint8_t* pDst, const uint8_t* pSrc) const
 
 void AES::Decoder::Proceed(uint8_t* pDst, const uint8_t* pSrc) const
 {
+	if (s_UseHw)
+	{
+		AesHw::Decode(m_drk, pDst, pSrc);
+		return;
+	}
+
 	uint32_t X0, X1, X2, X3, Y0, Y1, Y2, Y3;
 
 	const uint32_t* RK = m_drk;
@@ -824,6 +1043,28 @@ void AES::StreamCipher::PerfXor(uint8_t* pBuf, uint32_t nSize)
 
 void AES::StreamCipher::XCrypt(const Encoder& enc, uint8_t* pBuf, uint32_t nSize)
 {
+	if (s_UseHw && (nSize >= s_BlockSize))
+	{
+		// use the remaining cipherstream, then the whole blocks are processed in-place
+		if (m_nBuf)
+		{
+			uint8_t n = m_nBuf;
+			PerfXor(pBuf, n);
+
+			pBuf += n;
+			nSize -= n;
+		}
+
+		uint32_t nBlocks = nSize / s_BlockSize;
+		AesHw::XCryptCtr(enc.m_erk, m_Counter, pBuf, nBlocks);
+
+		nSize -= nBlocks * s_BlockSize;
+		if (!nSize)
+			return;
+
+		pBuf += nBlocks * s_BlockSize;
+	}
+
 	while (true)
 	{
 		if (!m_nBuf)
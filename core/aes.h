@@ -8,6 +8,11 @@ struct AES
 	static const int Nr = 14; // num-rounds
 	static const int s_BlockSize = 16;
 
+	// Hardware acceleration (AES-NI on x86, crypto extensions on ARMv8) is used if the CPU supports it.
+	// Can be turned off in runtime, then the table-based software implementation is used.
+	static bool s_UseHw;
+	static bool IsHwSupported();
+
 	struct Encoder
 	{
 		uint32_t m_erk[64]; // encryption round keys. Actually needed 60, but during init extra space is used
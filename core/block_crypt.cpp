@@ -1041,7 +1041,7 @@ namespace beam
 		if (m_MetaData.m_Value.size() > Asset::Info::s_MetadataMaxSize)
 			return false;
 
-		ECC::Point::Native pt = ECC::Context::get().H * Rules::get().CA.DepositForList;
+		ECC::Point::Native pt = ECC::Context::get().H.MulVar(Rules::get().CA.DepositForList);
 		exc += pt;
 
 		return true;
@@ -1080,7 +1080,7 @@ namespace beam
 		if (!TxKernelAssetControl::IsValid(hScheme, exc, pParent))
 			return false;
 
-		ECC::Point::Native pt = ECC::Context::get().H * Rules::get().CA.DepositForList;
+		ECC::Point::Native pt = ECC::Context::get().H.MulVar(Rules::get().CA.DepositForList);
 
 		pt = -pt;
 		exc += pt;
@@ -1481,19 +1481,17 @@ namespace beam
 
 		void AddTo(ECC::Point::Native& res, const Type& x)
 		{
-			ECC::Mode::Scope scope(ECC::Mode::Fast);
-
 			if (get_Hi(x))
 			{
 				ECC::Scalar s;
 				s.m_Value = x;
-				res += ECC::Context::get().H_Big * s;
+				res += ECC::Context::get().H_Big.MulVar(s);
 			}
 			else
 			{
 				Amount lo = get_Lo(x);
 				if (lo)
-					res += ECC::Context::get().H * lo;
+					res += ECC::Context::get().H.MulVar(lo);
 			}
 		}
 
@@ -1873,6 +1871,33 @@ namespace beam
 		return m_PoW.IsValid(hv.m_pData, hv.nBytes, m_Height);
 	}
 
+	bool Block::SystemState::Full::IsValidBatch(const Full* pV, uint32_t nCount)
+	{
+		for (uint32_t i = 0; i < nCount; i++)
+			if (!pV[i].IsSane())
+				return false;
+
+		if (Rules::get().FakePoW)
+			return true;
+
+		std::vector<Merkle::Hash> vHv(nCount);
+		std::vector<PoW::BatchItem> vItems(nCount);
+
+		for (uint32_t i = 0; i < nCount; i++)
+		{
+			const Full& s = pV[i];
+			s.get_HashForPoW(vHv[i]);
+
+			PoW::BatchItem& x = vItems[i];
+			x.m_pPoW = &s.m_PoW;
+			x.m_pInput = vHv[i].m_pData;
+			x.m_nSizeInput = vHv[i].nBytes;
+			x.m_Height = s.m_Height;
+		}
+
+		return !nCount || PoW::IsValidBatch(&vItems.front(), nCount);
+	}
+
 	bool Block::SystemState::Full::GeneratePoW(const PoW::Cancel& fnCancel)
 	{
 		Merkle::Hash hv;
@@ -973,6 +973,18 @@ namespace beam
 
 			bool IsValid(const void* pInput, uint32_t nSizeInput, Height) const;
 
+			struct BatchItem
+			{
+				const PoW* m_pPoW;
+				const void* m_pInput;
+				uint32_t m_nSizeInput;
+				Height m_Height;
+			};
+
+			// Verify several solutions, returns true if all are valid. The blake2b hashes of all of them are computed together (AVX2 lanes if supported)
+			static bool IsValidBatch(const BatchItem*, uint32_t nCount);
+			static bool s_UseSimd;
+
 			using Cancel = std::function<bool(bool bRetrying)>;
 			// Difficulty and Nonce must be initialized. During the solution it's incremented each time by 1.
 			// returns false only if cancelled
@@ -980,6 +992,7 @@ namespace beam
 
 		private:
 			struct Helper;
+			struct BatchVerifier;
 		};
 
 		struct SystemState
@@ -1038,6 +1051,7 @@ namespace beam
 				bool IsValid() const {
 					return IsSane() && IsValidPoW(); 
 				}
+				static bool IsValidBatch(const Full*, uint32_t nCount); // all must be valid. PoW is verified in a batch
                 bool GeneratePoW(const PoW::Cancel& = [](bool) { return false; });
 
 				// the most robust proof verification - verifies the whole proof structure
@@ -1185,6 +1199,7 @@ namespace beam
 		bool ShouldAbort() const;
 
 		bool HandleElementHeight(const HeightRange&);
+		bool ValidateAndSummarizeInternal(const TxBase&, IReader&&);
 
 	public:
 		// Tests the validity of all the components, overall arithmetics, and the lexicographical order of the components.
@@ -1231,6 +1246,8 @@ namespace beam
 
 		void Reset();
 
+		// Signatures and range proofs are deferred to the active InnerProduct::BatchContext. If there's none - a large one is created for this call,
+		// so that all the kernels of a block are verified by few multi-exponentiations (bucket method), rather than one per kernel.
 		bool ValidateAndSummarize(const TxBase&, IReader&&);
 		bool Merge(const Context&);
 
@@ -66,6 +66,24 @@ namespace beam
 	}
 
 	bool TxBase::Context::ValidateAndSummarize(const TxBase& txb, IReader&& r)
+	{
+		if (ECC::InnerProduct::BatchContext::s_pInstance)
+			return ValidateAndSummarizeInternal(txb, std::move(r)); // the caller flushes it
+
+		typedef ECC::InnerProduct::BatchContextEx<64> MyBatch; // ~1.2K casual points, too large for the stack
+		static thread_local std::unique_ptr<MyBatch> s_pBc; // allocated once per thread, reused by consecutive validations
+		if (!s_pBc)
+			s_pBc = std::make_unique<MyBatch>();
+
+		s_pBc->Reset(); // may be left dirty by a failed validation
+		ECC::InnerProduct::BatchContext::Scope scope(*s_pBc);
+
+		return
+			ValidateAndSummarizeInternal(txb, std::move(r)) &&
+			s_pBc->Flush();
+	}
+
+	bool TxBase::Context::ValidateAndSummarizeInternal(const TxBase& txb, IReader&& r)
 	{
 		if (m_Height.IsEmpty())
 			return false;
@@ -188,7 +206,7 @@ namespace beam
 		}
 
 		if (ShouldVerify(iV) && !(txb.m_Offset.m_Value == Zero))
-			m_Sigma += ECC::Context::get().G * txb.m_Offset;
+			m_Sigma += ECC::Context::get().G.MulVar(txb.m_Offset);
 
 		assert(!m_Height.IsEmpty());
 		return true;
@@ -40,8 +40,32 @@
 #else // WIN32
 #    include <unistd.h>
 #    include <fcntl.h>
+#    include <sys/stat.h>
+#    include <sys/mman.h>
 #endif // WIN32
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define SHA256_HW_X86
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#		define SHA256_TARGET_HW
+#		define SHA256_TARGET_AVX2
+#	else
+#		include <cpuid.h>
+#		define SHA256_TARGET_HW __attribute__((target("sha,sse4.1,ssse3")))
+#		define SHA256_TARGET_AVX2 __attribute__((target("avx2")))
+#	endif
+#	include <immintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+	// only if the compiler is allowed to emit the SHA2 instructions. The CPU support is still checked in runtime
+#	define SHA256_HW_ARM
+#	include <arm_neon.h>
+#	if defined(__linux__)
+#		include <sys/auxv.h>
+#		include <asm/hwcap.h>
+#	endif
+#endif
+
 //#ifdef __linux__
 //#	include <sys/syscall.h>
 //#	include <linux/random.h>
@@ -304,8 +328,373 @@ namespace ECC {
 		SetInv(*this);
 	}
 
+	/////////////////////
+	// SHA-256 engines. The state is the secp256k1_sha256_t, only the block transformation differs
+	namespace Sha256
+	{
+		const uint32_t s_pK[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+
+		void TransformSoft(uint32_t* s, const uint8_t* p, size_t nBlocks)
+		{
+			for (; nBlocks--; p += 64)
+			{
+				uint32_t pChunk[16];
+				memcpy(pChunk, p, sizeof(pChunk)); // alignment
+				secp256k1_sha256_transform(s, pChunk);
+			}
+		}
+
+#ifdef SHA256_HW_X86
+
+		void get_CpuId(uint32_t* pRegs, uint32_t nLeaf)
+		{
+#	ifdef _MSC_VER
+			__cpuidex(reinterpret_cast<int*>(pRegs), nLeaf, 0);
+#	else
+			if (!__get_cpuid_count(nLeaf, 0, pRegs, pRegs + 1, pRegs + 2, pRegs + 3))
+				memset(pRegs, 0, sizeof(uint32_t) * 4);
+#	endif
+		}
+
+		bool IsHwSupported()
+		{
+			uint32_t pRegs1[4], pRegs7[4];
+			get_CpuId(pRegs1, 1);
+			get_CpuId(pRegs7, 7);
+
+			// SHA: leaf 7 EBX bit 29. SSSE3 and SSE4.1: leaf 1 ECX bits 9, 19
+			const uint32_t nMask1 = (1U << 9) | (1U << 19);
+			return ((pRegs1[2] & nMask1) == nMask1) && (1 & (pRegs7[1] >> 29));
+		}
+
+		bool IsSimdSupported()
+		{
+			uint32_t pRegs1[4], pRegs7[4];
+			get_CpuId(pRegs1, 1);
+			get_CpuId(pRegs7, 7);
+
+			// AVX2: leaf 7 EBX bit 5. Also the OS must save the ymm registers: OSXSAVE (leaf 1 ECX bit 27) and XCR0 bits 1,2
+			if (!(1 & (pRegs7[1] >> 5)) || !(1 & (pRegs1[2] >> 27)))
+				return false;
+
+#	ifdef _MSC_VER
+			uint64_t nXcr0 = _xgetbv(0);
+#	else
+			uint32_t nLo, nHi;
+			__asm__("xgetbv" : "=a"(nLo), "=d"(nHi) : "c"(0));
+			uint64_t nXcr0 = (static_cast<uint64_t>(nHi) << 32) | nLo;
+#	endif
+			return 6 == (nXcr0 & 6);
+		}
+
+		SHA256_TARGET_HW void TransformHw(uint32_t* s, const uint8_t* p, size_t nBlocks)
+		{
+			const __m128i mskBswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+			// the instructions work on the (ABEF, CDGH) representation
+			__m128i x0 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) s), 0xB1); // CDAB
+			__m128i x1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) (s + 4)), 0x1B); // EFGH
+			__m128i abef = _mm_alignr_epi8(x0, x1, 8);
+			__m128i cdgh = _mm_blend_epi16(x1, x0, 0xF0);
+
+			for (; nBlocks--; p += 64)
+			{
+				__m128i abef0 = abef;
+				__m128i cdgh0 = cdgh;
+				__m128i pMsg[4];
+
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					__m128i& m = pMsg[i & 3];
+					if (i < 4)
+						m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (p + i * 16)), mskBswap);
+					else
+					{
+						// W[4i..4i+3], from the 4 previous groups (the oldest is replaced)
+						m = _mm_sha256msg1_epu32(m, pMsg[(i + 1) & 3]);
+						m = _mm_add_epi32(m, _mm_alignr_epi8(pMsg[(i + 3) & 3], pMsg[(i + 2) & 3], 4));
+						m = _mm_sha256msg2_epu32(m, pMsg[(i + 3) & 3]);
+					}
+
+					__m128i wk = _mm_add_epi32(m, _mm_loadu_si128((const __m128i*) (s_pK + i * 4)));
+					cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+					abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E));
+				}
+
+				abef = _mm_add_epi32(abef, abef0);
+				cdgh = _mm_add_epi32(cdgh, cdgh0);
+			}
+
+			x0 = _mm_shuffle_epi32(abef, 0x1B); // FEBA
+			x1 = _mm_shuffle_epi32(cdgh, 0xB1); // DCHG
+			_mm_storeu_si128((__m128i*) s, _mm_blend_epi16(x0, x1, 0xF0)); // DCBA
+			_mm_storeu_si128((__m128i*) (s + 4), _mm_alignr_epi8(x1, x0, 8)); // HGFE
+		}
+
+#	define SHA256_AVX_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+		SHA256_TARGET_AVX2 void Transform8(uint32_t* const* ppS, const uint8_t* const* ppBlock)
+		{
+			// 8 independent states, one per 32-bit lane
+			alignas(32) uint32_t pT[8];
+			__m256i pV[8], pV0[8], pW[16];
+
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				for (uint32_t j = 0; j < 8; j++)
+					pT[j] = ppS[j][i];
+				pV[i] = pV0[i] = _mm256_load_si256((const __m256i*) pT);
+			}
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				for (uint32_t j = 0; j < 8; j++)
+				{
+					const uint8_t* p = ppBlock[j] + i * 4;
+					pT[j] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+				}
+				pW[i] = _mm256_load_si256((const __m256i*) pT);
+			}
+
+			__m256i a = pV[0], b = pV[1], c = pV[2], d = pV[3], e = pV[4], f = pV[5], g = pV[6], h = pV[7];
+
+			for (uint32_t i = 0; i < 64; i++)
+			{
+				__m256i& w = pW[i & 15];
+				if (i >= 16)
+				{
+					const __m256i& w2 = pW[(i - 2) & 15];
+					const __m256i& w15 = pW[(i - 15) & 15];
+
+					__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(SHA256_AVX_ROTR(w15, 7), SHA256_AVX_ROTR(w15, 18)), _mm256_srli_epi32(w15, 3));
+					__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(SHA256_AVX_ROTR(w2, 17), SHA256_AVX_ROTR(w2, 19)), _mm256_srli_epi32(w2, 10));
+
+					w = _mm256_add_epi32(_mm256_add_epi32(w, s0), _mm256_add_epi32(s1, pW[(i - 7) & 15]));
+				}
+
+				__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(SHA256_AVX_ROTR(e, 6), SHA256_AVX_ROTR(e, 11)), SHA256_AVX_ROTR(e, 25));
+				__m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+				__m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, s1), _mm256_add_epi32(ch, _mm256_add_epi32(w, _mm256_set1_epi32(s_pK[i]))));
+
+				__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(SHA256_AVX_ROTR(a, 2), SHA256_AVX_ROTR(a, 13)), SHA256_AVX_ROTR(a, 22));
+				__m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+				__m256i t2 = _mm256_add_epi32(s0, maj);
+
+				h = g;
+				g = f;
+				f = e;
+				e = _mm256_add_epi32(d, t1);
+				d = c;
+				c = b;
+				b = a;
+				a = _mm256_add_epi32(t1, t2);
+			}
+
+			pV[0] = a; pV[1] = b; pV[2] = c; pV[3] = d; pV[4] = e; pV[5] = f; pV[6] = g; pV[7] = h;
+
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				_mm256_store_si256((__m256i*) pT, _mm256_add_epi32(pV[i], pV0[i]));
+				for (uint32_t j = 0; j < 8; j++)
+					ppS[j][i] = pT[j];
+			}
+		}
+
+#	undef SHA256_AVX_ROTR
+
+#elif defined(SHA256_HW_ARM)
+
+		bool IsHwSupported()
+		{
+#	if defined(__linux__)
+			return 0 != (getauxval(AT_HWCAP) & HWCAP_SHA2);
+#	else
+			return true; // compiled for a target with SHA2 extensions
+#	endif
+		}
+
+		bool IsSimdSupported() { return false; }
+
+		void TransformHw(uint32_t* s, const uint8_t* p, size_t nBlocks)
+		{
+			uint32x4_t abcd = vld1q_u32(s);
+			uint32x4_t efgh = vld1q_u32(s + 4);
+
+			for (; nBlocks--; p += 64)
+			{
+				uint32x4_t abcd0 = abcd;
+				uint32x4_t efgh0 = efgh;
+				uint32x4_t pMsg[4];
+
+				for (uint32_t i = 0; i < 4; i++)
+					pMsg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + i * 16)));
+
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					uint32x4_t& m = pMsg[i & 3];
+					uint32x4_t wk = vaddq_u32(m, vld1q_u32(s_pK + i * 4));
+
+					if (i < 12) // W[4i+16..4i+19], replaces the oldest group
+						m = vsha256su1q_u32(vsha256su0q_u32(m, pMsg[(i + 1) & 3]), pMsg[(i + 2) & 3], pMsg[(i + 3) & 3]);
+
+					uint32x4_t abcdPrev = abcd;
+					abcd = vsha256hq_u32(abcd, efgh, wk);
+					efgh = vsha256h2q_u32(efgh, abcdPrev, wk);
+				}
+
+				abcd = vaddq_u32(abcd, abcd0);
+				efgh = vaddq_u32(efgh, efgh0);
+			}
+
+			vst1q_u32(s, abcd);
+			vst1q_u32(s + 4, efgh);
+		}
+
+		void Transform8(uint32_t* const*, const uint8_t* const*) {}
+
+#else
+
+		bool IsHwSupported() { return false; }
+		bool IsSimdSupported() { return false; }
+		void TransformHw(uint32_t*, const uint8_t*, size_t) {}
+		void Transform8(uint32_t* const*, const uint8_t* const*) {}
+
+#endif
+
+		void Transform(uint32_t* s, const uint8_t* p, size_t nBlocks)
+		{
+			if (Hash::Processor::s_UseHw)
+				TransformHw(s, p, nBlocks);
+			else
+				TransformSoft(s, p, nBlocks);
+		}
+
+		void TransformMulti(uint32_t* const* ppS, const uint8_t* const* ppBlock, uint32_t nCount)
+		{
+			if (Hash::Processor::s_UseSimd)
+			{
+				// full 8 lanes are on par with the hardware SHA. Partially filled are not
+				for (; nCount >= 8; nCount -= 8, ppS += 8, ppBlock += 8)
+					Transform8(ppS, ppBlock);
+
+				if ((nCount > 1) && !Hash::Processor::s_UseHw)
+				{
+					// pad with dummy lanes
+					uint32_t pDummyS[8] = { 0 };
+					uint32_t* ppS8[8];
+					const uint8_t* ppBlock8[8];
+
+					for (uint32_t i = 0; i < 8; i++)
+					{
+						bool bValid = (i < nCount);
+						ppS8[i] = bValid ? ppS[i] : pDummyS;
+						ppBlock8[i] = ppBlock[bValid ? i : 0];
+					}
+
+					Transform8(ppS8, ppBlock8);
+					return;
+				}
+			}
+
+			for (uint32_t i = 0; i < nCount; i++)
+				Transform(ppS[i], ppBlock[i], 1);
+		}
+
+		uint32_t get_BufSize(const secp256k1_sha256_t& x)
+		{
+			// a complete block is kept in the buffer till more data arrives, so that the finalization may be batched
+			uint32_t n = static_cast<uint32_t>(x.bytes & 0x3F);
+			return (!n && x.bytes) ? 64 : n;
+		}
+
+		void Write(secp256k1_sha256_t& x, const uint8_t* p, size_t n)
+		{
+			uint32_t nBuf = get_BufSize(x);
+			x.bytes += n;
+
+			uint8_t* pBuf = reinterpret_cast<uint8_t*>(x.buf);
+			if (nBuf + n <= 64)
+			{
+				memcpy(pBuf + nBuf, p, n);
+				return;
+			}
+
+			if (nBuf)
+			{
+				uint32_t nPortion = 64 - nBuf;
+				memcpy(pBuf + nBuf, p, nPortion);
+				p += nPortion;
+				n -= nPortion;
+
+				Transform(x.s, pBuf, 1);
+			}
+
+			size_t nBlocks = (n - 1) >> 6; // the last block (maybe complete) stays in the buffer
+			Transform(x.s, p, nBlocks);
+
+			nBlocks <<= 6;
+			memcpy(pBuf, p + nBlocks, n - nBlocks);
+		}
+
+		uint32_t PrepareTail(const secp256k1_sha256_t& x, uint8_t* pTail)
+		{
+			// the remaining data + padding + bit length. 1 or 2 blocks
+			uint32_t nBuf = get_BufSize(x);
+			memcpy(pTail, x.buf, nBuf);
+			pTail[nBuf] = 0x80;
+
+			uint32_t nBlocks = (nBuf + 9 <= 64) ? 1 : 2;
+			uint32_t nSize = nBlocks << 6;
+			memset(pTail + nBuf + 1, 0, nSize - nBuf - 1);
+
+			uint64_t nBits = static_cast<uint64_t>(x.bytes) << 3;
+			for (uint32_t i = 0; i < 8; i++, nBits >>= 8)
+				pTail[nSize - 1 - i] = static_cast<uint8_t>(nBits);
+
+			return nBlocks;
+		}
+
+		void Export(secp256k1_sha256_t& x, uint8_t* pOut)
+		{
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				uint32_t v = x.s[i];
+				pOut[i * 4] = static_cast<uint8_t>(v >> 24);
+				pOut[i * 4 + 1] = static_cast<uint8_t>(v >> 16);
+				pOut[i * 4 + 2] = static_cast<uint8_t>(v >> 8);
+				pOut[i * 4 + 3] = static_cast<uint8_t>(v);
+				x.s[i] = 0;
+			}
+		}
+
+	} // namespace Sha256
+
 	/////////////////////
 	// Hash
+	bool Hash::Processor::IsHwSupported()
+	{
+		static const bool s_bSupported = Sha256::IsHwSupported();
+		return s_bSupported;
+	}
+
+	bool Hash::Processor::IsSimdSupported()
+	{
+		static const bool s_bSupported = Sha256::IsSimdSupported();
+		return s_bSupported;
+	}
+
+	bool Hash::Processor::s_UseHw = Hash::Processor::IsHwSupported();
+	bool Hash::Processor::s_UseSimd = Hash::Processor::IsSimdSupported();
+
 	Hash::Processor::Processor()
 	{
 		Reset();
@@ -326,17 +715,67 @@ namespace ECC {
 	void Hash::Processor::Write(const void* p, uint32_t n)
 	{
 		assert(m_bInitialized);
-		secp256k1_sha256_write(this, (const uint8_t*) p, n);
+		Sha256::Write(*this, (const uint8_t*) p, n);
 	}
 
 	void Hash::Processor::Finalize(Value& v)
 	{
 		assert(m_bInitialized);
-		secp256k1_sha256_finalize(this, v.m_pData);
-		
+
+		uint8_t pTail[128];
+		uint32_t nBlocks = Sha256::PrepareTail(*this, pTail);
+		Sha256::Transform(s, pTail, nBlocks);
+		Sha256::Export(*this, v.m_pData);
+
 		m_bInitialized = false;
 	}
 
+	void Hash::Processor::FinalizeMulti(Processor* pHp, Value* pRes, uint32_t nCount)
+	{
+		const uint32_t nBatch = 8;
+		uint8_t ppTail[nBatch][128];
+		uint32_t pBlocks[nBatch];
+		uint32_t* ppS[nBatch];
+		const uint8_t* ppBlock[nBatch];
+
+		for (; nCount; )
+		{
+			uint32_t n = std::min(nCount, nBatch);
+
+			for (uint32_t i = 0; i < n; i++)
+			{
+				assert(pHp[i].m_bInitialized);
+				pBlocks[i] = Sha256::PrepareTail(pHp[i], ppTail[i]);
+			}
+
+			// the 1st block for all, then the 2nd block for those that need it
+			for (uint32_t iBlock = 0; iBlock < 2; iBlock++)
+			{
+				uint32_t nLanes = 0;
+				for (uint32_t i = 0; i < n; i++)
+				{
+					if (pBlocks[i] > iBlock)
+					{
+						ppS[nLanes] = pHp[i].s;
+						ppBlock[nLanes++] = ppTail[i] + (iBlock << 6);
+					}
+				}
+
+				Sha256::TransformMulti(ppS, ppBlock, nLanes);
+			}
+
+			for (uint32_t i = 0; i < n; i++)
+			{
+				Sha256::Export(pHp[i], pRes[i].m_pData);
+				pHp[i].m_bInitialized = false;
+			}
+
+			pHp += n;
+			pRes += n;
+			nCount -= n;
+		}
+	}
+
 	void Hash::Processor::Write(const beam::Blob& v)
 	{
 		Write(v.p, v.n);
@@ -897,7 +1336,8 @@ namespace ECC {
 			return true;
 		}
 
-		void SetMul(Point::Native& res, bool bSet, const Point::Compact* pPts, const Scalar::Native::uint* p, int nWords)
+		template <Mode::Enum eMode>
+		void SetMulT(Point::Native& res, bool bSet, const Point::Compact* pPts, const Scalar::Native::uint* p, int nWords)
 		{
 			static_assert(8 % nBitsPerLevel == 0, "");
 			const int nLevelsPerWord = (sizeof(Scalar::Native::uint) << 3) / nBitsPerLevel;
@@ -927,7 +1367,7 @@ namespace ECC {
 					*/
 
 					const Point::Compact* pSel;
-					if (Mode::Secure == g_Mode)
+					if (Mode::Secure == eMode)
 					{
 						pSel = &ge_s.V;
 						for (uint32_t i = 0; i < nPointsPerLevel; i++)
@@ -942,11 +1382,33 @@ namespace ECC {
 						res = *pSel;
 					}
 					else
-						res += *pSel;
+					{
+						if (Mode::Secure == eMode)
+							res += *pSel;
+						else
+						{
+							secp256k1_ge ge;
+							pSel->Assign(ge);
+							secp256k1_gej_add_ge_var(&res.get_Raw(), &res.get_Raw(), &ge, nullptr);
+						}
+					}
 				}
 			}
 		}
 
+		void SetMul(Point::Native& res, bool bSet, const Point::Compact* pPts, const Scalar::Native::uint* p, int nWords)
+		{
+			if (Mode::Secure == g_Mode)
+				SetMulT<Mode::Secure>(res, bSet, pPts, p, nWords);
+			else
+				SetMulT<Mode::Fast>(res, bSet, pPts, p, nWords);
+		}
+
+		void SetMulVar(Point::Native& res, bool bSet, const Point::Compact* pPts, const Scalar::Native::uint* p, int nWords)
+		{
+			SetMulT<Mode::Fast>(res, bSet, pPts, p, nWords);
+		}
+
 		void SetMul(Point::Native& res, bool bSet, const Point::Compact* pPts, const Scalar::Native& k)
 		{
 			SetMul(res, bSet, pPts, k.get().d, _countof(k.get().d));
@@ -996,21 +1458,40 @@ namespace ECC {
 				Generator::SetMul(res, bSet, m_pPts, k);
 		}
 
+		void Obscured::AssignInternalVar(Point::Native& res, bool bSet, const Scalar::Native& k) const
+		{
+			Generator::SetMulVar(res, bSet, m_pPts, k.get().d, _countof(k.get().d));
+		}
+
 		template <>
-		void Obscured::Mul<Scalar::Native>::Assign(Point::Native& res, bool bSet) const
+		void Obscured::Mul<Scalar::Native, false>::Assign(Point::Native& res, bool bSet) const
 		{
 			Scalar::Native k2;
 			me.AssignInternal(res, bSet, k2, k);
 		}
 
 		template <>
-		void Obscured::Mul<Scalar>::Assign(Point::Native& res, bool bSet) const
+		void Obscured::Mul<Scalar, false>::Assign(Point::Native& res, bool bSet) const
 		{
 			Scalar::Native k2;
 			k2.Import(k); // don't care if overflown (still valid operation)
 			me.AssignInternal(res, bSet, k2, k2);
 		}
 
+		template <>
+		void Obscured::Mul<Scalar::Native, true>::Assign(Point::Native& res, bool bSet) const
+		{
+			me.AssignInternalVar(res, bSet, k);
+		}
+
+		template <>
+		void Obscured::Mul<Scalar, true>::Assign(Point::Native& res, bool bSet) const
+		{
+			Scalar::Native k2;
+			k2.Import(k);
+			me.AssignInternalVar(res, bSet, k2);
+		}
+
 	} // namespace Generator
 
 	/////////////////////
@@ -1097,6 +1578,20 @@ namespace ECC {
 	void MultiMac::Casual::Init(const Point::Native& p)
 	{
 		if (Mode::Fast == g_Mode)
+			InitT<Mode::Fast>(p);
+		else
+			InitT<Mode::Secure>(p);
+	}
+
+	void MultiMac::Casual::InitVar(const Point::Native& p)
+	{
+		InitT<Mode::Fast>(p);
+	}
+
+	template <Mode::Enum eMode>
+	void MultiMac::Casual::InitT(const Point::Native& p)
+	{
+		if (Mode::Fast == eMode)
 		{
 			Fast& f = U.F.get();
 			f.m_pPt[0] = p;
@@ -1128,6 +1623,26 @@ namespace ECC {
 		return (n >> (iBitInWord & ~(nBitsWnd - 1))) & ((1 << nBitsWnd) - 1);
 	}
 
+	unsigned int GetBitsAt(const Scalar::Native& k, unsigned int iBit, unsigned int nBits)
+	{
+		// arbitrary position and width (up to 32 bits), bits beyond the scalar are zero
+		const unsigned int nBitsPerWord = sizeof(Scalar::Native::uint) << 3;
+		const unsigned int nWords = ECC::nBits / nBitsPerWord;
+
+		unsigned int iWord = iBit / nBitsPerWord;
+		if (iWord >= nWords)
+			return 0;
+
+		unsigned int iBitInWord = iBit % nBitsPerWord;
+		uint64_t n = static_cast<uint64_t>(k.get().d[iWord]) >> iBitInWord;
+
+		unsigned int nHave = nBitsPerWord - iBitInWord;
+		if ((nHave < nBits) && (iWord + 1 < nWords))
+			n |= static_cast<uint64_t>(k.get().d[iWord + 1]) << nHave;
+
+		return static_cast<unsigned int>(n) & ((1U << nBits) - 1);
+	}
+
 	struct MultiMac::WnafBase::Context
 	{
 		const Scalar::Native::uint* m_p;
@@ -1388,7 +1903,112 @@ namespace ECC {
 		return true;
 	}
 
+	uint32_t MultiMac::s_PippengerThreshold = 160;
+
+	void MultiMac::CalculateBuckets(Point::Native& res) const
+	{
+		// Pippenger bucket method over the casual points, which are already brought to the common denominator.
+		// Scalars are split into signed (Booth-recoded) digits of nWnd bits, each window is summed via 2^(nWnd-1) buckets.
+		uint32_t nPts = 0;
+		for (int iEntry = 0; iEntry < m_Casual; iEntry++)
+			if (m_pCasual[iEntry].U.F.get().m_nNeeded)
+				nPts++;
+
+		res = Zero;
+		if (!nPts)
+			return;
+
+		// choose the window size that minimizes the number of additions: nWindows * (nPts + nBuckets * 2)
+		const unsigned int nWndMax = 14;
+		unsigned int nWnd = 1;
+		uint64_t nCost = static_cast<uint64_t>(-1);
+
+		for (unsigned int nBits = 1; nBits <= nWndMax; nBits++)
+		{
+			uint64_t nCostWnd = static_cast<uint64_t>(ECC::nBits / nBits + 1) * (nPts + (1U << nBits));
+			if (nCostWnd < nCost)
+			{
+				nCost = nCostWnd;
+				nWnd = nBits;
+			}
+		}
+
+		// one extra bit above the scalar, to keep the top digit positive
+		const unsigned int nWindows = ECC::nBits / nWnd + 1;
+		const unsigned int nBuckets = 1U << (nWnd - 1);
+
+		std::vector<Point::Native> vBuckets(nBuckets);
+		Point::Native ptRunning, ptWnd;
+		secp256k1_ge ge;
+
+		for (unsigned int iWnd = nWindows; iWnd--; )
+		{
+			if (!(res == Zero))
+				for (unsigned int i = 0; i < nWnd; i++)
+					res = res * Two;
+
+			for (unsigned int i = 0; i < nBuckets; i++)
+				vBuckets[i] = Zero;
+
+			unsigned int iBit = iWnd * nWnd;
+
+			for (int iEntry = 0; iEntry < m_Casual; iEntry++)
+			{
+				const Casual::Fast& f = m_pCasual[iEntry].U.F.get();
+				if (!f.m_nNeeded)
+					continue;
+
+				// Booth recoding: the digit is determined by the window bits and the top bit of the previous window
+				const Scalar::Native& k = m_pKCasual[iEntry];
+				unsigned int nVal = iBit ?
+					GetBitsAt(k, iBit - 1, nWnd + 1) :
+					(GetBitsAt(k, 0, nWnd) << 1);
+
+				unsigned int nAbs = (nVal >> 1) + (nVal & 1);
+				bool bNeg = 0 != (1 & (nVal >> nWnd));
+				if (bNeg)
+					nAbs = (1U << nWnd) - nAbs;
+
+				if (!nAbs)
+					continue;
+
+				Point::Native::BatchNormalizer::get_As(ge, f.m_pPt[0]);
+				if (bNeg)
+					secp256k1_ge_neg(&ge, &ge);
+
+				Point::Native& ptB = vBuckets[nAbs - 1];
+				secp256k1_gej_add_ge_var(&ptB.get_Raw(), &ptB.get_Raw(), &ge, nullptr);
+			}
+
+			// sum of (i + 1) * Bucket[i]
+			ptRunning = Zero;
+			ptWnd = Zero;
+
+			for (unsigned int i = nBuckets; i--; )
+			{
+				ptRunning += vBuckets[i];
+				ptWnd += ptRunning;
+			}
+
+			res += ptWnd;
+		}
+	}
+
 	void MultiMac::Calculate(Point::Native& res) const
+	{
+		if (Mode::Fast == g_Mode)
+			CalculateT<Mode::Fast>(res);
+		else
+			CalculateT<Mode::Secure>(res);
+	}
+
+	void MultiMac::CalculateVar(Point::Native& res) const
+	{
+		CalculateT<Mode::Fast>(res);
+	}
+
+	template <Mode::Enum eMode>
+	void MultiMac::CalculateT(Point::Native& res) const
 	{
 		const unsigned int nBitsPerWord = sizeof(Scalar::Native::uint) << 3;
 
@@ -1401,12 +2021,13 @@ namespace ECC {
 		NoLeak<Point::Compact> ge_s;
 		secp256k1_fe zDenom;
 		bool bDenomSet = false;
+		bool bBuckets = false;
 
 		WnafBase::Shared wsP, wsC;
 
 		unsigned int iBit = ECC::nBits;
 
-		if (Mode::Fast == g_Mode)
+		if (Mode::Fast == eMode)
 		{
 			iBit++; // extra bit may be necessary because of interleaving
 			assert(iBit == _countof(wsP.m_pTable));
@@ -1414,6 +2035,8 @@ namespace ECC {
 			wsP.Reset();
 			wsC.Reset();
 
+			bBuckets = (Reuse::None == m_ReuseFlag) && (static_cast<uint32_t>(m_Casual) >= s_PippengerThreshold);
+
 			for (int iEntry = 0; iEntry < m_Prepared; iEntry++)
 			{
 				unsigned int nEntries = m_pWnafPrepared[iEntry].Init(wsP, m_pKPrep[iEntry], iEntry + 1);
@@ -1433,6 +2056,12 @@ namespace ECC {
 					continue;
 				}
 
+				if (bBuckets)
+				{
+					f.m_nNeeded = 1; // only the point itself
+					continue;
+				}
+
 				unsigned int nEntries = f.m_Wnaf.Init(wsC, m_pKCasual[iEntry], iEntry + 1);
 				assert(nEntries <= _countof(f.m_Wnaf.m_pVals));
 
@@ -1499,7 +2128,7 @@ namespace ECC {
 			if (!(res == Zero))
 				res = res * Two;
 
-			if (Mode::Fast == g_Mode)
+			if (Mode::Fast == eMode)
 			{
 				WnafBase::Link& lnkC = wsC.m_pTable[iBit]; // alias
 				while (lnkC.m_iElement)
@@ -1587,7 +2216,7 @@ namespace ECC {
 			}
 		}
 
-		if (Mode::Secure == g_Mode)
+		if (Mode::Secure == eMode)
 		{
 			for (int iEntry = 0; iEntry < m_Prepared; iEntry++)
 			{
@@ -1601,6 +2230,14 @@ namespace ECC {
 		}
 		else
 		{
+			if (bBuckets)
+			{
+				// the buckets are in terms of the same denominator, just add them
+				Point::Native resBuckets;
+				CalculateBuckets(resBuckets);
+				res += resBuckets;
+			}
+
 			// fix denominator
 			secp256k1_fe_mul(&res.get_Raw().z, &res.get_Raw().z, &zDenom);
 		}
@@ -1659,22 +2296,62 @@ namespace ECC {
 	/////////////////////
 	// Context
 	AlignedBuf<Context> g_ContextBuf;
+	const Context* g_pContext = nullptr; // either g_ContextBuf, or the mapped blob
 
 	// Currently - auto-init in global obj c'tor
 	Initializer g_Initializer;
 
-#ifndef NDEBUG
-	bool g_bContextInitialized = false;
-#endif // NDEBUG
-
 	const Context& Context::get()
 	{
-		assert(g_bContextInitialized);
-		return g_ContextBuf.get();
+		assert(g_pContext);
+		return *g_pContext;
+	}
+
+	void InitializeContextSig(Context& ctx)
+	{
+		ctx.m_Sig.m_GenG.m_pGen = &ctx.G;
+		ctx.m_Sig.m_GenG.m_pGenPrep = &ctx.m_Ipp.G_;
+		ctx.m_Sig.m_GenG.m_nBatchIdx = InnerProduct::BatchContext::s_Idx_G;
+
+		ctx.m_Sig.m_CfgG1.m_nKeys = 1;
+		ctx.m_Sig.m_CfgG1.m_nG = 1;
+		ctx.m_Sig.m_CfgG1.m_pG = &ctx.m_Sig.m_GenG;
+
+		ctx.m_Sig.m_pGenGJ[0] = ctx.m_Sig.m_GenG;
+
+		ctx.m_Sig.m_pGenGJ[1].m_pGen = &ctx.J;
+		ctx.m_Sig.m_pGenGJ[1].m_pGenPrep = &ctx.m_Ipp.J_;
+		ctx.m_Sig.m_pGenGJ[1].m_nBatchIdx = InnerProduct::BatchContext::s_Idx_J;
+
+		ctx.m_Sig.m_pGenGH[0] = ctx.m_Sig.m_GenG;
+
+		ctx.m_Sig.m_pGenGH[1].m_pGen = &ctx.H_Big;
+		ctx.m_Sig.m_pGenGH[1].m_pGenPrep = &ctx.m_Ipp.H_;
+		ctx.m_Sig.m_pGenGH[1].m_nBatchIdx = InnerProduct::BatchContext::s_Idx_H;
+
+		ctx.m_Sig.m_CfgGJ1.m_nKeys = 1;
+		ctx.m_Sig.m_CfgGJ1.m_nG = 2;
+		ctx.m_Sig.m_CfgGJ1.m_pG = ctx.m_Sig.m_pGenGJ;
+
+		ctx.m_Sig.m_CfgG2.m_nKeys = 2;
+		ctx.m_Sig.m_CfgG2.m_nG = 1;
+		ctx.m_Sig.m_CfgG2.m_pG = &ctx.m_Sig.m_GenG;
+
+		ctx.m_Sig.m_CfgGH2.m_nKeys = 2;
+		ctx.m_Sig.m_CfgGH2.m_nG = 2;
+		ctx.m_Sig.m_CfgGH2.m_pG = ctx.m_Sig.m_pGenGH;
 	}
 
 	void InitializeContext()
 	{
+		const char* szBlob = getenv("BEAM_ECC_CONTEXT");
+		if (szBlob && *szBlob)
+		{
+			g_pContext = Context::Map(szBlob);
+			if (g_pContext)
+				return;
+		}
+
 		Context& ctx = g_ContextBuf.get();
 
 		Mode::Scope scope(Mode::Fast);
@@ -1773,41 +2450,232 @@ namespace ECC {
 			<< uint32_t(2) // increment this each time we change signature formula (rangeproof and etc.)
 			>> ctx.m_hvChecksum;
 
-		ctx.m_Sig.m_GenG.m_pGen = &ctx.G;
-		ctx.m_Sig.m_GenG.m_pGenPrep = &ctx.m_Ipp.G_;
-		ctx.m_Sig.m_GenG.m_nBatchIdx = InnerProduct::BatchContext::s_Idx_G;
+		InitializeContextSig(ctx);
 
-		ctx.m_Sig.m_CfgG1.m_nKeys = 1;
-		ctx.m_Sig.m_CfgG1.m_nG = 1;
-		ctx.m_Sig.m_CfgG1.m_pG = &ctx.m_Sig.m_GenG;
+		g_pContext = &ctx;
+	}
 
-		ctx.m_Sig.m_pGenGJ[0] = ctx.m_Sig.m_GenG;
+	/////////////////////
+	// Context blob
+	struct ContextBlob
+	{
+		struct Hdr
+		{
+			uint8_t m_pSig[8];
+			uint32_t m_nSize; // of the context
+			uint32_t m_nOffset; // of the context from the file start
+			Hash::Value m_hvLayout; // build-specific, the blob is compatible only with the same layout
+		};
 
-		ctx.m_Sig.m_pGenGJ[1].m_pGen = &ctx.J;
-		ctx.m_Sig.m_pGenGJ[1].m_pGenPrep = &ctx.m_Ipp.J_;
-		ctx.m_Sig.m_pGenGJ[1].m_nBatchIdx = InnerProduct::BatchContext::s_Idx_J;
+		static const uint32_t s_Offset = 128; // keep the context aligned
+		static_assert(sizeof(Hdr) <= s_Offset, "");
 
-		ctx.m_Sig.m_pGenGH[0] = ctx.m_Sig.m_GenG;
+		static const uint8_t s_pSig[8];
+		static const uint8_t s_pData[Hash::Value::nBytes];
 
-		ctx.m_Sig.m_pGenGH[1].m_pGen = &ctx.H_Big;
-		ctx.m_Sig.m_pGenGH[1].m_pGenPrep = &ctx.m_Ipp.H_;
-		ctx.m_Sig.m_pGenGH[1].m_nBatchIdx = InnerProduct::BatchContext::s_Idx_H;
+		static void get_Layout(Hash::Value& hv)
+		{
+			const Context& ctx = g_ContextBuf.get(); // only addresses are used
+			uint32_t nEndian = 1; // native byte order
+
+			Hash::Processor()
+				<< "ecc.ctx"
+				<< static_cast<uint32_t>(sizeof(Context))
+				<< static_cast<uint32_t>(sizeof(void*))
+				<< static_cast<uint32_t>(sizeof(Scalar::Native))
+				<< static_cast<uint32_t>(sizeof(Point::Native))
+				<< static_cast<uint32_t>(reinterpret_cast<const uint8_t*>(&ctx.m_Ipp) - reinterpret_cast<const uint8_t*>(&ctx))
+				<< static_cast<uint32_t>(reinterpret_cast<const uint8_t*>(&ctx.m_Sig) - reinterpret_cast<const uint8_t*>(&ctx))
+				<< beam::Blob(&nEndian, sizeof(nEndian))
+				>> hv;
+		}
 
-		ctx.m_Sig.m_CfgGJ1.m_nKeys = 1;
-		ctx.m_Sig.m_CfgGJ1.m_nG = 2;
-		ctx.m_Sig.m_CfgGJ1.m_pG = ctx.m_Sig.m_pGenGJ;
+		static uint32_t get_SigOffset()
+		{
+			const Context& ctx = g_ContextBuf.get();
+			return static_cast<uint32_t>(reinterpret_cast<const uint8_t*>(&ctx.m_Sig) - reinterpret_cast<const uint8_t*>(&ctx));
+		}
 
-		ctx.m_Sig.m_CfgG2.m_nKeys = 2;
-		ctx.m_Sig.m_CfgG2.m_nG = 1;
-		ctx.m_Sig.m_CfgG2.m_pG = &ctx.m_Sig.m_GenG;
+		static bool IsValid(const uint8_t* p)
+		{
+			const Hdr& hdr = *reinterpret_cast<const Hdr*>(p);
 
-		ctx.m_Sig.m_CfgGH2.m_nKeys = 2;
-		ctx.m_Sig.m_CfgGH2.m_nG = 2;
-		ctx.m_Sig.m_CfgGH2.m_pG = ctx.m_Sig.m_pGenGH;
+			if (memcmp(hdr.m_pSig, s_pSig, sizeof(s_pSig)) ||
+				(sizeof(Context) != hdr.m_nSize) ||
+				(s_Offset != hdr.m_nOffset))
+				return false;
+
+			Hash::Value hv;
+			get_Layout(hv);
+			if (hv != hdr.m_hvLayout)
+				return false;
+
+			// the blob itself is not trusted, all the precomputed data must match the one compiled in
+			const Context& ctx = *reinterpret_cast<const Context*>(p + s_Offset);
+			ctx.get_DataHash(hv);
+			return !memcmp(hv.m_pData, s_pData, sizeof(s_pData));
+		}
+	};
+
+	// change this when the format changes
+	const uint8_t ContextBlob::s_pSig[8] = { 'B', 'e', 'a', 'm', 'E', 'c', 'c', 2 };
+
+	// Context::get_DataHash() of the current generators (printed by ecc-context-gen). Update it together with the seeds/formula version in InitializeContext()
+	const uint8_t ContextBlob::s_pData[Hash::Value::nBytes] = {
+		0xd2, 0x0d, 0xc5, 0xe9, 0xed, 0x1e, 0x89, 0xc5,
+		0x35, 0xe4, 0xff, 0x39, 0x4d, 0x07, 0xab, 0x41,
+		0x46, 0x29, 0xce, 0x0f, 0x7a, 0x4b, 0xdc, 0x05,
+		0x34, 0x64, 0x27, 0x1a, 0xf5, 0xce, 0x9d, 0x69,
+	};
+
+	void Context::get_DataHash(Hash::Value& hv) const
+	{
+		// independent of the limbs configuration, endianness and padding, hence the same for all the builds
+		struct Walker
+			:public Hash::Processor
+		{
+			void OnPts(const Point::Compact* pPts, uint32_t nCount)
+			{
+				for (uint32_t i = 0; i < nCount; i++)
+				{
+					secp256k1_ge ge;
+					pPts[i].Assign(ge);
+
+					Point::Storage pt;
+					pt.FromNnz(ge);
+					*this << pt.m_X << pt.m_Y;
+				}
+			}
+
+			void OnPrepared(const MultiMac::Prepared& p)
+			{
+				OnPts(p.m_Fast.m_pPt, _countof(p.m_Fast.m_pPt));
+				OnPts(p.m_Secure.m_pPt, _countof(p.m_Secure.m_pPt));
+				OnPts(&p.m_Secure.m_Compensation, 1);
+				*this << p.m_Secure.m_Scalar;
+			}
+
+			void OnObscured(const Generator::Obscured& g)
+			{
+				OnPts(g.m_pPts, _countof(g.m_pPts));
+				OnPts(&g.m_AddPt, 1);
+				*this << g.m_AddScalar;
+			}
+		};
+
+		Walker wlk;
+		wlk << "ecc.ctx.data";
+
+		wlk.OnObscured(G);
+		wlk.OnObscured(H_Big);
+		wlk.OnPts(H.m_pPts, _countof(H.m_pPts));
+		wlk.OnObscured(J);
+
+		for (uint32_t j = 0; j < 2; j++)
+			for (uint32_t i = 0; i < InnerProduct::nDim; i++)
+				wlk.OnPrepared(m_Ipp.m_pGen_[j][i]);
+
+		wlk.OnPts(m_Ipp.m_pGet1_Minus, _countof(m_Ipp.m_pGet1_Minus));
+		wlk.OnPrepared(m_Ipp.m_GenDot_);
+		wlk.OnPrepared(m_Ipp.m_Aux2_);
+		wlk.OnPrepared(m_Ipp.G_);
+		wlk.OnPrepared(m_Ipp.H_);
+		wlk.OnPrepared(m_Ipp.J_);
+		wlk << m_Ipp.m_2Inv;
+
+		wlk.OnPts(&m_Casual.m_Nums, 1);
+		wlk.OnPts(&m_Casual.m_Compensation, 1);
+
+		wlk
+			<< m_hvChecksum
+			>> hv;
+	}
+
+	void Context::Export(const char* szPath)
+	{
+		const Context& ctx = get();
+
+		std::vector<uint8_t> vBuf(ContextBlob::s_Offset + sizeof(Context), 0);
+		ContextBlob::Hdr& hdr = *reinterpret_cast<ContextBlob::Hdr*>(&vBuf.front());
+		uint8_t* pData = &vBuf.front() + ContextBlob::s_Offset;
+
+		memcpy(pData, &ctx, sizeof(Context));
+		memset0(pData + ContextBlob::get_SigOffset(), sizeof(ctx.m_Sig)); // pointers, fixed-up on load
+
+		memcpy(hdr.m_pSig, ContextBlob::s_pSig, sizeof(hdr.m_pSig));
+		hdr.m_nSize = sizeof(Context);
+		hdr.m_nOffset = ContextBlob::s_Offset;
+		ContextBlob::get_Layout(hdr.m_hvLayout);
+
+		std::FStream fs;
+		fs.Open(szPath, false, true);
+		fs.write(&vBuf.front(), vBuf.size());
+	}
+
+	const Context* Context::Map(const char* szPath)
+	{
+		// Map privately (copy-on-write), only the page(s) of m_Sig are modified, the rest is shared with other processes
+		const size_t nSize = ContextBlob::s_Offset + sizeof(Context);
+		uint8_t* p = nullptr;
+
+#ifdef WIN32
+		HANDLE hFile = CreateFileA(szPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+		if (INVALID_HANDLE_VALUE == hFile)
+			return nullptr;
+
+		LARGE_INTEGER nFile;
+		if (GetFileSizeEx(hFile, &nFile) && (static_cast<uint64_t>(nFile.QuadPart) == nSize))
+		{
+			HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+			if (hMapping)
+			{
+				p = (uint8_t*) MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, nSize);
+				CloseHandle(hMapping);
+			}
+		}
 
-#ifndef NDEBUG
-		g_bContextInitialized = true;
-#endif // NDEBUG
+		CloseHandle(hFile);
+#else // WIN32
+		int hFile = open(szPath, O_RDONLY);
+		if (hFile < 0)
+			return nullptr;
+
+		struct stat st;
+		if (!fstat(hFile, &st) && (static_cast<uint64_t>(st.st_size) == nSize))
+		{
+			void* pPtr = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, hFile, 0);
+			if (MAP_FAILED != pPtr)
+				p = (uint8_t*) pPtr;
+		}
+
+		close(hFile);
+#endif // WIN32
+
+		if (!p)
+			return nullptr;
+
+		if (!ContextBlob::IsValid(p))
+		{
+#ifdef WIN32
+			UnmapViewOfFile(p);
+#else // WIN32
+			munmap(p, nSize);
+#endif // WIN32
+			return nullptr;
+		}
+
+		Context& ctx = *reinterpret_cast<Context*>(p + ContextBlob::s_Offset);
+		InitializeContextSig(ctx);
+
+		// the mapping is kept for the process lifetime
+#ifdef WIN32
+		DWORD dwPrev;
+		VirtualProtect(p, nSize, PAGE_READONLY, &dwPrev);
+#else // WIN32
+		mprotect(p, nSize, PROT_READ);
+#endif // WIN32
+
+		return &ctx;
 	}
 
 	/////////////////////
@@ -2198,8 +3066,7 @@ namespace ECC {
 
 	bool SignatureBase::IsValidPartial(const Config& cfg, const Hash::Value& msg, const Scalar* pK, const Point::Native* pPk, const Point::Native& noncePub) const
 	{
-		Mode::Scope scope(Mode::Fast);
-
+		// public data only, variable-time regardless of the current mode
 		Oracle oracle;
 		Expose(oracle, msg);
 
@@ -2228,7 +3095,7 @@ namespace ECC {
 				pBc->AddCasual(pPk[iK], e);
 			else
 			{
-				mm.m_pCasual[iK].Init(pPk[iK]);
+				mm.m_pCasual[iK].InitVar(pPk[iK]);
 				mm.m_pKCasual[iK] = e;
 			}
 		}
@@ -2251,7 +3118,7 @@ namespace ECC {
 		}
 
 		Point::Native pt;
-		mm.Calculate(pt);
+		mm.CalculateVar(pt);
 
 		pt += noncePub;
 		return pt == Zero;
@@ -49,8 +49,7 @@ namespace ECC {
 	void InnerProduct::BatchContext::Calculate()
 	{
 		Point::Native res;
-		Mode::Scope scope(Mode::Fast);
-		MultiMac::Calculate(res);
+		MultiMac::CalculateVar(res); // verification only, no secret data
 
 		m_Sum += res;
 	}
@@ -81,7 +80,7 @@ namespace ECC {
 		if (!bPremultiplied)
 			m_pKCasual[m_Casual] *= m_Multiplier;
 
-		m_pCasual[m_Casual++].Init(pt);
+		m_pCasual[m_Casual++].InitVar(pt);
 
 	}
 
@@ -0,0 +1,51 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ecc_native.h"
+#include <iostream>
+
+// Writes the precomputed ECC::Context blob, to be mapped by the processes at runtime (see ECC::Context::Map)
+int main(int argc, char* argv[])
+{
+	if (argc != 2)
+	{
+		std::cout << "Usage: " << argv[0] << " <output file>" << std::endl;
+		return 1;
+	}
+
+	const ECC::Context& ctx = ECC::Context::get();
+	std::cout << "Checksum: " << ctx.m_hvChecksum.str() << std::endl;
+
+	ECC::Hash::Value hv;
+	ctx.get_DataHash(hv);
+	std::cout << "Data: " << hv.str() << std::endl;
+
+	try
+	{
+		ECC::Context::Export(argv[1]);
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "Export failed: " << e.what() << std::endl;
+		return 1;
+	}
+
+	if (!ECC::Context::Map(argv[1]))
+	{
+		std::cout << "The blob doesn't match this build" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
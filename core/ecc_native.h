@@ -353,7 +353,11 @@ namespace ECC
 				AlignedBuf<Fast> F;
 			} U;
 
-			void Init(const Point::Native&);
+			void Init(const Point::Native&); // according to the current mode
+			void InitVar(const Point::Native&); // for CalculateVar()
+
+		private:
+			template <Mode::Enum> void InitT(const Point::Native&);
 		};
 
 		struct Prepared
@@ -405,14 +409,21 @@ namespace ECC
 
 		Reuse::Enum m_ReuseFlag;
 
+		// In fast mode casual points above this count (and with no reuse) are summed by the bucket (Pippenger) method instead of the interleaved wNAF.
+		// It needs fewer additions per point as the batch grows, but has a fixed cost per window, which dominates for small batches.
+		static uint32_t s_PippengerThreshold;
+
 		MultiMac() { Reset(); }
 
 		void Reset();
-		void Calculate(Point::Native&) const;
+		void Calculate(Point::Native&) const; // according to the current mode
+		void CalculateVar(Point::Native&) const; // variable-time regardless of the current mode, for public data only. Casual points must be set by InitVar()
 
 	private:
 
 		struct Normalizer;
+		void CalculateBuckets(Point::Native&) const;
+		template <Mode::Enum> void CalculateT(Point::Native&) const;
 	};
 
 	template <int nMaxCasual, int nMaxPrepared>
@@ -442,6 +453,13 @@ namespace ECC
 			assert(m_Prepared <= nMaxPrepared);
 			MultiMac::Calculate(res);
 		}
+
+		void CalculateVar(Point::Native& res)
+		{
+			assert(m_Casual <= nMaxCasual);
+			assert(m_Prepared <= nMaxPrepared);
+			MultiMac::CalculateVar(res);
+		}
 	};
 
 	struct ScalarGenerator
@@ -465,6 +483,8 @@ namespace ECC
 	};
 
 
+	struct Context;
+
 	namespace Generator
 	{
 		static const uint32_t nBitsPerLevel = 4;
@@ -473,6 +493,7 @@ namespace ECC
 		template <uint32_t nBits_>
 		class Base
 		{
+			friend struct ECC::Context;
 		protected:
 			static const uint32_t nLevels = nBits_ / nBitsPerLevel;
 			static_assert(nLevels * nBitsPerLevel == nBits_, "");
@@ -481,13 +502,16 @@ namespace ECC
 		};
 
 		void GeneratePts(const Point::Native&, Oracle&, Point::Compact* pPts, uint32_t nLevels, Point::Compact::Converter&);
-		void SetMul(Point::Native& res, bool bSet, const Point::Compact* pPts, const Scalar::Native::uint* p, int nWords);
+		void SetMul(Point::Native& res, bool bSet, const Point::Compact* pPts, const Scalar::Native::uint* p, int nWords); // according to the current mode
+		void SetMulVar(Point::Native& res, bool bSet, const Point::Compact* pPts, const Scalar::Native::uint* p, int nWords); // variable-time, public data only
 
+		// Multiplication by a generator. operator * works according to the current mode, whereas MulVar() is always variable-time
+		// (no blinding and no constant-time table lookups). MulVar() must only be used with public data, i.e. in verification.
 		template <uint32_t nBits_>
 		class Simple
 			:public Base<nBits_>
 		{
-			template <typename T>
+			template <typename T, bool bVar>
 			struct Mul
 			{
 				const Simple& me;
@@ -511,9 +535,13 @@ namespace ECC
 					for (int i = nWordsSrc; i < nWords; i++)
 						p[i] = 0;
 
-					Generator::SetMul(res, bSet, me.m_pPts, p, nWords);
-
-					SecureErase(p, sizeof(Scalar::Native::uint) * nWordsSrc);
+					if (bVar)
+						Generator::SetMulVar(res, bSet, me.m_pPts, p, nWords);
+					else
+					{
+						Generator::SetMul(res, bSet, me.m_pPts, p, nWords);
+						SecureErase(p, sizeof(Scalar::Native::uint) * nWordsSrc);
+					}
 				}
 			};
 
@@ -524,16 +552,21 @@ namespace ECC
 			}
 
 			template <typename TScalar>
-			Mul<TScalar> operator * (const TScalar& k) const { return Mul<TScalar>(*this, k); }
+			Mul<TScalar, false> operator * (const TScalar& k) const { return Mul<TScalar, false>(*this, k); }
+
+			template <typename TScalar>
+			Mul<TScalar, true> MulVar(const TScalar& k) const { return Mul<TScalar, true>(*this, k); }
 		};
 
 		class Obscured
 			:public Base<nBits>
 		{
+			friend struct ECC::Context;
+
 			Point::Compact m_AddPt;
 			Scalar::Native m_AddScalar;
 
-			template <typename TScalar>
+			template <typename TScalar, bool bVar>
 			struct Mul
 			{
 				const Obscured& me;
@@ -544,12 +577,16 @@ namespace ECC
 			};
 
 			void AssignInternal(Point::Native& res, bool bSet, Scalar::Native& kTmp, const Scalar::Native&) const;
+			void AssignInternalVar(Point::Native& res, bool bSet, const Scalar::Native&) const;
 
 		public:
 			void Initialize(const Point::Native&, Oracle&, Point::Compact::Converter&);
 
 			template <typename TScalar>
-			Mul<TScalar> operator * (const TScalar& k) const { return Mul<TScalar>(*this, k); }
+			Mul<TScalar, false> operator * (const TScalar& k) const { return Mul<TScalar, false>(*this, k); }
+
+			template <typename TScalar>
+			Mul<TScalar, true> MulVar(const TScalar& k) const { return Mul<TScalar, true>(*this, k); }
 		};
 
 	} // namespace Generator
@@ -595,6 +632,16 @@ namespace ECC
 
 		void Reset();
 
+		// SHA-256 engines, selected at startup wrt the CPU: hardware (SHA-NI, ARMv8 SHA2), and SIMD lanes (AVX2) for the multi-buffer finalization.
+		// Can be turned off in runtime, the portable implementation is the fallback.
+		static bool s_UseHw;
+		static bool s_UseSimd;
+		static bool IsHwSupported();
+		static bool IsSimdSupported();
+
+		// Finalize several independent instances at once (any data sizes). Hashing many short messages this way is faster with SIMD lanes
+		static void FinalizeMulti(Processor*, Value*, uint32_t nCount);
+
 		template <typename T>
 		Processor& operator << (const T& t) { Write(t); return *this; }
 
@@ -809,6 +856,13 @@ namespace ECC
 
 		Hash::Value m_hvChecksum; // all the generators and signature version. In case we change seed strings or formula
 
+		// Precomputed context blob, generated at build time (ecc-context-gen).
+		// If BEAM_ECC_CONTEXT env variable points to it - it's mapped read-only on startup (shared by all the processes), instead of being calculated.
+		static void Export(const char* szPath); // throws on error
+		static const Context* Map(const char* szPath); // returns nullptr if the blob is missing or doesn't match this build. The mapping is never released
+
+		void get_DataHash(Hash::Value&) const; // all the precomputed points and scalars, in a platform-independent form. Must match the one expected by this build
+
 	private:
 		Context() {}
 	};
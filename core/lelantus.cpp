@@ -14,6 +14,7 @@
 
 #include "lelantus.h"
 #include "../utility/executor.h"
+#include <mutex>
 
 namespace beam {
 
@@ -113,25 +114,22 @@ void CmList::Import(MultiMac& mm, uint32_t iPos, uint32_t nCount)
 			break;
 
 		comm.Import(pt_s, false);
-		mm.m_pCasual[mm.m_Casual].Init(comm);
+		mm.m_pCasual[mm.m_Casual].InitVar(comm); // the list is public
 	}
 }
 
-void CmList::Calculate(Point::Native& res, uint32_t iPos, uint32_t nCount, const Scalar::Native* pKs)
+template <int nMaxCasual>
+void CalculateNaggled(CmList& lst, MultiMac_WithBufs<nMaxCasual, 1>& mm, Point::Native& res, uint32_t iPos, uint32_t nCount, const Scalar::Native* pKs)
 {
-	Mode::Scope scope(Mode::Fast);
-
-	const uint32_t nSizeNaggle = 128;
-	MultiMac_WithBufs<nSizeNaggle, 1> mm;
-
+	const uint32_t nSizeNaggle = nMaxCasual;
 	Point::Native comm;
 
 	while (true)
 	{
-		Import(mm, iPos, std::min(nSizeNaggle, nCount));
+		lst.Import(mm, iPos, std::min(nSizeNaggle, nCount));
 		mm.m_pKCasual = Cast::NotConst(pKs + iPos);
 
-		mm.Calculate(comm);
+		mm.CalculateVar(comm);
 		res += comm;
 
 		iPos += mm.m_Casual;
@@ -142,6 +140,71 @@ void CmList::Calculate(Point::Native& res, uint32_t iPos, uint32_t nCount, const
 	}
 }
 
+void CmList::Calculate(Point::Native& res, uint32_t iPos, uint32_t nCount, const Scalar::Native* pKs)
+{
+	if (nCount < MultiMac::s_PippengerThreshold)
+	{
+		MultiMac_WithBufs<128, 1> mm;
+		CalculateNaggled(*this, mm, res, iPos, nCount, pKs);
+	}
+	else
+	{
+		// large batches, let the MultiMac use the bucket method. Too large for the stack
+		std::unique_ptr<MultiMac_WithBufs<1024, 1> > pMm = std::make_unique<MultiMac_WithBufs<1024, 1> >();
+		CalculateNaggled(*this, *pMm, res, iPos, nCount, pKs);
+	}
+}
+
+///////////////////////////
+// CmListCache
+void CmListCache::SetWindow(CmList& src, uint64_t nPos0, uint32_t nCount)
+{
+	if ((&src != m_pSrc) || (nPos0 != m_Pos0) || (nCount != m_vec.size()))
+	{
+		m_vec.resize(nCount);
+		if (m_vState.size() != nCount)
+			m_vState = std::vector<std::atomic<uint8_t> >(nCount);
+
+		Reset();
+	}
+
+	m_pSrc = &src;
+	m_Pos0 = nPos0;
+}
+
+void CmListCache::Reset()
+{
+	for (std::atomic<uint8_t>& x : m_vState)
+		x.store(State::Empty, std::memory_order_relaxed);
+}
+
+bool CmListCache::get_At(Point::Storage& res, uint32_t iIdx)
+{
+	assert(m_pSrc);
+	if (iIdx >= m_vec.size())
+		return m_pSrc->get_At(res, iIdx); // outside the window
+
+	std::atomic<uint8_t>& st = m_vState[iIdx];
+	if (State::Valid == st.load(std::memory_order_acquire))
+	{
+		res = m_vec[iIdx];
+		return true;
+	}
+
+	if (!m_pSrc->get_At(res, iIdx))
+		return false;
+
+	// publish it, unless another thread is already at it
+	uint8_t nState = State::Empty;
+	if (st.compare_exchange_strong(nState, State::Busy, std::memory_order_acquire))
+	{
+		m_vec[iIdx] = res;
+		st.store(State::Valid, std::memory_order_release);
+	}
+
+	return true;
+}
+
 ///////////////////////////
 // Cfg
 uint32_t Cfg::get_N() const
@@ -590,7 +653,7 @@ void Prover::ExtractG_Part(GB* pGB, uint32_t i0, uint32_t i1)
 			for (uint32_t i = 0; i < static_cast<uint32_t>(mm.m_Casual); i++)
 				gb.m_kBias += pP[i0 + i];
 
-			mm.Calculate(comm);
+			mm.CalculateVar(comm);
 			gb.m_G += comm;
 
 			mm.m_ReuseFlag = MultiMac::Reuse::UseGenerated;
@@ -605,6 +668,39 @@ void Prover::ExtractG_Part(GB* pGB, uint32_t i0, uint32_t i1)
 	}
 }
 
+uint32_t Prover::s_DedicatedThreads = 0;
+
+struct DedicatedExecutor
+	:public ExecutorMT
+{
+	uint32_t m_Threads;
+	std::mutex m_mxUse; // ExecAll is not designed for concurrent callers
+
+	DedicatedExecutor()
+	{
+		m_Threads = Prover::s_DedicatedThreads;
+		if (!m_Threads)
+			m_Threads = std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	~DedicatedExecutor() { Stop(); }
+
+	virtual uint32_t get_Threads() override { return m_Threads; }
+
+	virtual void RunThread(uint32_t iThread) override
+	{
+		ExecutorMT::Context ctx;
+		ctx.m_iThread = iThread;
+		RunThreadCtx(ctx);
+	}
+
+	static DedicatedExecutor& get()
+	{
+		static DedicatedExecutor s_Ex;
+		return s_Ex;
+	}
+};
+
 void Prover::ExtractG(const Point::Native& ptBias)
 {
 	struct MyTask
@@ -629,13 +725,26 @@ void Prover::ExtractG(const Point::Native& ptBias)
 
 	} t;
 
-	uint32_t nThreads = Executor::s_pInstance ? Executor::s_pInstance->get_Threads() : 1;
+	Executor* pExec = Executor::s_pInstance;
+	std::unique_lock<std::mutex> lockDedicated;
+
+	if (!pExec && (1 != s_DedicatedThreads) && (m_Cfg.get_N() >= s_DedicatedMinN))
+	{
+		DedicatedExecutor& ex = DedicatedExecutor::get();
+		if (ex.m_Threads > 1)
+		{
+			lockDedicated = std::unique_lock<std::mutex>(ex.m_mxUse);
+			pExec = &ex;
+		}
+	}
+
+	uint32_t nThreads = pExec ? pExec->get_Threads() : 1;
 	t.m_vGB.resize(nThreads * m_Cfg.M);
 	t.m_pThis = this;
 
-	if (Executor::s_pInstance)
+	if (pExec)
 	{
-		Executor::s_pInstance->ExecAll(t);
+		pExec->ExecAll(t);
 
 		for (uint32_t i = 1; i < nThreads; i++)
 		{
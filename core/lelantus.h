@@ -14,6 +14,7 @@
 
 #pragma once
 #include "ecc_native.h"
+#include <atomic>
 
 namespace beam {
 namespace Sigma {
@@ -40,6 +41,31 @@ namespace Sigma {
 		}
 	};
 
+	// Caches the elements of the source list, for consecutive proofs against the same window.
+	// The window is identified by its start position (in the caller's terms), the cached elements are dropped once it changes.
+	// Missing elements are not cached (the window may be filled later).
+	// get_At may be called concurrently (from the executor threads), SetWindow and Reset - only when it's not in use.
+	struct CmListCache
+		:public CmList
+	{
+		void SetWindow(CmList& src, uint64_t nPos0, uint32_t nCount);
+		void Reset();
+
+		virtual bool get_At(ECC::Point::Storage& res, uint32_t iIdx) override;
+
+	private:
+		CmList* m_pSrc = nullptr;
+		uint64_t m_Pos0 = 0;
+		std::vector<ECC::Point::Storage> m_vec; // pre-sized to the window, never resized during use
+		std::vector<std::atomic<uint8_t> > m_vState; // per element, published with release semantics
+
+		struct State {
+			static const uint8_t Empty = 0;
+			static const uint8_t Busy = 1; // being written by some thread
+			static const uint8_t Valid = 2;
+		};
+	};
+
 	struct Cfg
 	{
 		// bitness selection
@@ -146,6 +172,11 @@ namespace Sigma {
 
 		void Generate(const ECC::uintBig& seed, ECC::Oracle& oracle, const ECC::Point::Native& ptBias);
 
+		// If the caller didn't install an Executor (typically the wallet), big lists are processed on a dedicated thread pool, created on demand.
+		// Number of threads: 0 - all the cores, 1 - don't use the pool. Must be set before the first use.
+		static uint32_t s_DedicatedThreads;
+		static const uint32_t s_DedicatedMinN = 256;
+
 		// result
 		Proof& m_Proof;
 	};
@@ -156,6 +187,7 @@ namespace Lelantus
 {
 	typedef Sigma::CmList CmList;
 	typedef Sigma::CmListVec CmListVec;
+	typedef Sigma::CmListCache CmListCache;
 	typedef Sigma::Cfg Cfg;
 
 	namespace SpendKey {
@@ -68,6 +68,7 @@ namespace beam
 #endif // WIN32
 
 		m_nBanks = 0;
+		m_Flags = 0;
 	}
 
 	void MappedFile::ResetVarsMapping()
@@ -115,7 +116,7 @@ namespace beam
 		ResetVarsFile();
 	}
 
-	void MappedFile::OpenMapping()
+	void MappedFile::OpenMapping(bool bPrefault /* = false */)
 	{
 		assert(!m_pMapping);
 
@@ -139,12 +140,36 @@ namespace beam
 
 		if (m_nMapping)
 		{
-			uint8_t* pPtr = (uint8_t*) mmap(NULL, m_nMapping, PROT_READ | PROT_WRITE, MAP_SHARED, m_hFile, 0);
+			int nMapFlags = MAP_SHARED;
+#ifdef MAP_POPULATE
+			if (bPrefault && (Flags::Prefault & m_Flags))
+				nMapFlags |= MAP_POPULATE;
+#endif // MAP_POPULATE
+
+			uint8_t* pPtr = (uint8_t*) mmap(NULL, m_nMapping, PROT_READ | PROT_WRITE, nMapFlags, m_hFile, 0);
 			test_SysRet(MAP_FAILED == pPtr, "mmap");
 
 			m_pMapping = pPtr;
+			AdviseMapping(bPrefault);
 		}
 
+#endif // WIN32
+	}
+
+	void MappedFile::AdviseMapping(bool bPrefault)
+	{
+		// Only hints. Failures are ignored: huge pages for regular file mappings depend on the kernel config and the filesystem
+		// (MAP_HUGETLB is for hugetlbfs/anonymous memory only, hence not used here).
+#ifndef WIN32
+#	ifdef MADV_HUGEPAGE
+		if (Flags::HugePages & m_Flags)
+			madvise(m_pMapping, m_nMapping, MADV_HUGEPAGE);
+#	endif // MADV_HUGEPAGE
+
+#	ifndef MAP_POPULATE
+		if (bPrefault && (Flags::Prefault & m_Flags))
+			madvise(m_pMapping, m_nMapping, MADV_WILLNEED);
+#	endif // MAP_POPULATE
 #endif // WIN32
 	}
 
@@ -202,9 +227,10 @@ namespace beam
 #endif // WIN32
 	}
 
-	void MappedFile::Open(const char* sz, const Defs& d, bool bReset /* = false */)
+	void MappedFile::Open(const char* sz, const Defs& d, bool bReset /* = false */, uint32_t nFlags /* = 0 */)
 	{
 		Close();
+		m_Flags = nFlags;
 
 		if (!s_PageSize)
 		{
@@ -225,25 +251,37 @@ namespace beam
 		test_SysRet(-1 == m_hFile, "open");
 #endif // WIN32
 
-		OpenMapping();
+		OpenMapping(true); // prefault the existing image only once. Not on growth, the new space is zero-filled anyway
 
-		uint32_t nSizeMin = d.get_SizeMin();
-		if (bReset || (m_nMapping < nSizeMin) || memcmp(d.m_pSig, m_pMapping, d.m_nSizeSig))
-		{
-			bool bShouldZeroInit = (m_nMapping > d.m_nSizeSig);
-			CloseMapping();
+		if (bReset || (m_nMapping < d.get_SizeMin()) || memcmp(d.m_pSig, m_pMapping, d.m_nSizeSig))
+			Reset(d);
 
-			if (bShouldZeroInit)
-				Resize(d.m_nSizeSig); // will zero-init all this data
+		m_nBank0 = d.get_Bank0();
+		m_nBanks = d.m_nBanks;
+	}
 
-			Resize(nSizeMin);
+	void MappedFile::Reset(const Defs& d)
+	{
+		bool bShouldZeroInit = (m_nMapping > d.m_nSizeSig);
+		CloseMapping();
 
-			OpenMapping();
-			memcpy(m_pMapping, d.m_pSig, d.m_nSizeSig);
-		}
+		if (bShouldZeroInit)
+			Resize(d.m_nSizeSig); // will zero-init all this data
 
-		m_nBank0 = d.get_Bank0();
-		m_nBanks = d.m_nBanks;
+		Resize(d.get_SizeMin());
+
+		OpenMapping();
+		memcpy(m_pMapping, d.m_pSig, d.m_nSizeSig);
+	}
+
+	void MappedFile::SetSize(Offset n)
+	{
+		if (n == m_nMapping)
+			return;
+
+		CloseMapping();
+		Resize(n);
+		OpenMapping();
 	}
 
 	void* MappedFile::get_FixedHdr() const
@@ -264,21 +302,41 @@ namespace beam
 		return ((Bank*) (m_pMapping + m_nBank0))[iBank];
 	}
 
+	const MappedFile::Bank& MappedFile::get_BankInfo(uint32_t iBank) const
+	{
+		return Cast::NotConst(this)->get_Bank(iBank);
+	}
+
+	MappedFile::Offset MappedFile::get_GrowSize(Offset nNeeded) const
+	{
+		// grow geometrically, but moderately: the whole arena goes to a single bank
+		Offset n = m_nMapping >> 4;
+		std::setmin(n, s_ArenaMax);
+		std::setmax(n, s_PageSize);
+		std::setmax(n, nNeeded);
+		return n;
+	}
+
 	void MappedFile::EnsureReserve(uint32_t iBank, uint32_t nSize, uint32_t nMinFree)
 	{
-		while (get_Bank(iBank).m_Free < nMinFree)
+		nSize = AlignUp(nSize, sizeof(Offset));
+
+		while (true)
 		{
-			// grow
-			Offset n0 = m_nMapping;
-			Offset n1 = AlignUp(n0, s_PageSize) + s_PageSize;
+			uint64_t nFree = get_Bank(iBank).m_Free;
+			if (nFree >= nMinFree)
+				break;
 
-			nSize = AlignUp(nSize, sizeof(Offset));
+			// grow. Each arena is contiguous, items are allocated from it in ascending order
+			Offset n0 = m_nMapping;
+			Offset n1 = AlignUp(n0 + get_GrowSize((nMinFree - nFree) * nSize), s_PageSize);
 
 			CloseMapping();
 			Resize(n1);
 			OpenMapping();
 
 			Bank& b = get_Bank(iBank);
+			Offset nTailPrev = b.m_Tail; // the new arena is prepended to the remaining free items
 			Offset* p = &b.m_Tail;
 
 			while (true)
@@ -287,15 +345,17 @@ namespace beam
 				if (n0_ > m_nMapping)
 					break;
 
-				assert(!*p);
 				*p = n0;
 				p = &get_At<Offset>(n0);
+				assert(!*p);
 
 				b.m_Total++;
 				b.m_Free++;
 
 				n0 = n0_;
 			}
+
+			*p = nTailPrev;
 		}
 	}
 
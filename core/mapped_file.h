@@ -22,7 +22,6 @@ namespace beam
 	public:
 		typedef uint64_t Offset;
 
-	private:
 		struct Bank
 		{
 			Offset m_Tail;
@@ -30,6 +29,16 @@ namespace beam
 			uint64_t m_Free;
 		};
 
+		struct Flags
+		{
+			static const uint32_t HugePages = 1; // advise the kernel to back the mapping by huge pages (where supported)
+			static const uint32_t Prefault = 2; // populate the existing image upfront on open, instead of faulting it page-by-page
+		};
+
+		static const uint32_t s_ArenaMax = 4 * 1024 * 1024; // max growth step
+
+	private:
+
 		static uint32_t s_PageSize;
 
 #ifdef WIN32
@@ -43,15 +52,18 @@ namespace beam
 		uint8_t* m_pMapping;
 		uint32_t m_nBank0;
 		uint32_t m_nBanks;
+		uint32_t m_Flags;
 
 		void ResetVarsFile();
 		void ResetVarsMapping();
 		void CloseMapping();
-		void OpenMapping();
+		void OpenMapping(bool bPrefault = false);
 		//void Write(const void*, uint32_t);
 		//void WriteZero(uint32_t);
 		void Resize(Offset);
 		Bank& get_Bank(uint32_t iBank);
+		void AdviseMapping(bool bPrefault);
+		Offset get_GrowSize(Offset nNeeded) const;
 
 	public:
 
@@ -69,7 +81,9 @@ namespace beam
 			uint32_t get_SizeMin() const;
 		};
 
-		void Open(const char* sz, const Defs&, bool bReset = false);
+		void Open(const char* sz, const Defs&, bool bReset = false, uint32_t nFlags = 0);
+		void Reset(const Defs&); // discard all the data, shrink the file to the minimum
+		void SetSize(Offset); // raw resize, the data is preserved (up to the new size). Remaps the file
 		void Close();
 
 		void* get_FixedHdr() const;
@@ -82,10 +96,13 @@ namespace beam
 
 		Offset get_Offset(const void* p) const;
 		const uint8_t* get_Base() const { return m_pMapping; }
+		Offset get_Size() const { return m_nMapping; }
+		const Bank& get_BankInfo(uint32_t iBank) const;
 
 		void* Allocate(uint32_t iBank, uint32_t nSize);
 		void Free(uint32_t iBank, void*);
 
+		// Grows the file in arenas (up to s_ArenaMax, or more if nMinFree demands), all the new items go contiguously to the specified bank
 		void EnsureReserve(uint32_t iBank, uint32_t nSize, uint32_t nMinFree);
 	};
 
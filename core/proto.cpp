@@ -17,6 +17,7 @@
 #include "core/ecc_native.h"
 #include "proto.h"
 #include "../utility/logger.h"
+#include <mutex>
 
 namespace beam {
 namespace proto {
@@ -76,18 +77,28 @@ void ProtocolPlus::get_HMac(ECC::Hash::Mac& hm, MacValue& res)
 
 void ProtocolPlus::Encrypt(SerializedMsg& sm, MsgSerializer& ser)
 {
-    MacValue hmac;
+    if (Finalize(sm, ser))
+        Seal(sm, m_Enc, m_CipherOut, m_HMac);
+}
 
-    if (Mode::Plaintext != m_Mode)
+bool ProtocolPlus::Finalize(SerializedMsg& sm, MsgSerializer& ser)
+{
+    bool bSeal = (Mode::Plaintext != m_Mode);
+    if (bSeal)
     {
         // 1. append dummy of the needed size
-        hmac = Zero;
+        MacValue hmac = Zero;
         ser & hmac;
     }
 
     ser.finalize(sm);
+    return bSeal;
+}
+
+void ProtocolPlus::Seal(SerializedMsg& sm, const AES::Encoder& enc, AES::StreamCipher& cOut, const ECC::Hash::Mac& hmOrg)
+{
+    MacValue hmac;
 
-    if (Mode::Plaintext != m_Mode)
     {
         // 2. get size
         size_t n = 0;
@@ -96,7 +107,7 @@ void ProtocolPlus::Encrypt(SerializedMsg& sm, MsgSerializer& ser)
             n += sm[i].size;
 
         // 3. Calculate
-        ECC::Hash::Mac hm = m_HMac;
+        ECC::Hash::Mac hm = hmOrg;
         size_t n2 = n - MacValue::nBytes;
 
         for (size_t i = 0; ; i++)
@@ -134,7 +145,7 @@ void ProtocolPlus::Encrypt(SerializedMsg& sm, MsgSerializer& ser)
 
             n2 -= iov.size;
 
-            m_CipherOut.XCrypt(m_Enc, dst, (uint32_t) iov.size);
+            cOut.XCrypt(enc, dst, (uint32_t) iov.size);
         }
     }
 }
@@ -292,6 +303,376 @@ bool NotCalled_VerifyNoDuplicatedIDs(uint32_t id)
     return false;
 }
 
+/////////////////////////
+// IoPool
+void IoPool::Queue::Init(io::Reactor& r)
+{
+    m_pEvt = io::AsyncEvent::create(r, [this]() { Flush(); });
+}
+
+void IoPool::Queue::Post(Task::Ptr&& p)
+{
+    if (m_Tasks.Push(*p.release()))
+        m_pEvt->post();
+}
+
+void IoPool::Queue::Flush()
+{
+    // don't starve the rest of the reactor events
+    for (uint32_t i = 0; i < 1024; i++)
+    {
+        Task* p = m_Tasks.Pop();
+        if (!p)
+            return;
+
+        Task::Ptr pGuard(p);
+        p->Exec();
+    }
+
+    m_pEvt->post(); // there may be more
+}
+
+void IoPool::Queue::Clear()
+{
+    while (true)
+    {
+        Task* p = m_Tasks.Pop();
+        if (!p)
+            break;
+        delete p;
+    }
+}
+
+void IoPool::Thread::Run()
+{
+    io::Reactor::Scope scope(*m_pReactor);
+    m_pReactor->run();
+}
+
+void IoPool::Start(uint32_t nThreads)
+{
+    assert(!IsRunning() && nThreads);
+
+    m_Owner.Init(io::Reactor::get_Current());
+
+    m_vThreads.resize(nThreads);
+    for (uint32_t i = 0; i < nThreads; i++)
+    {
+        m_vThreads[i] = std::make_unique<Thread>();
+        Thread& t = *m_vThreads[i];
+
+        t.m_Connections = 0;
+        t.m_pReactor = io::Reactor::create();
+        t.m_Queue.Init(*t.m_pReactor);
+        t.m_Thread = std::thread(&Thread::Run, &t);
+    }
+}
+
+void IoPool::Stop()
+{
+    if (!IsRunning())
+        return;
+
+    for (size_t i = 0; i < m_vThreads.size(); i++)
+    {
+        // after the pending tasks (closing connections)
+        io::Reactor::Ptr pReactor = m_vThreads[i]->m_pReactor;
+        m_vThreads[i]->m_Queue.Post(MakeTask([pReactor]() { pReactor->stop(); }));
+    }
+
+    for (size_t i = 0; i < m_vThreads.size(); i++)
+    {
+        Thread& t = *m_vThreads[i];
+        t.m_Thread.join();
+        t.m_Queue.Clear();
+        t.m_Queue.m_pEvt.reset();
+    }
+
+    m_vThreads.clear();
+
+    m_Owner.Clear();
+    m_Owner.m_pEvt.reset();
+}
+
+IoPool::Thread& IoPool::get_Thread()
+{
+    assert(IsRunning());
+
+    Thread* pRes = m_vThreads.front().get();
+    for (size_t i = 1; i < m_vThreads.size(); i++)
+        if (m_vThreads[i]->m_Connections < pRes->m_Connections)
+            pRes = m_vThreads[i].get();
+
+    return *pRes;
+}
+
+/////////////////////////
+// NodeConnection::IoLink
+// Shared by the owner and the I/O thread. The I/O thread accesses the owner (its protocol state and handlers) only under the mutex,
+// and only while it's attached. The owner detaches it (under the mutex) on Reset.
+struct NodeConnection::IoLink
+    :public std::enable_shared_from_this<IoLink>
+{
+    IoPool& m_Pool;
+    IoPool::Thread& m_Thread;
+
+    std::mutex m_Mutex;
+    NodeConnection* m_pOwner;
+
+    // I/O thread
+    uv_os_sock_t m_Sock;
+    bool m_bSockPending;
+    io::TcpStream::Ptr m_pStream;
+    std::unique_ptr<MsgReader> m_pReader;
+    bool m_bFailed = false;
+    bool m_bBarrier = false; // waiting for the owner to process the msg that modifies the protocol state
+    bool m_bBacklog = false; // too many msgs wait for the owner
+
+    // outgoing cipher, owned by the I/O thread once the owner initialized it
+    AES::Encoder m_Enc;
+    AES::StreamCipher m_CipherOut;
+    ECC::Hash::Mac m_HMac;
+
+    std::atomic<size_t> m_Queued; // posted for write, not handed to the stream yet
+    std::atomic<size_t> m_StreamUnsent;
+    std::atomic<uint64_t> m_StreamDrainRate;
+    std::atomic<uint32_t> m_InFlight; // posted to the owner, not handled yet
+
+    static const uint32_t s_InFlightMax = 256;
+    static const uint32_t s_InFlightResume = 64;
+
+    IoLink(IoPool& pool, NodeConnection& owner, uv_os_sock_t sock)
+        :m_Pool(pool)
+        ,m_Thread(pool.get_Thread())
+        ,m_pOwner(&owner)
+        ,m_Sock(sock)
+        ,m_bSockPending(true)
+        ,m_Queued(0)
+        ,m_StreamUnsent(0)
+        ,m_StreamDrainRate(0)
+        ,m_InFlight(0)
+    {
+        m_Thread.m_Connections++;
+    }
+
+    ~IoLink()
+    {
+        if (m_bSockPending)
+            io::Reactor::close_socket(m_Sock); // never attached
+    }
+
+    template <typename TFunc>
+    void PostIo(TFunc&& f)
+    {
+        std::shared_ptr<IoLink> pThis = shared_from_this();
+        m_Thread.m_Queue.Post(IoPool::MakeTask([pThis, f = std::move(f)]() mutable { f(*pThis); }));
+    }
+
+    template <typename TFunc>
+    void PostOwner(TFunc&& f)
+    {
+        std::shared_ptr<IoLink> pThis = shared_from_this();
+        m_Pool.m_Owner.Post(IoPool::MakeTask([pThis, f = std::move(f)]() mutable
+        {
+            NodeConnection* pOwner = pThis->m_pOwner; // only the owner thread modifies it
+            if (pOwner)
+                f(*pOwner);
+        }));
+    }
+
+    static bool IsBarrier(uint8_t code)
+    {
+        // the following modify the incoming protocol state, nothing after them can be processed before the owner handles them
+        switch (code)
+        {
+        case SChannelInitiate::s_Code:
+        case SChannelReady::s_Code:
+            return true;
+        }
+        return false;
+    }
+
+    // owner thread
+    void Detach()
+    {
+        {
+            std::scoped_lock<std::mutex> scope(m_Mutex);
+            m_pOwner = nullptr;
+        }
+
+        PostIo([](IoLink& x) { x.Close(); });
+    }
+
+    size_t get_Unsent() const
+    {
+        return m_Queued + m_StreamUnsent;
+    }
+
+    void PostWrite(SerializedMsg&& sm, bool bSeal)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < sm.size(); i++)
+            n += sm[i].size;
+
+        m_Queued += n;
+        PostIo([sm = std::move(sm), bSeal, n](IoLink& x) mutable { x.Write(sm, bSeal, n); });
+    }
+
+    void PostCipherOut(const ProtocolPlus& p)
+    {
+        PostIo([enc = p.m_Enc, cOut = p.m_CipherOut, hm = p.m_HMac](IoLink& x)
+        {
+            x.m_Enc = enc;
+            x.m_CipherOut = cOut;
+            x.m_HMac = hm;
+        });
+    }
+
+    template <typename TMsg>
+    void OnMsgOwner(NodeConnection& owner, TMsg& msg, bool bBarrier)
+    {
+        owner.OnMsgSafe(std::move(msg)); // may delete the owner
+
+        uint32_t n = m_InFlight--;
+        if (bBarrier || (s_InFlightResume + 1 == n))
+            PostIo([bBarrier](IoLink& x) { x.Resume(bBarrier); });
+    }
+
+    // I/O thread
+    void Attach()
+    {
+        m_bSockPending = false;
+
+        io::Result res = m_Thread.m_pReactor->attach_tcpstream(m_Sock, m_pStream);
+        if (res)
+        {
+            std::scoped_lock<std::mutex> scope(m_Mutex);
+            if (!m_pOwner)
+                return;
+
+            m_pReader = std::make_unique<MsgReader>(m_pOwner->m_Protocol, uint64_t(m_pOwner), 100);
+            res = m_pStream->enable_read([this](io::ErrorCode err, void* p, size_t n) { return OnRead(err, p, n); });
+        }
+
+        if (!res)
+            Fail(res.error());
+    }
+
+    void Close()
+    {
+        m_pReader.reset();
+        m_pStream.reset();
+        m_Thread.m_Connections--;
+    }
+
+    void Fail(io::ErrorCode err)
+    {
+        if (m_bFailed)
+            return;
+        m_bFailed = true;
+
+        PostOwner([err](NodeConnection& owner)
+        {
+            owner.Reset();
+            owner.OnIoErr(err);
+        });
+    }
+
+    void UpdateStreamState()
+    {
+        const io::TcpStream::State& s = m_pStream->state();
+        m_StreamUnsent = s.unsent;
+        m_StreamDrainRate = s.drainRate;
+    }
+
+    void Suspend()
+    {
+        m_pReader->pause();
+        m_pStream->suspend_read();
+    }
+
+    bool OnRead(io::ErrorCode err, void* p, size_t n)
+    {
+        std::scoped_lock<std::mutex> scope(m_Mutex);
+        if (!m_pOwner || m_bFailed)
+            return false;
+
+        UpdateStreamState();
+
+        if (!m_pReader->new_data_from_stream(err, p, n))
+        {
+            // the error is already posted to the owner
+            m_bFailed = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    void Resume(bool bBarrier)
+    {
+        std::scoped_lock<std::mutex> scope(m_Mutex);
+        if (!m_pOwner || m_bFailed || !m_pReader)
+            return;
+
+        if (bBarrier)
+            m_bBarrier = false;
+        else
+            m_bBacklog = false;
+
+        if (m_bBarrier || m_bBacklog || !m_pReader->is_paused())
+            return;
+
+        if (!m_pReader->resume())
+        {
+            m_bFailed = true;
+            return;
+        }
+
+        if (!m_pReader->is_paused())
+        {
+            io::Result res = m_pStream->resume_read();
+            if (!res)
+                Fail(res.error());
+        }
+    }
+
+    template <typename TMsg>
+    void PostMsg(TMsg&& msg)
+    {
+        bool bBarrier = IsBarrier(TMsg::s_Code);
+        PostOwner([this, msg = std::move(msg), bBarrier](NodeConnection& owner) mutable { OnMsgOwner(owner, msg, bBarrier); });
+
+        if (bBarrier)
+        {
+            m_bBarrier = true;
+            Suspend();
+        }
+
+        if (++m_InFlight >= s_InFlightMax)
+        {
+            m_bBacklog = true;
+            Suspend();
+        }
+    }
+
+    void Write(SerializedMsg& sm, bool bSeal, size_t n)
+    {
+        m_Queued -= n;
+        if (m_bFailed || !m_pStream)
+            return;
+
+        if (bSeal)
+            ProtocolPlus::Seal(sm, m_Enc, m_CipherOut, m_HMac);
+
+        io::Result res = m_pStream->write(sm);
+        UpdateStreamState();
+
+        if (!res)
+            Fail(res.error());
+    }
+};
+
 /////////////////////////
 // NodeConnection
 NodeConnection::NodeConnection()
@@ -323,6 +704,12 @@ void NodeConnection::Reset()
     m_Connection = NULL;
     m_pAsyncFail = NULL;
 
+    if (m_pIoLink)
+    {
+        m_pIoLink->Detach();
+        m_pIoLink.reset();
+    }
+
     m_Protocol.ResetVars();
 }
 
@@ -419,10 +806,33 @@ void NodeConnection::OnIoErr(io::ErrorCode err)
 
 size_t NodeConnection::get_Unsent() const
 {
+	if (m_pIoLink)
+		return m_pIoLink->get_Unsent();
+
 	return m_Connection ? m_Connection->get_Unsent() : 0;
 }
 
+uint64_t NodeConnection::get_DrainRate() const
+{
+	if (m_pIoLink)
+		return m_pIoLink->m_StreamDrainRate;
+
+	return m_Connection ? m_Connection->get_DrainRate() : 0;
+}
+
 void NodeConnection::on_protocol_error(uint64_t, ProtocolError error)
+{
+    if (m_pIoLink)
+    {
+        // I/O thread
+        m_pIoLink->m_bFailed = true;
+        m_pIoLink->PostOwner([error](NodeConnection& x) { x.OnProtocolErr(error); });
+    }
+    else
+        OnProtocolErr(error);
+}
+
+void NodeConnection::OnProtocolErr(ProtocolError error)
 {
     Reset();
 
@@ -464,8 +874,13 @@ std::ostream& operator << (std::ostream& s, const NodeConnection::DisconnectReas
 
 void NodeConnection::on_connection_error(uint64_t, io::ErrorCode errorCode)
 {
-    Reset();
-    OnIoErr(errorCode);
+    if (m_pIoLink)
+        m_pIoLink->Fail(errorCode); // I/O thread
+    else
+    {
+        Reset();
+        OnIoErr(errorCode);
+    }
 }
 
 void NodeConnection::ThrowUnexpected(const char* sz, NodeProcessingException::Type type)
@@ -475,7 +890,7 @@ void NodeConnection::ThrowUnexpected(const char* sz, NodeProcessingException::Ty
 
 void NodeConnection::Connect(const io::Address& addr, const boost::optional<io::Address> proxyAddr)
 {
-    assert(!m_Connection && !m_ConnectPending);
+    assert(!m_Connection && !m_pIoLink && !m_ConnectPending);
 
     io::Result res;
     if (proxyAddr)
@@ -500,9 +915,23 @@ void NodeConnection::Connect(const io::Address& addr, const boost::optional<io::
 
 void NodeConnection::Accept(io::TcpStream::Ptr&& newStream)
 {
-    assert(!m_Connection && !m_ConnectPending);
+    assert(!m_Connection && !m_pIoLink && !m_ConnectPending);
 
     newStream->enable_keepalive(Rules::get().DA.Target_s); // it should be comparable to the block rate
+    m_Addr = newStream->peer_address();
+
+    if (m_pIoPool && m_pIoPool->IsRunning())
+    {
+        uv_os_sock_t sock;
+        if (newStream->detach_socket(sock))
+        {
+            m_pIoLink = std::make_shared<IoLink>(*m_pIoPool, *this, sock);
+            m_pIoLink->PostIo([](IoLink& x) { x.Attach(); });
+            return;
+        }
+
+        // otherwise keep it on our reactor
+    }
 
     m_Connection = std::make_unique<Connection>(
         m_Protocol,
@@ -515,7 +944,46 @@ void NodeConnection::Accept(io::TcpStream::Ptr&& newStream)
 
 bool NodeConnection::IsLive() const
 {
-    return m_Connection && !m_pAsyncFail;
+    return (m_Connection || m_pIoLink) && !m_pAsyncFail;
+}
+
+void NodeConnection::SendSerialized(MsgSerializer& ser)
+{
+    bool bSeal = m_Protocol.Finalize(m_SerializeCache, ser);
+    SendFinalized(bSeal);
+}
+
+void NodeConnection::SendShared(const io::SharedBuffer& buf, bool bSeal)
+{
+    m_SerializeCache.clear();
+    m_SerializeCache.push_back(buf);
+
+    if (bSeal)
+        m_SerializeCache.back().unique(); // encrypted in-place
+
+    SendFinalized(bSeal);
+}
+
+void NodeConnection::SendFinalized(bool bSeal)
+{
+    if (m_pIoLink)
+    {
+        // mac, encryption and the write are done by the I/O thread
+        m_pIoLink->PostWrite(std::move(m_SerializeCache), bSeal);
+        m_SerializeCache.clear();
+    }
+    else
+    {
+        if (bSeal)
+            ProtocolPlus::Seal(m_SerializeCache, m_Protocol.m_Enc, m_Protocol.m_CipherOut, m_Protocol.m_HMac);
+
+        io::Result res = m_Connection->write_msg(m_SerializeCache);
+        m_SerializeCache.clear();
+
+        TestIoResultAsync(res);
+    }
+
+    TestNotDrown();
 }
 
 #define THE_MACRO(code, msg) \
@@ -525,15 +993,21 @@ void NodeConnection::Send(const msg& v) \
         return; \
     m_SerializeCache.clear(); \
     MsgSerializer& ser = m_Protocol.serializeNoFinalize(m_SerializeCache, uint8_t(code), v); \
-    m_Protocol.Encrypt(m_SerializeCache, ser); \
-    io::Result res = m_Connection->write_msg(m_SerializeCache); \
-    m_SerializeCache.clear(); \
-\
-    TestIoResultAsync(res); \
-    TestNotDrown(); \
+    SendSerialized(ser); \
 } \
 \
 bool NodeConnection::OnMsgInternal(uint64_t, msg##_NoInit&& v) \
+{ \
+    if (m_pIoLink) \
+    { \
+        /* I/O thread */ \
+        m_pIoLink->PostMsg(std::move(v)); \
+        return true; \
+    } \
+    return OnMsgSafe(std::move(v)); \
+} \
+\
+bool NodeConnection::OnMsgSafe(msg&& v) \
 { \
     try { \
         /* checkpoint */ \
@@ -601,6 +1075,9 @@ void NodeConnection::OnMsg(SChannelInitiate&& msg)
     m_Protocol.m_RemoteNonce = msg.m_NoncePub;
     m_Protocol.InitCipher();
 
+    if (m_pIoLink)
+        m_pIoLink->PostCipherOut(m_Protocol); // before any encrypted msg
+
     m_Protocol.m_Mode = ProtocolPlus::Mode::Outgoing;
 
 	Send(proto::GetTime(Zero)); // in the next proto - better to send the time right away, instead of asking for it
@@ -723,25 +1200,25 @@ void NodeConnection::OnLoginInternal(Height hScheme, Login&& msg)
 {
 	if (LoginFlags::ExtensionsBeforeHF1 != (LoginFlags::ExtensionsBeforeHF1 & msg.m_Flags))
 	{
-		LOG_WARNING() << "Peer " << m_Connection->peer_address() << " uses legacy protocol";
+		LOG_WARNING() << "Peer " << m_Addr << " uses legacy protocol";
 		ThrowUnexpected("Legacy", NodeProcessingException::Type::Incompatible);
 	}
 
 	if ((~LoginFlags::Recognized) & msg.m_Flags) {
-		LOG_WARNING() << "Peer " << m_Connection->peer_address() << " Uses newer protocol.";
+		LOG_WARNING() << "Peer " << m_Addr << " Uses newer protocol.";
 	}
 	else
 	{
 		const uint32_t nMask = LoginFlags::ExtensionsAll;
 		uint32_t nFlags2 = nMask & msg.m_Flags;
 		if (nFlags2 != nMask) {
-			LOG_WARNING() << "Peer " << m_Connection->peer_address() << " Uses older protocol: " << nFlags2;
+			LOG_WARNING() << "Peer " << m_Addr << " Uses older protocol: " << nFlags2;
 		}
 	}
 
 	if (hScheme < MaxHeight)
 	{
-		LOG_WARNING() << "Peer " << m_Connection->peer_address() << " incompatible with fork " << (hScheme + 1);
+		LOG_WARNING() << "Peer " << m_Addr << " incompatible with fork " << (hScheme + 1);
 
 		Height hMinScheme = get_MinPeerFork();
 		if (hScheme < hMinScheme)
@@ -21,8 +21,12 @@
 #include "../p2p/connection.h"
 #include "../utility/io/tcpserver.h"
 #include "../utility/io/timer.h"
+#include "../utility/io/asyncevent.h"
+#include "../utility/mpsc_queue.h"
 #include "aes.h"
 #include "block_crypt.h"
+#include "shared_msg.h"
+#include <thread>
 
 namespace beam {
 namespace proto {
@@ -634,6 +638,76 @@ namespace proto {
         virtual bool VerifyMsg(const uint8_t*, uint32_t nSize) override;
 
         void Encrypt(SerializedMsg&, MsgSerializer&);
+
+        // Encrypt() split in 2 phases, the 2nd may be done later (on another thread)
+        bool Finalize(SerializedMsg&, MsgSerializer&); // returns if the msg should be sealed
+        static void Seal(SerializedMsg&, const AES::Encoder&, AES::StreamCipher&, const ECC::Hash::Mac&); // mac + encryption
+    };
+
+    // Dedicated I/O threads for NodeConnections. Each runs its own reactor, which hosts the sockets of the attached connections.
+    // Framing, decryption and mac verification of the incoming messages and their deserialization, as well as the encryption of the
+    // outgoing ones, are done there. Deserialized messages are marshalled to the owner thread, all the handlers are invoked there.
+    struct IoPool
+    {
+        struct Task
+        {
+            typedef std::unique_ptr<Task> Ptr;
+            Task* m_pNext;
+
+            virtual ~Task() {}
+            virtual void Exec() = 0;
+        };
+
+        template <typename TFunc>
+        struct TaskFunc
+            :public Task
+        {
+            TFunc m_Func;
+            TaskFunc(TFunc&& f) :m_Func(std::move(f)) {}
+            virtual void Exec() override { m_Func(); }
+        };
+
+        template <typename TFunc>
+        static Task::Ptr MakeTask(TFunc&& f)
+        {
+            return std::make_unique<TaskFunc<std::decay_t<TFunc> > >(std::move(f));
+        }
+
+        // lock-free, multiple producers, consumed by the reactor of the event
+        struct Queue
+        {
+            MpscQueue<Task> m_Tasks;
+            io::AsyncEvent::Ptr m_pEvt;
+
+            void Init(io::Reactor&);
+            void Post(Task::Ptr&&); // any thread
+            void Flush();
+            void Clear();
+
+            ~Queue() { Clear(); }
+        };
+
+        struct Thread
+        {
+            io::Reactor::Ptr m_pReactor;
+            Queue m_Queue;
+            std::thread m_Thread;
+            std::atomic<uint32_t> m_Connections;
+
+            void Run();
+        };
+
+        Queue m_Owner; // tasks for the owner thread
+
+        void Start(uint32_t nThreads); // must be called on the owner thread
+        void Stop(); // all the connections must be closed already
+        ~IoPool() { Stop(); }
+
+        bool IsRunning() const { return !m_vThreads.empty(); }
+        Thread& get_Thread(); // least loaded
+
+    private:
+        std::vector<std::unique_ptr<Thread> > m_vThreads;
     };
 
     struct INodeMsgHandler
@@ -682,6 +756,15 @@ namespace proto {
 		bool m_RulesCfgSent;
 
         SerializedMsg m_SerializeCache;
+        io::Address m_Addr; // remote, kept for logging
+
+        struct IoLink;
+        std::shared_ptr<IoLink> m_pIoLink;
+
+        void SendSerialized(MsgSerializer&);
+        void SendShared(const io::SharedBuffer&, bool bSeal);
+        void SendFinalized(bool bSeal);
+        void OnProtocolErr(ProtocolError);
 
         void TestIoResultAsync(const io::Result& res);
         void TestInputMsgContext(uint8_t);
@@ -692,7 +775,9 @@ namespace proto {
         virtual void on_protocol_error(uint64_t, ProtocolError error) override;
         virtual void on_connection_error(uint64_t, io::ErrorCode errorCode) override;
 
-#define THE_MACRO(code, msg) bool OnMsgInternal(uint64_t, msg##_NoInit&& v);
+#define THE_MACRO(code, msg) \
+        bool OnMsgInternal(uint64_t, msg##_NoInit&& v); \
+        bool OnMsgSafe(msg&& v);
         BeamNodeMsgsAll(THE_MACRO)
 #undef THE_MACRO
 
@@ -745,6 +830,8 @@ namespace proto {
 
         const Connection* get_Connection() { return m_Connection.get(); }
 
+        IoPool* m_pIoPool = nullptr; // if set and running - the I/O of the subsequent connections is done on its threads
+
         virtual void OnConnectedSecure() {}
 
         struct ByeReason
@@ -789,6 +876,7 @@ namespace proto {
         virtual void OnDisconnect(const DisconnectReason&) {}
 
 		size_t get_Unsent() const;
+		uint64_t get_DrainRate() const; // bytes/sec, 0 if the peer drains quickly (unknown)
 		size_t m_UnsentHiMark = 0;
 		void TestNotDrown();
 
@@ -800,6 +888,27 @@ namespace proto {
         BeamNodeMsgsAll(THE_MACRO)
 #undef THE_MACRO
 
+        template <typename TMsg>
+        void Send(SharedMsg& sm, const TMsg& v)
+        {
+            if (!IsLive())
+                return;
+
+            bool bSeal = (ProtocolPlus::Mode::Plaintext != m_Protocol.m_Mode);
+            io::SharedBuffer& buf = sm.m_pBuf[bSeal];
+            if (buf.empty())
+            {
+                m_SerializeCache.clear();
+                MsgSerializer& ser = m_Protocol.serializeNoFinalize(m_SerializeCache, TMsg::s_Code, v);
+                m_Protocol.Finalize(m_SerializeCache, ser);
+
+                buf = io::normalize(m_SerializeCache, true); // compact, don't hold the serializer fragments
+                m_SerializeCache.clear();
+            }
+
+            SendShared(buf, bSeal);
+        }
+
         struct Server
         {
             io::TcpServer::Ptr m_pServer; // just delete it to stop listening
@@ -467,12 +467,23 @@ void RadixHashTree::get_Hash(Merkle::Hash& hv)
 {
 	Node* p = get_Root();
 	if (p)
+	{
+		Executor* pExec = Executor::s_pInstance;
+		if (pExec && (pExec->get_Threads() > 1) && !(Node::s_Clean & p->m_Bits))
+			UpdateHashesMT(*p, *pExec);
+
 		hv = get_Hash(*p, hv);
+	}
 	else
 		hv = Zero;
 }
 
 const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
+{
+	return get_HashEx(n, hv, true);
+}
+
+const Merkle::Hash& RadixHashTree::get_HashEx(Node& n, Merkle::Hash& hv, bool bNotifyDirty)
 {
 	if (Node::s_Leaf & n.m_Bits)
 	{
@@ -480,7 +491,8 @@ const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
 
 		if (!(Node::s_Clean & n.m_Bits))
 		{
-			OnDirty();
+			if (bNotifyDirty)
+				OnDirty();
 			n.m_Bits |= Node::s_Clean;
 		}
 
@@ -490,21 +502,167 @@ const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
 	MyJoint& x = Cast::Up<MyJoint>(n);
 	if (!(Node::s_Clean & x.m_Bits))
 	{
-		ECC::Hash::Processor hp;
+		UpdateHashes(x);
+
+		if (bNotifyDirty)
+			OnDirty();
+	}
 
+	return x.m_Hash;
+}
+
+void RadixHashTree::MarkAllDirty()
+{
+	Node* p = get_Root();
+	if (p)
+	{
+		MarkDirty(*p);
+		OnDirty();
+	}
+}
+
+void RadixHashTree::MarkDirty(Node& n)
+{
+	n.m_Bits &= ~Node::s_Clean;
+
+	if (!(Node::s_Leaf & n.m_Bits))
+	{
+		Joint& x = Cast::Up<Joint>(n);
 		for (size_t i = 0; i < _countof(x.m_ppC); i++)
+			MarkDirty(*x.m_ppC[i].get_Strict());
+	}
+}
+
+void RadixHashTree::CollectDirty(Node& n, std::vector<DirtyJoint>& v, uint32_t nDepth)
+{
+	if (Node::s_Clean & n.m_Bits)
+		return;
+
+	n.m_Bits |= Node::s_Clean; // leaf hashes are evaluated on demand, joints are hashed by the caller
+
+	if (Node::s_Leaf & n.m_Bits)
+		return;
+
+	MyJoint& x = Cast::Up<MyJoint>(n);
+	v.emplace_back();
+	v.back().m_pJoint = &x;
+	v.back().m_Depth = nDepth;
+
+	for (size_t i = 0; i < _countof(x.m_ppC); i++)
+		CollectDirty(*x.m_ppC[i].get_Strict(), v, nDepth + 1);
+}
+
+void RadixHashTree::UpdateHashes(MyJoint& root)
+{
+	// Rehash the dirty joints bottom-up. The joints of the same depth are independent, hence hashed in batches
+	std::vector<DirtyJoint> v;
+	CollectDirty(root, v, 0);
+
+	std::sort(v.begin(), v.end(), [](const DirtyJoint& a, const DirtyJoint& b) { return a.m_Depth > b.m_Depth; });
+
+	const uint32_t nBatch = 8;
+	ECC::Hash::Processor pHp[nBatch];
+	Merkle::Hash pRes[nBatch];
+
+	for (size_t i0 = 0; i0 < v.size(); )
+	{
+		uint32_t nDepth = v[i0].m_Depth;
+		uint32_t n = 0;
+
+		for (; (n < nBatch) && (i0 + n < v.size()) && (v[i0 + n].m_Depth == nDepth); n++)
 		{
-			ECC::Hash::Value hvPlaceholder;
-			hp << get_Hash(*x.m_ppC[i].get_Strict(), hvPlaceholder);
+			const MyJoint& x = *v[i0 + n].m_pJoint;
+			ECC::Hash::Processor& hp = pHp[n];
+			hp.Reset();
+
+			for (size_t i = 0; i < _countof(x.m_ppC); i++)
+			{
+				ECC::Hash::Value hvPlaceholder;
+				hp << get_HashEx(*x.m_ppC[i].get_Strict(), hvPlaceholder, false);
+			}
 		}
 
-		OnDirty();
+		ECC::Hash::Processor::FinalizeMulti(pHp, pRes, n);
+
+		for (uint32_t i = 0; i < n; i++)
+			v[i0 + i].m_pJoint->m_Hash = pRes[i];
 
-		hp >> x.m_Hash;
-		x.m_Bits |= Node::s_Clean;
+		i0 += n;
 	}
+}
 
-	return x.m_Hash;
+void RadixHashTree::UpdateHashesMT(Node& root, Executor& ex)
+{
+	// Only the dirty paths are rehashed (clean subtrees are skipped by the s_Clean flag).
+	// Descend the top levels breadth-first, collecting the dirty subtrees, till there are enough of them to keep all the threads busy.
+	// Then hash them in parallel. The remaining top part is hashed by the caller.
+	uint32_t nThreads = ex.get_Threads();
+	const size_t nMin = nThreads * 8;
+	const uint32_t nMaxLevels = 24;
+
+	std::vector<Node*> v0, v1;
+	v0.push_back(&root);
+
+	for (uint32_t iLevel = 0; (iLevel < nMaxLevels) && (v0.size() < nMin); iLevel++)
+	{
+		bool bDescended = false;
+		v1.clear();
+
+		for (size_t i = 0; i < v0.size(); i++)
+		{
+			Node& n = *v0[i];
+			if (Node::s_Leaf & n.m_Bits)
+			{
+				v1.push_back(&n); // leaves are hashed right away, nothing to descend
+				continue;
+			}
+
+			Joint& x = Cast::Up<Joint>(n);
+			for (size_t j = 0; j < _countof(x.m_ppC); j++)
+			{
+				Node* pC = x.m_ppC[j].get_Strict();
+				if (!(Node::s_Clean & pC->m_Bits))
+					v1.push_back(pC);
+			}
+
+			bDescended = true;
+		}
+
+		if (!bDescended)
+			break;
+
+		v0.swap(v1);
+	}
+
+	if (v0.size() < nThreads)
+		return; // too few dirty paths, not worth it
+
+	struct MyTask
+		:public Executor::TaskSync
+	{
+		RadixHashTree* m_pThis;
+		Node* const* m_ppNodes;
+		uint32_t m_Count;
+
+		virtual void Exec(Executor::Context& ctx) override
+		{
+			uint32_t i0, nCount;
+			ctx.get_Portion(i0, nCount, m_Count);
+
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				Merkle::Hash hv;
+				m_pThis->get_HashEx(*m_ppNodes[i0 + i], hv, false); // OnDirty is not thread-safe, it's notified by the caller
+			}
+		}
+	} t;
+
+	t.m_pThis = this;
+	t.m_ppNodes = &v0.front();
+	t.m_Count = static_cast<uint32_t>(v0.size());
+
+	ex.ExecAll(t);
+	OnDirty();
 }
 
 void RadixHashTree::get_Proof(Merkle::Proof& proof, const CursorBase& cu)
@@ -848,7 +1006,7 @@ void UtxoTree::Compact::FlushInternal(uint16_t nBitsCommonNext)
 
 /////////////////////////////
 // UtxoTreeMapped
-bool UtxoTreeMapped::Open(const char* sz, const Stamp& s)
+void UtxoTreeMapped::get_Defs(MappedFile::Defs& d)
 {
 	// change this when format changes
 	static const uint8_t s_pSig[] = {
@@ -858,13 +1016,18 @@ bool UtxoTreeMapped::Open(const char* sz, const Stamp& s)
 		0xFE, 0x35, 0xD7, 0x0FA
 	};
 
-	MappedFile::Defs d;
 	d.m_pSig = s_pSig;
 	d.m_nSizeSig = sizeof(s_pSig);
 	d.m_nBanks = Type::count;
 	d.m_nFixedHdr = sizeof(Hdr);
+}
 
-	m_Mapping.Open(sz, d);
+bool UtxoTreeMapped::Open(const char* sz, const Stamp& s, uint32_t nFlags /* = 0 */)
+{
+	MappedFile::Defs d;
+	get_Defs(d);
+
+	m_Mapping.Open(sz, d, false, nFlags);
 
 	Hdr& h = get_Hdr();
 	if (!h.m_Dirty && (h.m_Stamp == s))
@@ -873,7 +1036,7 @@ bool UtxoTreeMapped::Open(const char* sz, const Stamp& s)
 		return true;
 	}
 
-	m_Mapping.Open(sz, d, true); // reset
+	m_Mapping.Open(sz, d, true, nFlags); // reset
 	return false;
 }
 
@@ -918,6 +1081,112 @@ void UtxoTreeMapped::EnsureReserve()
 	}
 }
 
+uint64_t UtxoTreeMapped::get_FreeSize() const
+{
+	const uint32_t pSize[] = {
+		sizeof(MyLeaf),
+		sizeof(MyJoint),
+		sizeof(MyLeaf::IDQueue),
+		sizeof(MyLeaf::IDNode)
+	};
+	static_assert(_countof(pSize) == Type::count, "");
+
+	uint64_t nRet = 0;
+	for (uint32_t i = 0; i < Type::count; i++)
+		nRet += m_Mapping.get_BankInfo(i).m_Free * pSize[i];
+
+	return nRet;
+}
+
+bool UtxoTreeMapped::IsFragmented() const
+{
+	uint64_t nFree = get_FreeSize();
+	return
+		(nFree > (MappedFile::s_ArenaMax << 2)) && // don't bother for small images
+		(nFree > (m_Mapping.get_Size() >> 2));
+}
+
+void UtxoTreeMapped::Compact()
+{
+	struct Entry {
+		Key m_Key;
+		Input::Count m_Count;
+	};
+
+	struct Traveler
+		:public ITraveler
+	{
+		std::vector<Entry> m_vLeafs;
+		std::vector<TxoID> m_vIDs; // per leaf: from the oldest to the newest
+
+		virtual bool OnLeaf(const Leaf& n) override {
+			const MyLeaf& x = Cast::Up<MyLeaf>(n);
+
+			Entry& e = m_vLeafs.emplace_back();
+			e.m_Key = x.m_Key;
+			e.m_Count = x.get_Count();
+
+			if (x.IsExt())
+			{
+				size_t i0 = m_vIDs.size();
+				for (auto p = x.m_pIDs.get_Strict()->m_pTop.get_Strict(); p; p = p->m_pNext.get())
+					m_vIDs.push_back(p->m_ID);
+
+				std::reverse(m_vIDs.begin() + i0, m_vIDs.end());
+			}
+			else
+				m_vIDs.push_back(x.m_ID);
+
+			return true;
+		}
+	} t;
+
+	Traverse(t);
+
+	uint64_t pUsed[Type::count];
+	for (uint32_t i = 0; i < Type::count; i++)
+	{
+		const MappedFile::Bank& b = m_Mapping.get_BankInfo(i);
+		pUsed[i] = b.m_Total - b.m_Free;
+	}
+
+	try
+	{
+		MappedFile::Defs d;
+		get_Defs(d);
+
+		m_RootOffset = 0; // the nodes are discarded as-is
+		m_Mapping.Reset(d);
+		OnDirty(); // the Hdr is zeroed too. Must not look valid if the rebuild is interrupted
+
+		// reserve everything upfront: single arena per bank, and no remapping while the tree is being built
+		m_Mapping.EnsureReserve(Type::Leaf, sizeof(MyLeaf), static_cast<uint32_t>(pUsed[Type::Leaf] + 1));
+		m_Mapping.EnsureReserve(Type::Joint, sizeof(MyJoint), static_cast<uint32_t>(pUsed[Type::Joint] + 1));
+		m_Mapping.EnsureReserve(Type::Queue, sizeof(MyLeaf::IDQueue), static_cast<uint32_t>(pUsed[Type::Queue] + 1));
+		m_Mapping.EnsureReserve(Type::Node, sizeof(MyLeaf::IDNode), static_cast<uint32_t>(pUsed[Type::Node] + 1));
+	}
+	catch (const std::exception& e)
+	{
+		// promote it
+		CorruptionException exc;
+		exc.m_sErr = e.what();
+		throw exc;
+	}
+
+	const TxoID* pID = t.m_vIDs.empty() ? nullptr : &t.m_vIDs.front();
+	for (const Entry& e : t.m_vLeafs)
+	{
+		Cursor cu;
+		bool bCreate = true;
+		MyLeaf* p = Find(cu, e.m_Key, bCreate);
+		assert(bCreate);
+
+		p->m_ID = *pID++;
+		for (Input::Count n = 1; n < e.m_Count; n++)
+			PushID(*pID++, *p);
+	}
+}
+
 void UtxoTreeMapped::OnDirty()
 {
 	get_Hdr().m_Dirty = 1;
@@ -16,6 +16,7 @@
 
 #include "block_crypt.h"
 #include "mapped_file.h"
+#include "../utility/executor.h"
 
 namespace beam
 {
@@ -187,8 +188,9 @@ public:
 		Merkle::Hash m_Hash;
 	};
 
-	void get_Hash(Merkle::Hash&);
+	void get_Hash(Merkle::Hash&); // if Executor::s_pInstance is set - dirty subtrees are hashed in parallel
 	void get_Proof(Merkle::Proof&, const CursorBase&);
+	void MarkAllDirty(); // discard all the cached hashes, the whole tree is rehashed on the next get_Hash
 
 protected:
 	// RadixTree
@@ -196,6 +198,18 @@ protected:
 	virtual void DeleteJoint(Joint* p) override { delete Cast::Up<MyJoint>(p); }
 
 	const Merkle::Hash& get_Hash(Node&, Merkle::Hash&);
+	const Merkle::Hash& get_HashEx(Node&, Merkle::Hash&, bool bNotifyDirty);
+
+	void UpdateHashesMT(Node&, Executor&);
+
+	struct DirtyJoint {
+		MyJoint* m_pJoint;
+		uint32_t m_Depth;
+	};
+
+	void CollectDirty(Node&, std::vector<DirtyJoint>&, uint32_t nDepth);
+	void UpdateHashes(MyJoint&);
+	static void MarkDirty(Node&);
 
 	virtual const Merkle::Hash& get_LeafHash(Node&, Merkle::Hash&) = 0;
 };
@@ -393,6 +407,8 @@ protected:
 
 	virtual intptr_t get_Base() const override;
 
+	static void get_Defs(MappedFile::Defs&);
+
 	virtual Leaf* CreateLeaf() override;
 	virtual void DeleteEmptyLeaf(Leaf*) override;
 	virtual Joint* CreateJoint() override;
@@ -411,7 +427,7 @@ public:
 
 	~UtxoTreeMapped() { Close(); }
 
-	bool Open(const char* sz, const Stamp&);
+	bool Open(const char* sz, const Stamp&, uint32_t nFlags = 0); // nFlags - MappedFile::Flags
 	bool IsOpen() const { return m_Mapping.get_Base() != nullptr; }
 
 	void Close();
@@ -419,6 +435,13 @@ public:
 
 	void EnsureReserve();
 
+	uint64_t get_FreeSize() const; // allocated, but unused
+	bool IsFragmented() const;
+
+	// Rebuild the image in key order. Nodes of each subtree end up in contiguous runs of their banks, the unused space is released.
+	// The image becomes dirty.
+	void Compact();
+
 #pragma pack(push, 1)
 	struct Hdr
 	{
@@ -0,0 +1,39 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "../utility/io/buffer.h"
+
+namespace beam {
+namespace proto {
+
+    // Message serialized once, to be sent to multiple peers. Only the mac and the encryption are per-peer.
+    struct SharedMsg
+    {
+        io::SharedBuffer m_pBuf[2]; // plaintext, and with the mac placeholder (encrypted mode). Created on-demand
+
+        void Reset()
+        {
+            for (io::SharedBuffer& buf : m_pBuf)
+                buf.clear();
+        }
+
+        size_t get_Size() const
+        {
+            return m_pBuf[0].size + m_pBuf[1].size;
+        }
+    };
+
+} // namespace proto
+} // namespace beam
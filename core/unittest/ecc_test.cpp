@@ -264,6 +264,76 @@ void TestHash()
 		// hash values must change, even if no explicit input was fed.
 		verify_test(!(hv == hv2));
 	}
+
+	const bool bHw0 = Hash::Processor::s_UseHw;
+	const bool bSimd0 = Hash::Processor::s_UseSimd;
+	printf("SHA-256 hardware acceleration: %s, SIMD: %s\n", Hash::Processor::IsHwSupported() ? "yes" : "no", Hash::Processor::IsSimdSupported() ? "yes" : "no");
+
+	uint8_t pMsg[300];
+	GenerateRandom(pMsg, sizeof(pMsg));
+
+	const uint32_t nLens = 140;
+	Hash::Value pRef[nLens];
+
+	for (uint32_t iEngine = 0; iEngine < 4; iEngine++)
+	{
+		Hash::Processor::s_UseHw = (1 & iEngine) && Hash::Processor::IsHwSupported();
+		Hash::Processor::s_UseSimd = (2 & iEngine) && Hash::Processor::IsSimdSupported();
+
+		// known vectors
+		static const uint8_t pAbc[] = {
+			0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+			0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+		};
+		static const uint8_t pLong[] = { // 1M of 'a'
+			0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+			0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0
+		};
+
+		Hash::Processor() << beam::Blob("abc", 3) >> hv;
+		verify_test(!memcmp(hv.m_pData, pAbc, sizeof(pAbc)));
+
+		{
+			std::vector<uint8_t> vA(1000000, 'a');
+			Hash::Processor() << beam::Blob(&vA.front(), static_cast<uint32_t>(vA.size())) >> hv;
+			verify_test(!memcmp(hv.m_pData, pLong, sizeof(pLong)));
+		}
+
+		// all the lengths around the block boundaries, fed in pieces
+		Hash::Processor pHp[nLens];
+		for (uint32_t i = 0; i < nLens; i++)
+		{
+			for (uint32_t nDone = 0; nDone < i; )
+			{
+				uint32_t nPortion = std::min(1 + (nDone % 67), i - nDone);
+				pHp[i] << beam::Blob(pMsg + nDone, nPortion);
+				nDone += nPortion;
+			}
+		}
+
+		Hash::Value pRes[nLens];
+		if (iEngine)
+			Hash::Processor::FinalizeMulti(pHp, pRes, nLens);
+		else
+		{
+			for (uint32_t i = 0; i < nLens; i++)
+				pHp[i] >> pRes[i];
+		}
+
+		for (uint32_t i = 0; i < nLens; i++)
+		{
+			if (iEngine)
+				verify_test(pRes[i] == pRef[i]);
+			else
+				pRef[i] = pRes[i];
+
+			Hash::Processor() << beam::Blob(pMsg, i) >> hv;
+			verify_test(hv == pRef[i]);
+		}
+	}
+
+	Hash::Processor::s_UseHw = bHw0;
+	Hash::Processor::s_UseSimd = bSimd0;
 }
 
 void TestScalars()
@@ -553,6 +623,192 @@ void TestPoints()
 	verify_test(p0 == Zero);
 }
 
+void TestMultiMac()
+{
+	Mode::Scope scope(Mode::Fast);
+
+	// the bucket (Pippenger) and the interleaved wNAF paths must give the same result as the straightforward sum
+	const uint32_t nMax = 300;
+	typedef MultiMac_WithBufs<nMax, 1> MyMultiMac;
+	std::unique_ptr<MyMultiMac> pMm = std::make_unique<MyMultiMac>();
+	MyMultiMac& mm = *pMm;
+
+	std::vector<Point::Native> vPts(nMax);
+	std::vector<Scalar::Native> vK(nMax);
+	Scalar::Native kPrep;
+
+	const uint32_t nThreshold0 = MultiMac::s_PippengerThreshold;
+
+	uint32_t pCount[] = { 1, 2, 17, 160, nMax };
+	for (uint32_t iTest = 0; iTest < _countof(pCount) * 2; iTest++)
+	{
+		uint32_t nCount = pCount[iTest >> 1];
+		bool bPrepared = !!(1 & iTest);
+
+		for (uint32_t i = 0; i < nCount; i++)
+		{
+			SetRandom(vPts[i]);
+			SetRandom(vK[i]);
+		}
+
+		if (nCount >= 17)
+		{
+			vPts[1] = Zero;
+			vK[2] = Zero;
+			vPts[3] = vPts[4]; // same bucket
+			vPts[5] = -vPts[6]; // cancel each other
+			vK[5] = vK[6];
+			vK[7] = 1U;
+			vK[8] = -vK[7]; // all bits set
+		}
+
+		SetRandom(kPrep);
+
+		// the 3rd path is the explicit variable-time one, invoked while the caller is in secure mode
+		Point::Native pRes[3];
+		for (uint32_t iPath = 0; iPath < _countof(pRes); iPath++)
+		{
+			MultiMac::s_PippengerThreshold = (1 == iPath) ? 0 : static_cast<uint32_t>(-1);
+			bool bVar = (2 == iPath);
+			Mode::Scope scope2(bVar ? Mode::Secure : Mode::Fast);
+
+			mm.Reset();
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				if (bVar)
+					mm.m_pCasual[i].InitVar(vPts[i]);
+				else
+					mm.m_pCasual[i].Init(vPts[i]);
+				mm.m_pKCasual[i] = vK[i];
+			}
+			mm.m_Casual = static_cast<int>(nCount);
+
+			if (bPrepared)
+			{
+				mm.m_ppPrepared[0] = &Context::get().m_Ipp.G_;
+				mm.m_pKPrep[0] = kPrep;
+				mm.m_Prepared = 1;
+			}
+
+			if (bVar)
+				mm.CalculateVar(pRes[iPath]);
+			else
+				mm.Calculate(pRes[iPath]);
+		}
+
+		MultiMac::s_PippengerThreshold = nThreshold0;
+
+		Point::Native p0 = Zero;
+		if (bPrepared)
+			p0 = Context::get().G * kPrep;
+
+		for (uint32_t i = 0; i < nCount; i++)
+			p0 += vPts[i] * vK[i];
+
+		p0 = -p0;
+
+		for (uint32_t iPath = 0; iPath < _countof(pRes); iPath++)
+		{
+			Point::Native p1 = p0;
+			p1 += pRes[iPath];
+			verify_test(p1 == Zero);
+		}
+	}
+
+	// generator multiplication: the variable-time variant must match the constant-time one
+	{
+		Mode::Scope scope2(Mode::Secure);
+
+		Scalar::Native k;
+		SetRandom(k);
+
+		Point::Native p0 = Context::get().G * k;
+		p0 = -p0;
+		p0 += Context::get().G.MulVar(k);
+		verify_test(p0 == Zero);
+
+		p0 = Context::get().H * Amount(0x1234567890ULL);
+		p0 = -p0;
+		p0 += Context::get().H.MulVar(Amount(0x1234567890ULL));
+		verify_test(p0 == Zero);
+	}
+}
+
+void TestContextBlob()
+{
+#ifdef WIN32
+	const char* sz = "ecc_context_test.bin";
+#else // WIN32
+	const char* sz = "/tmp/ecc_context_test.bin";
+#endif // WIN32
+
+	const Context& ctx0 = Context::get();
+	Context::Export(sz);
+
+	const Context* pCtx = Context::Map(sz);
+	verify_test(pCtx && (pCtx != &ctx0));
+	const Context& ctx = *pCtx;
+
+	verify_test(ctx.m_hvChecksum == ctx0.m_hvChecksum);
+
+	Hash::Value hv0, hv1;
+	ctx0.get_DataHash(hv0);
+	ctx.get_DataHash(hv1);
+	verify_test(hv0 == hv1);
+	verify_test(!memcmp(&ctx.m_Ipp, &ctx0.m_Ipp, sizeof(ctx.m_Ipp)));
+
+	// signature configs must be fixed-up to point into the mapped context
+	verify_test(ctx.m_Sig.m_CfgG1.m_pG == &ctx.m_Sig.m_GenG);
+	verify_test(ctx.m_Sig.m_GenG.m_pGen == &ctx.G);
+	verify_test(ctx.m_Sig.m_pGenGH[1].m_pGenPrep == &ctx.m_Ipp.H_);
+
+	Scalar::Native k;
+	SetRandom(k);
+
+	Point::Native p0 = ctx0.G * k;
+	Point::Native p1 = ctx.G * k;
+	verify_test(p0 == p1);
+
+	p0 = ctx0.J * k;
+	p1 = ctx.J * k;
+	verify_test(p0 == p1);
+
+	// corrupted blob must be rejected
+	{
+		std::FStream fs;
+		fs.Open(sz, false, true, true);
+		uint8_t nExtra = 0;
+		fs.write(&nExtra, sizeof(nExtra));
+	}
+	verify_test(!Context::Map(sz));
+
+	// altered data must be rejected, even though the blob is consistent otherwise (there's no hash in the blob to recalculate)
+	for (uint32_t iPos = 0; iPos < 2; iPos++)
+	{
+		Context::Export(sz);
+
+		std::vector<uint8_t> vBuf;
+		{
+			std::FStream fs;
+			fs.Open(sz, true, true);
+			vBuf.resize(static_cast<size_t>(fs.get_Remaining()));
+			fs.read(&vBuf.front(), vBuf.size());
+		}
+
+		// somewhere in the inner product generators, or the 1st point of G
+		vBuf[iPos ? (vBuf.size() - sizeof(Context)) : (vBuf.size() / 2)] ^= 1;
+
+		std::FStream fs;
+		fs.Open(sz, false, true);
+		fs.write(&vBuf.front(), vBuf.size());
+		fs.Close();
+
+		verify_test(!Context::Map(sz));
+	}
+
+	beam::DeleteFile(sz);
+}
+
 void TestSigning()
 {
 	for (int i = 0; i < 30; i++)
@@ -1382,6 +1638,25 @@ void TestTransaction()
 	ctx.m_Height.m_Min = g_hFork;
 	verify_test(tm.m_Trans.IsValid(ctx));
 	verify_test(ctx.m_Stats.m_Fee == beam::AmountBig::Type(fee1 + fee2));
+
+	// signatures are verified in a batch, make sure a bad one is still detected
+	size_t iKrn = 0;
+	while (beam::TxKernel::Subtype::Std != tm.m_Trans.m_vKernels[iKrn]->get_Subtype())
+		iKrn++;
+
+	beam::TxKernelStd& krn = Cast::Up<beam::TxKernelStd>(*tm.m_Trans.m_vKernels[iKrn]);
+	Scalar k0 = krn.m_Signature.m_k;
+	krn.m_Signature.m_k.m_Value.Inc();
+
+	ctx.Reset();
+	ctx.m_Height.m_Min = g_hFork;
+	verify_test(!tm.m_Trans.IsValid(ctx));
+
+	krn.m_Signature.m_k = k0;
+
+	ctx.Reset();
+	ctx.m_Height.m_Min = g_hFork;
+	verify_test(tm.m_Trans.IsValid(ctx));
 }
 
 void TestCutThrough()
@@ -1412,7 +1687,7 @@ void TestCutThrough()
 	verify_test(ctx.ValidateAndSummarize(tm.m_Trans, tm.m_Trans.get_Reader()));
 }
 
-void TestAES()
+void TestAES_Ecb()
 {
 	// AES in ECB mode (simplest): https://csrc.nist.gov/CSRC/media/Projects/Cryptographic-Standards-and-Guidelines/documents/examples/AES_Core256.pdf
 
@@ -1457,6 +1732,62 @@ void TestAES()
 	verify_test(!memcmp(pBuf, pPlaintext, sizeof(pPlaintext)));
 }
 
+void TestAES_Ctr(const AES::Encoder& enc, uint8_t* pBuf, uint32_t nSize)
+{
+	// random portions, to cover the partial blocks and the remaining cipherstream
+	AES::StreamCipher asc;
+	asc.Reset();
+
+	for (uint32_t nDone = 0; nDone < nSize; )
+	{
+		uint32_t nPortion;
+		SetRandomOrd(nPortion);
+		nPortion = std::min(nPortion % 100, nSize - nDone);
+
+		asc.XCrypt(enc, pBuf + nDone, nPortion);
+		nDone += nPortion;
+	}
+}
+
+void TestAES()
+{
+	const bool bHw0 = AES::s_UseHw;
+	printf("AES hardware acceleration: %s\n", AES::IsHwSupported() ? "yes" : "no");
+
+	AES::s_UseHw = false;
+	TestAES_Ecb();
+
+	if (AES::IsHwSupported())
+	{
+		AES::s_UseHw = true;
+		TestAES_Ecb();
+
+		// CTR mode, both implementations must produce the same cipherstream
+		uintBig hv;
+		SetRandom(hv);
+
+		AES::Encoder enc;
+		enc.Init(hv.m_pData);
+
+		uint8_t pBuf[0x1000], pBuf2[sizeof(pBuf)];
+		GenerateRandom(pBuf, sizeof(pBuf));
+		memcpy(pBuf2, pBuf, sizeof(pBuf));
+
+		AES::s_UseHw = false;
+		TestAES_Ctr(enc, pBuf, sizeof(pBuf));
+
+		AES::s_UseHw = true;
+		TestAES_Ctr(enc, pBuf2, sizeof(pBuf2));
+
+		verify_test(!memcmp(pBuf, pBuf2, sizeof(pBuf)));
+
+		TestAES_Ctr(enc, pBuf2, sizeof(pBuf2)); // decrypt
+		verify_test(memcmp(pBuf, pBuf2, sizeof(pBuf))); // encrypted
+	}
+
+	AES::s_UseHw = bHw0;
+}
+
 void TestKdfPair(Key::IKdf& skdf, Key::IPKdf& pkdf)
 {
 	for (uint32_t i = 0; i < 10; i++)
@@ -1803,9 +2134,23 @@ void TestLelantus(bool bWithAsset)
 	if (!bWithAsset)
 		printf("Lelantus [n, M, N] = [%u, %u, %u]\n", cfg.n, cfg.M, N);
 
-	beam::Lelantus::CmListVec lst;
+	struct MyList
+		:public beam::Lelantus::CmListVec
+	{
+		std::atomic<uint32_t> m_Requests{ 0 }; // called from the executor threads
+
+		virtual bool get_At(ECC::Point::Storage& res, uint32_t iIdx) override
+		{
+			m_Requests++;
+			return CmListVec::get_At(res, iIdx);
+		}
+	} lst;
 	lst.m_vec.resize(N);
 
+	// the prover reads the list via cache
+	beam::Lelantus::CmListCache lstCache;
+	lstCache.SetWindow(lst, 0, N);
+
 	Point::Native hGen;
 	if (bWithAsset)
 		beam::Asset::Base(35).get_Generator(hGen);
@@ -1818,7 +2163,7 @@ void TestLelantus(bool bWithAsset)
 
 	beam::Lelantus::Proof proof;
 	proof.m_Cfg = cfg;
-	beam::Lelantus::Prover p(lst, proof);
+	beam::Lelantus::Prover p(lstCache, proof);
 
 	beam::Sigma::Prover::UserData ud1, ud2;
 	for (size_t i = 0; i < _countof(ud1.m_pS); i++)
@@ -1859,7 +2204,7 @@ void TestLelantus(bool bWithAsset)
 
 	std::vector<Point> vG;
 
-	for (uint32_t iCycle = 0; iCycle < 3; iCycle++)
+	for (uint32_t iCycle = 0; iCycle < 4; iCycle++)
 	{
 		struct MyExec
 			:public beam::ExecutorMT
@@ -1878,7 +2223,10 @@ void TestLelantus(bool bWithAsset)
 
 		ex.m_Threads = 1 << iCycle;
 
-		beam::Executor::Scope scope(ex);
+		// the last cycle - without executor (the prover may use its dedicated one)
+		std::unique_ptr<beam::Executor::Scope> pScope;
+		if (iCycle < 3)
+			pScope = std::make_unique<beam::Executor::Scope>(ex);
 
 		uint32_t t = beam::GetTime_ms();
 
@@ -1886,7 +2234,14 @@ void TestLelantus(bool bWithAsset)
 		p.Generate(Zero, oracle, &hGen);
 
 		if (!bWithAsset)
-			printf("\tProof time = %u ms, Threads=%u\n", beam::GetTime_ms() - t, ex.m_Threads);
+		{
+			if (pScope)
+				printf("\tProof time = %u ms, Threads=%u\n", beam::GetTime_ms() - t, ex.m_Threads);
+			else
+				printf("\tProof time = %u ms, no Executor\n", beam::GetTime_ms() - t);
+		}
+
+		verify_test(lst.m_Requests == N); // the elements are fetched once
 
 		if (iCycle)
 		{
@@ -2142,6 +2497,8 @@ void TestAll()
 	TestHash();
 	TestScalars();
 	TestPoints();
+	TestMultiMac();
+	TestContextBlob();
 	TestSigning();
 	TestCommitments();
 	TestRangeProof(false);
@@ -2229,6 +2586,17 @@ struct BenchmarkMeter
 
 void RunBenchmark()
 {
+	// build-dependent, compare the runs of the differently configured builds
+#ifdef USE_FIELD_5X52
+#	ifdef USE_ASM_X86_64
+	printf("secp256k1 limbs: 5x52 field (asm), 4x64 scalar\n");
+#	else // USE_ASM_X86_64
+	printf("secp256k1 limbs: 5x52 field, 4x64 scalar\n");
+#	endif // USE_ASM_X86_64
+#else // USE_FIELD_5X52
+	printf("secp256k1 limbs: 10x26 field, 8x32 scalar\n");
+#endif // USE_FIELD_5X52
+
 	Scalar::Native k1, k2;
 	SetRandom(k1);
 	SetRandom(k2);
@@ -2306,6 +2674,48 @@ void RunBenchmark()
     SetRandom(p0);
     SetRandom(p1);
 
+	{
+		secp256k1_fe a = p0.get_Raw().x, b = p1.get_Raw().x;
+
+		BenchmarkMeter bm("field.Multiply");
+		do
+		{
+			for (uint32_t i = 0; i < bm.N; i++)
+				secp256k1_fe_mul(&a, &a, &b);
+
+		} while (bm.ShouldContinue());
+
+		verify_test(!secp256k1_fe_normalizes_to_zero(&a)); // also prevents the optimizer from throwing it away
+	}
+
+	{
+		secp256k1_fe a = p0.get_Raw().x;
+
+		BenchmarkMeter bm("field.Square");
+		do
+		{
+			for (uint32_t i = 0; i < bm.N; i++)
+				secp256k1_fe_sqr(&a, &a);
+
+		} while (bm.ShouldContinue());
+
+		verify_test(!secp256k1_fe_normalizes_to_zero(&a)); // also prevents the optimizer from throwing it away
+	}
+
+	{
+		secp256k1_fe a = p0.get_Raw().x;
+
+		BenchmarkMeter bm("field.Inverse");
+		do
+		{
+			for (uint32_t i = 0; i < bm.N; i++)
+				secp256k1_fe_inv(&a, &a);
+
+		} while (bm.ShouldContinue());
+
+		verify_test(!secp256k1_fe_normalizes_to_zero(&a)); // also prevents the optimizer from throwing it away
+	}
+
 /*	{
 		BenchmarkMeter bm("point.Negate");
 		do
@@ -2423,6 +2833,16 @@ void RunBenchmark()
 		} while (bm.ShouldContinue());
 	}
 
+	{
+		BenchmarkMeter bm("H.Multiply.Var");
+		do
+		{
+			for (uint32_t i = 0; i < bm.N; i++)
+				p0 = Context::get().H.MulVar(uint64_t(-1));
+
+		} while (bm.ShouldContinue());
+	}
+
 	{
 		k1 = uint64_t(-1);
 
@@ -2442,6 +2862,16 @@ void RunBenchmark()
 		} while (bm.ShouldContinue());
 	}
 
+	{
+		BenchmarkMeter bm("G.Multiply.Var");
+		do
+		{
+			for (uint32_t i = 0; i < bm.N; i++)
+				p0 = Context::get().G.MulVar(k1);
+
+		} while (bm.ShouldContinue());
+	}
+
 	{
 		BenchmarkMeter bm("Commit");
 		do
@@ -2458,17 +2888,61 @@ void RunBenchmark()
 		uint8_t pBuf[0x400];
 		GenerateRandom(pBuf, sizeof(pBuf));
 
-		BenchmarkMeter bm("Hash.Init.1K.Out");
-		do
+		const bool bHw0 = Hash::Processor::s_UseHw;
+		for (uint32_t iEngine = 0; iEngine < 2; iEngine++)
 		{
-			for (uint32_t i = 0; i < bm.N; i++)
+			if (iEngine && !Hash::Processor::IsHwSupported())
+				break;
+			Hash::Processor::s_UseHw = !!iEngine;
+
+			BenchmarkMeter bm(iEngine ? "Hash.Init.1K.Out.Hw" : "Hash.Init.1K.Out");
+			do
 			{
-				Hash::Processor()
-					<< beam::Blob(pBuf, sizeof(pBuf))
-					>> hv;
-			}
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					Hash::Processor()
+						<< beam::Blob(pBuf, sizeof(pBuf))
+						>> hv;
+				}
 
-		} while (bm.ShouldContinue());
+			} while (bm.ShouldContinue());
+		}
+
+		// many short messages (like the merkle nodes)
+		const bool bSimd0 = Hash::Processor::s_UseSimd;
+		for (uint32_t iEngine = 0; iEngine < 3; iEngine++)
+		{
+			if ((1 == iEngine) && !Hash::Processor::IsSimdSupported())
+				continue;
+			if ((2 == iEngine) && !Hash::Processor::IsHwSupported())
+				continue;
+
+			Hash::Processor::s_UseHw = (2 == iEngine);
+			Hash::Processor::s_UseSimd = (1 == iEngine);
+
+			const uint32_t nCount = 8;
+			Hash::Processor pHp[nCount];
+			Hash::Value pRes[nCount];
+
+			const char* pName[] = { "Hash.64B.Multi-8", "Hash.64B.Multi-8.Simd", "Hash.64B.Multi-8.Hw" };
+			BenchmarkMeter bm(pName[iEngine]);
+			do
+			{
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					for (uint32_t j = 0; j < nCount; j++)
+					{
+						pHp[j].Reset();
+						pHp[j] << beam::Blob(pBuf + j * 64, 64);
+					}
+					Hash::Processor::FinalizeMulti(pHp, pRes, nCount);
+				}
+
+			} while (bm.ShouldContinue());
+		}
+
+		Hash::Processor::s_UseHw = bHw0;
+		Hash::Processor::s_UseSimd = bSimd0;
 	}
 
 	Hash::Processor() << "abcd" >> hv;
@@ -2495,6 +2969,40 @@ void RunBenchmark()
 		} while (bm.ShouldContinue());
 	}
 
+	{
+		// kernel signatures, as verified within a block
+		const uint32_t nSigs = 1000;
+		std::vector<Signature> vSigs(nSigs);
+		std::vector<Point::Native> vPks(nSigs);
+
+		for (uint32_t i = 0; i < nSigs; i++)
+		{
+			Scalar::Native sk;
+			SetRandom(sk);
+			vPks[i] = Context::get().G * sk;
+			vSigs[i].Sign(hv, sk);
+		}
+
+		typedef InnerProduct::BatchContextEx<64> MyBatch;
+		std::unique_ptr<MyBatch> p(new MyBatch);
+
+		InnerProduct::BatchContext::Scope scope(*p);
+
+		BenchmarkMeter bm("signature.Verify x1000");
+		bm.N = nSigs;
+		do
+		{
+			for (uint32_t i = 0; i < bm.N; i += nSigs)
+			{
+				for (uint32_t n = 0; n < nSigs; n++)
+					vSigs[n].IsValid(hv, vPks[n]);
+
+				verify_test(p->Flush());
+			}
+
+		} while (bm.ShouldContinue());
+	}
+
 	Scalar::Native pA[InnerProduct::nDim];
 	Scalar::Native pB[InnerProduct::nDim];
 
@@ -2595,6 +3103,162 @@ void RunBenchmark()
 	}
 
 	{
+		// block-sized body: each kernel spends an input and creates 2 outputs. Verified in the caller's secure and fast modes,
+		// both must take the variable-time paths
+		const uint32_t nKernels = 50;
+
+		TransactionMaker tm;
+		std::vector<beam::TxKernel::Ptr> lstDummy;
+
+		for (uint32_t i = 0; i < nKernels; i++)
+		{
+			tm.AddInput(0, 3000);
+			tm.AddOutput(0, 1000);
+			tm.AddOutput(1, 1990);
+			tm.CreateTxKernel(tm.m_Trans.m_vKernels, 10, lstDummy, false, false);
+		}
+
+		tm.m_Trans.Normalize();
+
+		for (uint32_t iMode = 0; iMode < 2; iMode++)
+		{
+			Mode::Scope scope(iMode ? Mode::Fast : Mode::Secure);
+
+			BenchmarkMeter bm(iMode ? "Block-50.Verify.Fast" : "Block-50.Verify.Secure");
+			bm.N = 1;
+			do
+			{
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					beam::TxBase::Context::Params pars;
+					beam::TxBase::Context ctx(pars);
+					ctx.m_Height.m_Min = g_hFork;
+					verify_test(tm.m_Trans.IsValid(ctx));
+				}
+
+			} while (bm.ShouldContinue());
+		}
+	}
+
+	{
+		// multi-exponentiation of large batches (as in sigma verification), interleaved wNAF vs buckets
+		Mode::Scope scope(Mode::Fast);
+
+		const uint32_t nMaxPts = 65536;
+		beam::Sigma::CmListVec lst;
+		lst.m_vec.resize(nMaxPts);
+
+		std::vector<Scalar::Native> vK(nMaxPts);
+
+		Point::Native rnd;
+		SetRandom(rnd);
+
+		for (uint32_t i = 0; i < nMaxPts; i++, rnd += rnd)
+		{
+			rnd.Export(lst.m_vec[i]);
+			SetRandom(vK[i]);
+		}
+
+		const uint32_t nThreshold0 = MultiMac::s_PippengerThreshold;
+
+		for (uint32_t nPts = 64; nPts <= nMaxPts; nPts <<= 2)
+		{
+			for (uint32_t iPath = 0; iPath < 2; iPath++)
+			{
+				MultiMac::s_PippengerThreshold = iPath ? 0 : static_cast<uint32_t>(-1);
+
+				char sz[0x20];
+				snprintf(sz, sizeof(sz), "MultiMac.%s-%u", iPath ? "Buckets" : "wNAF", nPts);
+
+				BenchmarkMeter bm(sz);
+				bm.N = 1;
+				do
+				{
+					for (uint32_t i = 0; i < bm.N; i++)
+					{
+						Point::Native res = Zero;
+						lst.Calculate(res, 0, nPts, &vK.front());
+					}
+
+				} while (bm.ShouldContinue());
+			}
+		}
+
+		MultiMac::s_PippengerThreshold = nThreshold0;
+	}
+
+	{
+		// lelantus prover: anonymity set size vs threads
+		const uint32_t nMaxPts = 16384;
+		beam::Lelantus::CmListVec lst;
+		lst.m_vec.resize(nMaxPts);
+
+		Point::Native rnd;
+		SetRandom(rnd);
+
+		for (uint32_t i = 0; i < nMaxPts; i++, rnd += rnd)
+			rnd.Export(lst.m_vec[i]);
+
+		for (uint32_t M = 4; ; M++)
+		{
+			beam::Lelantus::Proof proof;
+			proof.m_Cfg.n = 4;
+			proof.m_Cfg.M = M;
+
+			uint32_t N = proof.m_Cfg.get_N();
+			if (N > nMaxPts)
+				break;
+
+			beam::Lelantus::Prover p(lst, proof);
+			p.m_Witness.V.m_V = 100500;
+			p.m_Witness.V.m_L = N / 3;
+			SetRandom(p.m_Witness.V.m_R);
+			SetRandom(p.m_Witness.V.m_R_Output);
+			SetRandom(p.m_Witness.V.m_SpendSk);
+
+			for (uint32_t nThreads = 1; nThreads <= 4; nThreads <<= 1)
+			{
+				struct MyExec
+					:public beam::ExecutorMT
+				{
+					uint32_t m_Threads;
+
+					virtual uint32_t get_Threads() override { return m_Threads; }
+
+					virtual void RunThread(uint32_t iThread) override
+					{
+						ExecutorMT::Context ctx;
+						ctx.m_iThread = iThread;
+						RunThreadCtx(ctx);
+					}
+				} ex;
+
+				ex.m_Threads = nThreads;
+				beam::Executor::Scope scope(ex);
+
+				char sz[0x20];
+				snprintf(sz, sizeof(sz), "Lelantus.Prove-%u.T%u", N, nThreads);
+
+				BenchmarkMeter bm(sz);
+				bm.N = 1;
+				do
+				{
+					for (uint32_t i = 0; i < bm.N; i++)
+					{
+						Oracle oracle;
+						p.Generate(Zero, oracle);
+					}
+
+				} while (bm.ShouldContinue());
+			}
+		}
+	}
+
+	for (uint32_t iHw = 0; iHw < (AES::IsHwSupported() ? 2U : 1U); iHw++)
+	{
+		const bool bHw0 = AES::s_UseHw;
+		AES::s_UseHw = !!iHw;
+
 		AES::Encoder enc;
 		enc.Init(hv.m_pData);
 		AES::StreamCipher asc;
@@ -2602,7 +3266,7 @@ void RunBenchmark()
 
 		uint8_t pBuf[0x400];
 
-		BenchmarkMeter bm("AES.XCrypt-1MB");
+		BenchmarkMeter bm(AES::s_UseHw ? "AES.XCrypt-1MB.Hw" : "AES.XCrypt-1MB");
 		bm.N = 10;
 		do
 		{
@@ -2613,6 +3277,8 @@ void RunBenchmark()
 			}
 
 		} while (bm.ShouldContinue());
+
+		AES::s_UseHw = bHw0;
 	}
 
 	{
@@ -16,6 +16,7 @@
 #include "../radixtree.h"
 #include "../navigator.h"
 #include "../../utility/serialize.h"
+#include "../../utility/executor.h"
 
 #ifndef WIN32
 #	include <unistd.h>
@@ -412,6 +413,244 @@ namespace beam
 		verify_test(hv1 == hv2);
 	}
 
+	struct MyExecutor
+		:public ExecutorMT
+	{
+		uint32_t m_Threads;
+
+		virtual uint32_t get_Threads() override { return m_Threads; }
+
+		virtual void RunThread(uint32_t iThread) override
+		{
+			ExecutorMT::Context ctx;
+			ctx.m_iThread = iThread;
+			RunThreadCtx(ctx);
+		}
+	};
+
+	void UtxoTreeInsert(UtxoTree& t, const UtxoTree::Key& key)
+	{
+		UtxoTree::Cursor cu;
+		bool bCreate = true;
+		UtxoTree::MyLeaf* p = t.Find(cu, key, bCreate);
+
+		if (bCreate)
+			p->m_ID = 0;
+		else
+			t.PushID(0, *p);
+	}
+
+	void UtxoTreeDelete(UtxoTree& t, const UtxoTree::Key& key)
+	{
+		UtxoTree::Cursor cu;
+		bool bCreate = false;
+		UtxoTree::MyLeaf* p = t.Find(cu, key, bCreate);
+		verify_test(p);
+
+		if (p->IsExt())
+			t.PopID(*p);
+		else
+			t.Delete(cu);
+	}
+
+	void GenerateUtxoKeys(std::vector<UtxoTree::Key>& vKeys, uint32_t nCount)
+	{
+		vKeys.resize(nCount);
+		for (uint32_t i = 0; i < nCount; i++)
+		{
+			UtxoTree::Key::Data d;
+			SetRandomUtxoKey(d);
+			vKeys[i] = d;
+		}
+	}
+
+	void TestUtxoTreeMT()
+	{
+		std::vector<UtxoTree::Key> vKeys;
+		GenerateUtxoKeys(vKeys, 50000);
+
+		UtxoTree t1, t2;
+		Merkle::Hash hv1, hv2;
+
+		MyExecutor ex;
+		ex.m_Threads = 4;
+
+		for (uint32_t iCycle = 0; iCycle < 3; iCycle++)
+		{
+			// modify: insert all, then delete some of them (the 1st cycle builds the tree)
+			for (uint32_t i = 0; i < vKeys.size(); i++)
+			{
+				if (iCycle && (i % (iCycle * 7)))
+					continue;
+
+				UtxoTreeInsert(t1, vKeys[i]);
+				UtxoTreeInsert(t2, vKeys[i]);
+
+				if (iCycle && !(i % 3))
+				{
+					UtxoTreeDelete(t1, vKeys[i]);
+					UtxoTreeDelete(t2, vKeys[i]);
+				}
+			}
+
+			t1.get_Hash(hv1);
+
+			{
+				Executor::Scope scope(ex);
+				t2.get_Hash(hv2);
+			}
+
+			verify_test(hv1 == hv2);
+		}
+	}
+
+	void TestUtxoTreeMapped()
+	{
+		const char* szPath = "utxo_test.bin";
+
+		std::vector<UtxoTree::Key> vKeys;
+		GenerateUtxoKeys(vKeys, 20000);
+
+		UtxoTreeMapped::Stamp us = 1U;
+
+		UtxoTree t0; // reference
+		UtxoTreeMapped t1;
+		t1.Open(szPath, us, MappedFile::Flags::HugePages | MappedFile::Flags::Prefault);
+
+		TxoID nID = 0;
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+		{
+			for (uint32_t j = 0; j < 1 + !(i % 5); j++, nID++) // some duplicates
+			{
+				for (uint32_t iTree = 0; iTree < 2; iTree++)
+				{
+					UtxoTree& t = iTree ? Cast::Down<UtxoTree>(t1) : t0;
+					if (iTree)
+						t1.EnsureReserve();
+
+					UtxoTree::Cursor cu;
+					bool bCreate = true;
+					UtxoTree::MyLeaf* p = t.Find(cu, vKeys[i], bCreate);
+
+					if (bCreate)
+						p->m_ID = nID;
+					else
+						t.PushID(nID, *p);
+				}
+			}
+		}
+
+		// fragment it
+		for (uint32_t i = 0; i < vKeys.size(); i += 2)
+		{
+			UtxoTreeDelete(t0, vKeys[i]);
+			UtxoTreeDelete(t1, vKeys[i]);
+		}
+
+		t1.OnDirty();
+
+		Merkle::Hash hv0, hv1;
+		t0.get_Hash(hv0);
+		t1.get_Hash(hv1);
+		verify_test(hv0 == hv1);
+
+		uint64_t nFree = t1.get_FreeSize();
+		verify_test(nFree);
+
+		t1.Compact();
+		verify_test(t1.get_FreeSize() < nFree);
+
+		t1.get_Hash(hv1);
+		verify_test(hv0 == hv1);
+
+		// the order of IDs must be preserved
+		for (uint32_t i = 1; i < vKeys.size(); i += 2)
+		{
+			UtxoTree::Cursor cu0, cu1;
+			bool bCreate = false;
+			UtxoTree::MyLeaf* p0 = t0.Find(cu0, vKeys[i], bCreate);
+			UtxoTree::MyLeaf* p1 = t1.Find(cu1, vKeys[i], bCreate);
+			verify_test(p0 && p1);
+
+			verify_test(p0->get_Count() == p1->get_Count());
+			if (p0->IsExt())
+				verify_test(t0.PopID(*p0) == t1.PopID(*p1));
+			else
+				verify_test(p0->m_ID == p1->m_ID);
+		}
+
+		t1.get_Hash(hv1);
+		t0.get_Hash(hv0);
+		verify_test(hv0 == hv1);
+
+		t1.FlushStrict(us);
+		t1.Close();
+
+		// reopen
+		verify_test(t1.Open(szPath, us));
+		t1.get_Hash(hv1);
+		verify_test(hv0 == hv1);
+
+		t1.Close();
+		DeleteFile(szPath);
+	}
+
+	void RunUtxoTreeBenchmark(uint32_t nLeaves)
+	{
+		printf("UtxoTree root recomputation, Leaves=%u\n", nLeaves);
+
+		std::vector<UtxoTree::Key> vKeys;
+		GenerateUtxoKeys(vKeys, nLeaves);
+
+		const uint32_t nModify = 5000; // roughly a block worth of changes
+
+		uint32_t nThreadsMax = std::max(std::thread::hardware_concurrency(), 1U);
+		Merkle::Hash hv0;
+
+		for (uint32_t nThreads = 1; ; nThreads = std::min(nThreads * 4, nThreadsMax))
+		{
+			MyExecutor ex;
+			ex.m_Threads = nThreads;
+
+			UtxoTree t;
+			for (uint32_t i = 0; i < nLeaves; i++)
+				UtxoTreeInsert(t, vKeys[i]);
+
+			Merkle::Hash hvFull, hvInc;
+
+			uint32_t t0_ms = GetTime_ms();
+			{
+				Executor::Scope scope(ex);
+				t.get_Hash(hvFull);
+			}
+			uint32_t dtFull_ms = GetTime_ms() - t0_ms;
+
+			for (uint32_t i = 0; i < nModify; i++)
+			{
+				const UtxoTree::Key& key = vKeys[(i * 7919) % nLeaves];
+				UtxoTreeInsert(t, key);
+				UtxoTreeDelete(t, vKeys[(i * 104729) % nLeaves]);
+			}
+
+			t0_ms = GetTime_ms();
+			{
+				Executor::Scope scope(ex);
+				t.get_Hash(hvInc);
+			}
+			uint32_t dtInc_ms = GetTime_ms() - t0_ms;
+
+			printf("\tThreads=%u, Full=%u ms, Modified %u leaves=%u ms\n", nThreads, dtFull_ms, nModify * 2, dtInc_ms);
+
+			if (1 == nThreads)
+				hv0 = hvFull;
+			else
+				verify_test(hv0 == hvFull);
+
+			if (nThreads == nThreadsMax)
+				break;
+		}
+	}
+
 	struct MyMmr
 		:public Merkle::Mmr
 	{
@@ -671,11 +910,18 @@ namespace beam
 
 } // namespace beam
 
-int main()
+int main(int argc, char* argv[])
 {
 	beam::TestNavigator();
 	beam::TestUtxoTree();
+	beam::TestUtxoTreeMT();
+	beam::TestUtxoTreeMapped();
 	beam::TestMmr();
 
+	// benchmark, off by default. Pass the number of leaves to run it (i.e. 1000000, or 10000000 for larger trees)
+	uint32_t nLeaves = (argc > 1) ? static_cast<uint32_t>(atol(argv[1])) : 0;
+	if (nLeaves)
+		beam::RunUtxoTreeBenchmark(nLeaves);
+
 	return g_TestsFailed ? -1 : 0;
 }
@@ -16,6 +16,14 @@
 #include "../core/peer_manager.h"
 #include "../utility/logger.h"
 
+#ifndef WIN32
+#	include <errno.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <sys/types.h>
+#	include <unistd.h>
+#endif // WIN32
+
 namespace beam {
 
 
@@ -38,8 +46,8 @@ namespace beam {
 #define TblStates_CountNextF	"CountNextFunctional"
 #define TblStates_PoW			"PoW"
 #define TblStates_Rollback		"Mmr" // For historical reasons it was used for states MMR. Not it's a rollback data
-#define TblStates_BodyP			"Perishable"
-#define TblStates_BodyE			"Ethernal"
+#define TblStates_BodyP			"Perishable" // either the body blob, or an integer BlockStore reference
+#define TblStates_BodyE			"Ethernal" // same
 #define TblStates_Peer			"Peer"
 #define TblStates_ChainWork		"ChainWork"
 #define TblStates_Txos			"Txos"
@@ -99,10 +107,21 @@ namespace beam {
 #define TblAssets_Data			"MetaData"
 #define TblAssets_LockHeight	"LockHeight"
 
+#define TblBlkSeg				"BlockSegments"
+#define TblBlkSeg_ID			"ID"
+#define TblBlkSeg_Size			"Size" // used, i.e. the append position
+#define TblBlkSeg_Live			"Live" // bytes still referenced
+
+#define TblBlkFree				"BlockFree"
+#define TblBlkFree_Seg			"Segment"
+#define TblBlkFree_Offset		"Offset"
+#define TblBlkFree_Size			"Size"
+
 NodeDB::NodeDB()
 	:m_pDb(NULL)
 {
 	ZeroObject(m_pPrep);
+	ZeroObject(m_ppStreamImage);
 }
 
 NodeDB::~NodeDB()
@@ -229,6 +248,11 @@ bool NodeDB::Recordset::IsNull(int col)
 	return SQLITE_NULL == sqlite3_column_type(m_pStmt, col);
 }
 
+bool NodeDB::Recordset::IsInt(int col)
+{
+	return SQLITE_INTEGER == sqlite3_column_type(m_pStmt, col);
+}
+
 void NodeDB::Recordset::putNull(int col)
 {
 	m_pDB->TestRet(sqlite3_bind_null(m_pStmt, col+1));
@@ -334,12 +358,13 @@ void NodeDB::Open(const char* szPath)
 		bCreate = !rs.Step();
 	}
 
-	const uint64_t nVersionTop = 21;
+	const uint64_t nVersionTop = 22;
 
 	Transaction t(*this);
 
 	if (bCreate)
 	{
+		ExecQuick("PRAGMA auto_vacuum=INCREMENTAL"); // must precede the 1st table creation
 		Create();
 		ParamIntSet(ParamID::DbVer, nVersionTop);
 	}
@@ -366,6 +391,10 @@ void NodeDB::Open(const char* szPath)
 
 			LOG_INFO() << "DB migrate from" << 20;
 			MigrateFrom20();
+			// no break;
+
+		case 21: // before BlockStore
+			CreateTables22();
 
 			ParamIntSet(ParamID::DbVer, nVersionTop);
 			// no break;
@@ -487,6 +516,7 @@ void NodeDB::Create()
 		"[" TblTxo_SpendHeight		"] INTEGER)");
 
 	CreateTables20();
+	CreateTables22();
 }
 
 void NodeDB::CreateTables20()
@@ -509,11 +539,60 @@ void NodeDB::CreateTables20()
 	ExecQuick("CREATE INDEX [Idx" TblAssets "Own] ON [" TblAssets "] ([" TblAssets_Owner "])");
 }
 
+void NodeDB::CreateTables22()
+{
+	ExecQuick("CREATE TABLE [" TblBlkSeg "] ("
+		"[" TblBlkSeg_ID			"] INTEGER NOT NULL PRIMARY KEY,"
+		"[" TblBlkSeg_Size			"] INTEGER NOT NULL,"
+		"[" TblBlkSeg_Live			"] INTEGER NOT NULL)");
+
+	ExecQuick("CREATE TABLE [" TblBlkFree "] ("
+		"[" TblBlkFree_Seg			"] INTEGER NOT NULL,"
+		"[" TblBlkFree_Offset		"] INTEGER NOT NULL,"
+		"[" TblBlkFree_Size			"] INTEGER NOT NULL)");
+}
+
 void NodeDB::Vacuum()
 {
+	ExecQuick("PRAGMA auto_vacuum=INCREMENTAL"); // for existing DBs takes effect upon VACUUM
 	ExecQuick("VACUUM");
 }
 
+void NodeDB::VacuumInto(const char* szPath)
+{
+	Recordset rs(*this, Query::VacuumInto, "VACUUM INTO ?");
+	rs.put(0, szPath);
+	rs.Step();
+}
+
+bool NodeDB::IsVacuumIncremental()
+{
+	Recordset rs(*this, Query::AutoVacuum, "PRAGMA auto_vacuum");
+	rs.StepStrict();
+
+	uint32_t nMode;
+	rs.get(0, nMode);
+	return (2 == nMode);
+}
+
+uint64_t NodeDB::get_FreePages()
+{
+	Recordset rs(*this, Query::FreePages, "PRAGMA freelist_count");
+	rs.StepStrict();
+
+	uint64_t nRet;
+	rs.get(0, nRet);
+	return nRet;
+}
+
+void NodeDB::VacuumIncremental(uint32_t nPages)
+{
+	// pragma arguments can't be bound
+	char szSql[0x40];
+	snprintf(szSql, _countof(szSql), "PRAGMA incremental_vacuum(%u)", nPages);
+	ExecQuick(szSql);
+}
+
 void NodeDB::ExecQuick(const char* szSql)
 {
 	int n = sqlite3_total_changes(m_pDb);
@@ -714,6 +793,7 @@ void NodeDB::Transaction::Start(NodeDB& db)
 void NodeDB::Transaction::Commit()
 {
 	assert(m_pDB);
+	m_pDB->BlockStoreSync(); // referenced bodies must be durable before the references are
 	m_pDB->ExecStep(Query::Commit, "COMMIT");
 	m_pDB = NULL;
 }
@@ -926,6 +1006,8 @@ bool NodeDB::DeleteState(uint64_t rowid, uint64_t& rowPrev)
 	if (StateFlags::Reachable & nFlags)
 		TipReachableDel(rowid);
 
+	BlockStoreReleaseBody(rowid, true, true); // abandoned branches may still have bodies
+
 	rs.Reset(*this, Query::StateDel, "DELETE FROM " TblStates " WHERE rowid=?");
 	rs.put(0, rowid);
 
@@ -1378,11 +1460,13 @@ TxoID NodeDB::FindStateByTxoID(StateID& sid, TxoID id0)
 
 void NodeDB::SetStateBlock(uint64_t rowid, const Blob& bodyP, const Blob& bodyE, const PeerID& peer)
 {
+	BlockStoreReleaseBody(rowid, true, true);
+
 	Recordset rs(*this, Query::StateSetBlock, "UPDATE " TblStates " SET " TblStates_BodyP "=?," TblStates_BodyE "=?," TblStates_Peer "=? WHERE rowid=?");
 	if (bodyP.n)
-		rs.put(0, bodyP);
+		BlockStorePut(rs, 0, bodyP);
 	if (bodyE.n)
-		rs.put(1, bodyE);
+		BlockStorePut(rs, 1, bodyE);
 	rs.put(2, peer);
 	rs.put(3, rowid);
 
@@ -1397,15 +1481,17 @@ void NodeDB::GetStateBlock(uint64_t rowid, ByteBuffer* pP, ByteBuffer* pE, ByteB
 	rs.StepStrict();
 
 	if (pP && !rs.IsNull(0))
-		rs.get(0, *pP);
+		BlockStoreGet(rs, 0, *pP);
 	if (pE && !rs.IsNull(1))
-		rs.get(1, *pE);
+		BlockStoreGet(rs, 1, *pE);
 	if (pRB && !rs.IsNull(2))
 		rs.get(2, *pRB);
 }
 
 void NodeDB::DelStateBlockPP(uint64_t rowid)
 {
+	BlockStoreReleaseBody(rowid, true, false);
+
 	Recordset rs(*this, Query::StateDelBlockPP, "UPDATE " TblStates " SET " TblStates_BodyP "=NULL," TblStates_Peer "=NULL WHERE rowid=?");
 	rs.put(0, rowid);
 	rs.Step();
@@ -1414,6 +1500,8 @@ void NodeDB::DelStateBlockPP(uint64_t rowid)
 
 void NodeDB::DelStateBlockPPR(uint64_t rowid)
 {
+	BlockStoreReleaseBody(rowid, true, false);
+
 	Recordset rs(*this, Query::StateDelBlockPPR, "UPDATE " TblStates " SET " TblStates_BodyP "=NULL," TblStates_Rollback "=NULL," TblStates_Peer "=NULL WHERE rowid=?");
 	rs.put(0, rowid);
 	rs.Step();
@@ -1422,6 +1510,8 @@ void NodeDB::DelStateBlockPPR(uint64_t rowid)
 
 void NodeDB::DelStateBlockAll(uint64_t rowid)
 {
+	BlockStoreReleaseBody(rowid, true, true);
+
 	Recordset rs(*this, Query::StateDelBlockAll, "UPDATE " TblStates
 		" SET " TblStates_BodyP "=NULL," TblStates_BodyE "=NULL," TblStates_Rollback "=NULL," TblStates_Peer "=NULL," TblStates_Extra "=NULL," TblStates_Txos "=NULL WHERE rowid=?");
 	rs.put(0, rowid);
@@ -2021,6 +2111,15 @@ Height NodeDB::GetDummyHeight(const Key::ID& kid)
 	return h;
 }
 
+void NodeDB::EraseOwnData()
+{
+	ParamSet(ParamID::MyID, nullptr, nullptr);
+	ParamSet(ParamID::DummyID, nullptr, nullptr); // would trigger the rescan for the owner key, if any
+	DeleteEventsFrom(0);
+
+	ExecStep(Query::DummyDelAll, "DELETE FROM " TblDummy);
+}
+
 void NodeDB::DeleteDummy(const Key::ID& kid)
 {
 	Recordset rs(*this, Query::DummyDel, "DELETE FROM " TblDummy " WHERE " TblDummy_ID "=?");
@@ -2083,6 +2182,38 @@ Height NodeDB::FindKernel(const Blob& key)
 	return h;
 }
 
+bool NodeDB::FindKernelAt(const Blob& key, Height h)
+{
+	Recordset rs(*this, Query::KernelFindAt, "SELECT " TblKernels_Height " FROM " TblKernels " WHERE " TblKernels_Key "=? AND " TblKernels_Height "=?");
+	rs.put(0, key);
+	rs.put(1, h);
+	return rs.Step();
+}
+
+uint64_t NodeDB::get_KernelsCount()
+{
+	Recordset rs(*this, Query::KernelCount, "SELECT COUNT(*) FROM " TblKernels);
+	rs.StepStrict();
+
+	uint64_t nRet;
+	rs.get(0, nRet);
+	return nRet;
+}
+
+void NodeDB::EnumKernels(WalkerKernel& wlk)
+{
+	wlk.m_Rs.Reset(*this, Query::KernelEnum, "SELECT " TblKernels_Key " FROM " TblKernels);
+}
+
+bool NodeDB::WalkerKernel::MoveNext()
+{
+	if (!m_Rs.Step())
+		return false;
+
+	m_Rs.get(0, m_ID);
+	return true;
+}
+
 Height NodeDB::FindBlock(const Blob& hash)
 {
     Recordset rs(*this, Query::BlockFind, "SELECT " TblStates_Height " FROM " TblStates" WHERE " TblStates_Hash "=? ORDER BY " TblStates_Height " DESC LIMIT 1");
@@ -2328,6 +2459,42 @@ void NodeDB::StreamResize(StreamType::Enum eType, uint64_t n, uint64_t n0)
 		if (ret != nBlobs0 - nBlobs1)
 			ThrowInconsistent();
 	}
+
+	IStreamImage* pImage = m_ppStreamImage[eType];
+	if (pImage)
+		pImage->Resize(nBlobs1 * s_StreamBlob);
+}
+
+uint64_t NodeDB::get_StreamSize(StreamType::Enum eType)
+{
+	Recordset rs(*this, Query::StreamCount, "SELECT COUNT(*) FROM " TblStreams " WHERE " TblStream_ID ">=? AND " TblStream_ID "<?");
+	rs.put(0, StreamType::Key(0, eType));
+	rs.put(1, StreamType::Key(0, static_cast<StreamType::Enum>(eType + 1)));
+	rs.StepStrict();
+
+	uint64_t nBlobs;
+	rs.get(0, nBlobs);
+	return nBlobs * s_StreamBlob;
+}
+
+void NodeDB::StreamImageAttach(StreamType::Enum eType, IStreamImage* pImage, bool bFill)
+{
+	m_ppStreamImage[eType] = nullptr;
+
+	if (pImage && bFill)
+	{
+		uint64_t nSize = get_StreamSize(eType);
+		pImage->Resize(nSize);
+
+		std::vector<uint8_t> vBuf(s_StreamBlob);
+		for (uint64_t pos = 0; pos < nSize; pos += s_StreamBlob)
+		{
+			StreamIO(eType, pos, &vBuf.front(), s_StreamBlob, false);
+			pImage->Write(pos, &vBuf.front(), s_StreamBlob);
+		}
+	}
+
+	m_ppStreamImage[eType] = pImage;
 }
 
 void NodeDB::ShieldedResize(uint64_t n, uint64_t n0)
@@ -2347,6 +2514,18 @@ void NodeDB::StreamIO(StreamType::Enum eType, uint64_t pos, uint8_t* p, uint64_t
 				BEAM_VERIFY(SQLITE_OK == sqlite3_blob_close(m_pPtr));
 		}
 	};
+
+	IStreamImage* pImage = m_ppStreamImage[eType];
+	if (pImage)
+	{
+		if (!bWrite)
+		{
+			pImage->Read(pos, p, nCount);
+			return;
+		}
+
+		pImage->Write(pos, p, nCount);
+	}
 
 	uint64_t nBlob0 = pos / s_StreamBlob;
 	uint32_t nOffs = static_cast<uint32_t>(pos % s_StreamBlob);
@@ -2415,6 +2594,16 @@ void NodeDB::UniqueDeleteStrict(const Blob& key)
 	TestChanged1Row();
 }
 
+uint64_t NodeDB::get_UniqueCount()
+{
+	Recordset rs(*this, Query::UniqueCount, "SELECT COUNT(*) FROM " TblUnique);
+	rs.StepStrict();
+
+	uint64_t nRet;
+	rs.get(0, nRet);
+	return nRet;
+}
+
 const Asset::ID NodeDB::s_AssetEmpty0 = Asset::s_MaxCount;
 
 Asset::ID NodeDB::AssetFindByOwner(const PeerID& owner)
@@ -2640,4 +2829,483 @@ void NodeDB::MigrateFrom20()
 	}
 }
 
+/////////////////////////////
+// BlockStore
+uint64_t NodeDB::BlockStore::Ref::Export() const
+{
+	assert((m_iSeg <= s_SegMax) && (m_Size <= s_SizeMax) && !(m_Offset % s_Align));
+
+	uint64_t val = m_iSeg;
+	val = (val << 24) | (m_Offset / s_Align);
+	val = (val << 24) | m_Size;
+	return val;
+}
+
+void NodeDB::BlockStore::Ref::Import(uint64_t val)
+{
+	m_Size = static_cast<uint32_t>(val & s_SizeMax);
+	val >>= 24;
+	m_Offset = static_cast<uint32_t>(val & 0xffffff) * s_Align;
+	m_iSeg = static_cast<uint32_t>(val >> 24);
+}
+
+void NodeDB::BlockStore::get_Path(std::string& sPath, uint32_t iSeg) const
+{
+	sPath = m_sPrefix + std::to_string(iSeg) + ".dat";
+}
+
+bool NodeDB::BlockStore::File::IsOpen() const
+{
+#ifdef WIN32
+	return INVALID_HANDLE_VALUE != m_hFile;
+#else // WIN32
+	return -1 != m_hFile;
+#endif // WIN32
+}
+
+bool NodeDB::BlockStore::File::Open(const char* sz)
+{
+	Close();
+
+#ifdef WIN32
+	m_hFile = CreateFileW(Utf8toUtf16(sz).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, 0, NULL);
+#else // WIN32
+	m_hFile = open(sz, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP);
+#endif // WIN32
+
+	return IsOpen();
+}
+
+void NodeDB::BlockStore::File::Close()
+{
+	if (!IsOpen())
+		return;
+
+#ifdef WIN32
+	BEAM_VERIFY(CloseHandle(m_hFile));
+	m_hFile = INVALID_HANDLE_VALUE;
+#else // WIN32
+	BEAM_VERIFY(!close(m_hFile));
+	m_hFile = -1;
+#endif // WIN32
+}
+
+uint64_t NodeDB::BlockStore::File::get_Size()
+{
+#ifdef WIN32
+	LARGE_INTEGER val;
+	if (!GetFileSizeEx(m_hFile, &val))
+		return 0;
+	return val.QuadPart;
+#else // WIN32
+	struct stat stats;
+	if (fstat(m_hFile, &stats))
+		return 0;
+	return stats.st_size;
+#endif // WIN32
+}
+
+bool NodeDB::BlockStore::File::Resize(uint64_t n)
+{
+#ifdef WIN32
+	return
+		SetFilePointerEx(m_hFile, (const LARGE_INTEGER&) n, NULL, FILE_BEGIN) &&
+		SetEndOfFile(m_hFile);
+#else // WIN32
+	return !ftruncate(m_hFile, n);
+#endif // WIN32
+}
+
+bool NodeDB::BlockStore::File::Read(uint64_t nOffset, void* p, uint32_t n)
+{
+	while (n)
+	{
+#ifdef WIN32
+		OVERLAPPED ov;
+		ZeroObject(ov);
+		ov.Offset = static_cast<DWORD>(nOffset);
+		ov.OffsetHigh = static_cast<DWORD>(nOffset >> 32);
+
+		DWORD dw = 0;
+		if (!ReadFile(m_hFile, p, n, &dw, &ov) || !dw)
+			return false;
+#else // WIN32
+		ssize_t dw = pread(m_hFile, p, n, nOffset);
+		if (dw <= 0)
+		{
+			if ((dw < 0) && (EINTR == errno))
+				continue;
+			return false;
+		}
+#endif // WIN32
+
+		p = reinterpret_cast<uint8_t*>(p) + dw;
+		nOffset += dw;
+		n -= static_cast<uint32_t>(dw);
+	}
+
+	return true;
+}
+
+bool NodeDB::BlockStore::File::Write(uint64_t nOffset, const void* p, uint32_t n)
+{
+	while (n)
+	{
+#ifdef WIN32
+		OVERLAPPED ov;
+		ZeroObject(ov);
+		ov.Offset = static_cast<DWORD>(nOffset);
+		ov.OffsetHigh = static_cast<DWORD>(nOffset >> 32);
+
+		DWORD dw = 0;
+		if (!WriteFile(m_hFile, p, n, &dw, &ov) || !dw)
+			return false;
+#else // WIN32
+		ssize_t dw = pwrite(m_hFile, p, n, nOffset);
+		if (dw <= 0)
+		{
+			if ((dw < 0) && (EINTR == errno))
+				continue;
+			return false;
+		}
+#endif // WIN32
+
+		p = reinterpret_cast<const uint8_t*>(p) + dw;
+		nOffset += dw;
+		n -= static_cast<uint32_t>(dw);
+	}
+
+	return true;
+}
+
+bool NodeDB::BlockStore::File::Sync()
+{
+#ifdef WIN32
+	return !!FlushFileBuffers(m_hFile);
+#else // WIN32
+	return !fsync(m_hFile);
+#endif // WIN32
+}
+
+void NodeDB::BlockStore::File::PunchHole(uint64_t nOffset, uint32_t n)
+{
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+	fallocate(m_hFile, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, nOffset, n); // don't care if not supported by the FS
+#else
+	// not supported. The space is reclaimed only when the whole segment is deleted
+	(void) nOffset;
+	(void) n;
+#endif
+}
+
+void NodeDB::OpenBlockStore(const char* szPrefix)
+{
+	assert(szPrefix && *szPrefix);
+	m_BlockStore.m_Files.clear();
+	m_BlockStore.m_setDirty.clear();
+	m_BlockStore.m_sPrefix = szPrefix;
+
+	BlockStore::Ref r;
+	BlockStoreGetLast(r);
+	if (r.m_iSeg > BlockStore::Ref::s_SegMax)
+	{
+		BlockStoreNewSegment(0);
+		return;
+	}
+
+	// discard appended data that wasn't committed
+	Recordset rs(*this, Query::BlkSegEnum, "SELECT " TblBlkSeg_ID "," TblBlkSeg_Size " FROM " TblBlkSeg);
+	while (rs.Step())
+	{
+		uint32_t iSeg;
+		uint64_t nSize;
+		rs.get(0, iSeg);
+		rs.get(1, nSize);
+
+		BlockStore::File& f = BlockStoreGetFile(iSeg);
+		if ((f.get_Size() > nSize) && !f.Resize(nSize))
+			ThrowError("BlockStore resize");
+	}
+}
+
+NodeDB::BlockStore::File& NodeDB::BlockStoreGetFile(uint32_t iSeg)
+{
+	BlockStore::File& f = m_BlockStore.m_Files[iSeg];
+	if (!f.IsOpen())
+	{
+		std::string sPath;
+		m_BlockStore.get_Path(sPath, iSeg);
+
+		if (!f.Open(sPath.c_str()))
+			ThrowError(("BlockStore open " + sPath).c_str());
+	}
+
+	return f;
+}
+
+void NodeDB::BlockStoreGetLast(BlockStore::Ref& r)
+{
+	Recordset rs(*this, Query::BlkSegGetLast, "SELECT " TblBlkSeg_ID "," TblBlkSeg_Size " FROM " TblBlkSeg " ORDER BY " TblBlkSeg_ID " DESC LIMIT 1");
+	if (rs.Step())
+	{
+		rs.get(0, r.m_iSeg);
+		rs.get(1, r.m_Offset);
+	}
+	else
+	{
+		r.m_iSeg = static_cast<uint32_t>(-1);
+		r.m_Offset = 0;
+	}
+}
+
+void NodeDB::BlockStoreNewSegment(uint32_t iSeg)
+{
+	Recordset rs(*this, Query::BlkSegIns, "INSERT INTO " TblBlkSeg " (" TblBlkSeg_ID "," TblBlkSeg_Size "," TblBlkSeg_Live ") VALUES(?,0,0)");
+	rs.put(0, iSeg);
+	rs.Step();
+	TestChanged1Row();
+
+	// may be a leftover of a discarded DB
+	if (!BlockStoreGetFile(iSeg).Resize(0))
+		ThrowError("BlockStore resize");
+}
+
+bool NodeDB::BlockStoreAppend(const Blob& x, uint64_t& ref)
+{
+	if (!m_BlockStore.IsOpen() || !x.n || (x.n > BlockStore::Ref::s_SizeMax))
+		return false;
+
+	BlockStore::Ref r;
+	BlockStoreGetLast(r);
+
+	if (r.m_Offset + x.n > BlockStore::s_SegmentSize)
+	{
+		if (r.m_iSeg >= BlockStore::Ref::s_SegMax)
+			return false; // exhausted. Fall back to the DB
+
+		BlockStore::File& f = BlockStoreGetFile(r.m_iSeg);
+		if (m_BlockStore.m_setDirty.erase(r.m_iSeg) && !f.Sync())
+			ThrowError("BlockStore sync");
+
+		r.m_iSeg++;
+		r.m_Offset = 0;
+		BlockStoreNewSegment(r.m_iSeg);
+	}
+
+	r.m_Size = x.n;
+
+	if (!BlockStoreGetFile(r.m_iSeg).Write(r.m_Offset, x.p, x.n))
+		ThrowError("BlockStore write");
+
+	m_BlockStore.m_setDirty.insert(r.m_iSeg);
+
+	uint32_t nTail = r.m_Offset + x.n;
+	nTail += (BlockStore::s_Align - nTail % BlockStore::s_Align) % BlockStore::s_Align;
+
+	Recordset rs(*this, Query::BlkSegUpd, "UPDATE " TblBlkSeg " SET " TblBlkSeg_Size "=?," TblBlkSeg_Live "=" TblBlkSeg_Live "+? WHERE " TblBlkSeg_ID "=?");
+	rs.put(0, nTail);
+	rs.put(1, x.n);
+	rs.put(2, r.m_iSeg);
+	rs.Step();
+	TestChanged1Row();
+
+	ref = r.Export();
+	return true;
+}
+
+void NodeDB::BlockStoreRead(uint64_t ref, ByteBuffer& buf)
+{
+	if (!m_BlockStore.IsOpen())
+		ThrowError("BlockStore not opened");
+
+	BlockStore::Ref r;
+	r.Import(ref);
+
+	buf.resize(r.m_Size);
+	if (r.m_Size && !BlockStoreGetFile(r.m_iSeg).Read(r.m_Offset, &buf.front(), r.m_Size))
+		ThrowError("BlockStore read");
+}
+
+void NodeDB::BlockStoreRelease(uint64_t ref)
+{
+	BlockStore::Ref r;
+	r.Import(ref);
+
+	Recordset rs(*this, Query::BlkSegRelease, "UPDATE " TblBlkSeg " SET " TblBlkSeg_Live "=" TblBlkSeg_Live "-? WHERE " TblBlkSeg_ID "=?");
+	rs.put(0, r.m_Size);
+	rs.put(1, r.m_iSeg);
+	rs.Step();
+	TestChanged1Row();
+
+	rs.Reset(*this, Query::BlkFreeIns, "INSERT INTO " TblBlkFree " (" TblBlkFree_Seg "," TblBlkFree_Offset "," TblBlkFree_Size ") VALUES(?,?,?)");
+	rs.put(0, r.m_iSeg);
+	rs.put(1, r.m_Offset);
+	rs.put(2, r.m_Size);
+	rs.Step();
+	TestChanged1Row();
+}
+
+void NodeDB::BlockStoreReleaseBody(uint64_t rowid, bool bPerishable, bool bEthernal)
+{
+	uint64_t pRef[2];
+	bool pHas[2];
+
+	{
+		Recordset rs(*this, Query::StateGetBlockRefs, "SELECT " TblStates_BodyP "," TblStates_BodyE " FROM " TblStates " WHERE rowid=?");
+		rs.put(0, rowid);
+		rs.StepStrict();
+
+		pHas[0] = bPerishable && rs.IsInt(0);
+		pHas[1] = bEthernal && rs.IsInt(1);
+
+		for (int i = 0; i < 2; i++)
+			if (pHas[i])
+				rs.get(i, pRef[i]);
+	}
+
+	for (int i = 0; i < 2; i++)
+		if (pHas[i])
+			BlockStoreRelease(pRef[i]);
+}
+
+void NodeDB::BlockStorePut(Recordset& rs, int col, const Blob& x)
+{
+	uint64_t ref;
+	if (BlockStoreAppend(x, ref))
+		rs.put(col, ref);
+	else
+		rs.put(col, x);
+}
+
+void NodeDB::BlockStoreGet(Recordset& rs, int col, ByteBuffer& buf)
+{
+	if (rs.IsInt(col))
+	{
+		uint64_t ref;
+		rs.get(col, ref);
+		BlockStoreRead(ref, buf);
+	}
+	else
+		rs.get(col, buf);
+}
+
+void NodeDB::BlockStoreSync()
+{
+	for (auto it = m_BlockStore.m_setDirty.begin(); m_BlockStore.m_setDirty.end() != it; it++)
+		if (!BlockStoreGetFile(*it).Sync())
+			ThrowError("BlockStore sync");
+
+	m_BlockStore.m_setDirty.clear();
+}
+
+void NodeDB::CleanupBlockStore()
+{
+	if (!m_BlockStore.IsOpen())
+		return;
+
+	BlockStore::Ref rLast;
+	BlockStoreGetLast(rLast);
+
+	// segments with no live data are deleted entirely
+	std::vector<uint32_t> vDead;
+	{
+		Recordset rs(*this, Query::BlkSegEnumDead, "SELECT " TblBlkSeg_ID " FROM " TblBlkSeg " WHERE " TblBlkSeg_Live "=0 AND " TblBlkSeg_ID "<?");
+		rs.put(0, rLast.m_iSeg);
+		while (rs.Step())
+			rs.get(0, vDead.emplace_back());
+	}
+
+	for (size_t i = 0; i < vDead.size(); i++)
+	{
+		uint32_t iSeg = vDead[i];
+
+		m_BlockStore.m_Files.erase(iSeg);
+		m_BlockStore.m_setDirty.erase(iSeg);
+
+		std::string sPath;
+		m_BlockStore.get_Path(sPath, iSeg);
+		DeleteFile(sPath.c_str());
+
+		Recordset rs(*this, Query::BlkSegDel, "DELETE FROM " TblBlkSeg " WHERE " TblBlkSeg_ID "=?");
+		rs.put(0, iSeg);
+		rs.Step();
+
+		rs.Reset(*this, Query::BlkFreeDelSeg, "DELETE FROM " TblBlkFree " WHERE " TblBlkFree_Seg "=?");
+		rs.put(0, iSeg);
+		rs.Step();
+	}
+
+	// the rest - punch holes
+	bool bHoles = false;
+	{
+		Recordset rs(*this, Query::BlkFreeEnum, "SELECT " TblBlkFree_Seg "," TblBlkFree_Offset "," TblBlkFree_Size " FROM " TblBlkFree);
+		while (rs.Step())
+		{
+			BlockStore::Ref r;
+			rs.get(0, r.m_iSeg);
+			rs.get(1, r.m_Offset);
+			rs.get(2, r.m_Size);
+
+			BlockStoreGetFile(r.m_iSeg).PunchHole(r.m_Offset, r.m_Size);
+			bHoles = true;
+		}
+	}
+
+	if (bHoles)
+		ExecStep(Query::BlkFreeDel, "DELETE FROM " TblBlkFree);
+}
+
+uint64_t NodeDB::get_BlockStoreLive()
+{
+	Recordset rs(*this, Query::BlkSegLive, "SELECT SUM(" TblBlkSeg_Live ") FROM " TblBlkSeg);
+	if (!rs.Step() || rs.IsNull(0))
+		return 0;
+
+	uint64_t nRet;
+	rs.get(0, nRet);
+	return nRet;
+}
+
+void NodeDB::CopyBlockStore(const char* szPrefixSrc, const char* szPrefixDst)
+{
+	BlockStore bsSrc, bsDst;
+	bsSrc.m_sPrefix = szPrefixSrc;
+	bsDst.m_sPrefix = szPrefixDst;
+
+	std::vector<uint8_t> vBuf(1U << 20);
+
+	Recordset rs(*this, Query::BlkSegEnum, "SELECT " TblBlkSeg_ID "," TblBlkSeg_Size " FROM " TblBlkSeg);
+	while (rs.Step())
+	{
+		uint32_t iSeg;
+		uint64_t nSize;
+		rs.get(0, iSeg);
+		rs.get(1, nSize);
+
+		std::string sSrc, sDst;
+		bsSrc.get_Path(sSrc, iSeg);
+		bsDst.get_Path(sDst, iSeg);
+
+		BlockStore::File fSrc, fDst;
+		if (!fSrc.Open(sSrc.c_str()))
+			ThrowError(("BlockStore open " + sSrc).c_str());
+		if (!fDst.Open(sDst.c_str()) || !fDst.Resize(0))
+			ThrowError(("BlockStore open " + sDst).c_str());
+
+		// only the committed part, the rest (if any) is discarded anyway. The committed size includes the alignment of the last body
+		uint64_t nData = std::min(nSize, fSrc.get_Size());
+		for (uint64_t nPos = 0; nPos < nData; )
+		{
+			uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(vBuf.size(), nData - nPos));
+			if (!fSrc.Read(nPos, &vBuf.front(), n) || !fDst.Write(nPos, &vBuf.front(), n))
+				ThrowError(("BlockStore copy " + sSrc).c_str());
+
+			nPos += n;
+		}
+
+		if (!fDst.Resize(nSize) || !fDst.Sync())
+			ThrowError(("BlockStore sync " + sDst).c_str());
+	}
+}
+
 } // namespace beam
@@ -17,6 +17,7 @@
 #include "core/common.h"
 #include "core/block_crypt.h"
 #include "sqlite/sqlite3.h"
+#include <set>
 
 namespace beam {
 
@@ -70,6 +71,9 @@ public:
 			Commit,
 			Rollback,
 			Scheme,
+			AutoVacuum,
+			FreePages,
+			VacuumInto,
 			AutoincrementID,
 			ParamGet,
 			ParamIns,
@@ -141,9 +145,14 @@ public:
 			DummyFind,
 			DummyUpdHeight,
 			DummyDel,
+			DummyDelAll,
 			KernelIns,
 			KernelFind,
+			KernelFindAt,
 			KernelDel,
+			KernelCount,
+			KernelEnum,
+			StreamCount,
 			TxoAdd,
 			TxoDel,
 			TxoDelFrom,
@@ -160,6 +169,7 @@ public:
 			UniqueIns,
 			UniqueFind,
 			UniqueDel,
+			UniqueCount,
 
 			AssetFindOwner,
 			AssetFindMin,
@@ -168,6 +178,20 @@ public:
 			AssetGet,
 			AssetSetVal,
 
+			BlkSegGetLast,
+			BlkSegIns,
+			BlkSegUpd,
+			BlkSegRelease,
+			BlkSegEnum,
+			BlkSegEnumDead,
+			BlkSegLive,
+			BlkSegDel,
+			BlkFreeIns,
+			BlkFreeEnum,
+			BlkFreeDel,
+			BlkFreeDelSeg,
+			StateGetBlockRefs,
+
 			Dbg0,
 			Dbg1,
 			Dbg2,
@@ -199,9 +223,25 @@ public:
 	void Close();
 	void Open(const char* szPath);
 
-	void Vacuum();
+	void Vacuum(); // also switches the DB to the incremental auto-vacuum mode
+	void VacuumInto(const char* szPath); // compacted copy of the DB to a new file. Must be called outside of the transaction
 	void CheckIntegrity();
 
+	// Online compaction, applicable only in the incremental auto-vacuum mode (new DBs, or after the full Vacuum).
+	bool IsVacuumIncremental();
+	uint64_t get_FreePages();
+	void VacuumIncremental(uint32_t nPages); // releases up to nPages free pages (as a part of the current transaction)
+
+	// Optional flat-file storage for block bodies (perishable and eternal), outside of the DB.
+	// Once opened, new bodies are appended to segment files, and the States table references them by (segment, offset, size).
+	// Bodies stored before (as well as those that can't be referenced) remain in the DB.
+	void OpenBlockStore(const char* szPrefix);
+	void CleanupBlockStore(); // reclaim space of the deleted bodies. Should be called once they're committed
+	uint64_t get_BlockStoreLive(); // total size of the referenced bodies
+	void CopyBlockStore(const char* szPrefixSrc, const char* szPrefixDst); // copies the committed part of the segments referenced by this DB
+
+	void EraseOwnData(); // node identity, owner-recognized events, decoys. For the DB copies that are handed to other nodes
+
 	virtual void OnModified() {}
 
 	class Recordset
@@ -245,6 +285,7 @@ public:
 
 		void putNull(int col);
 		bool IsNull(int col);
+		bool IsInt(int col);
 
 		void put(int col, const Merkle::Hash& x) { put_As(col, x); }
 		void get(int col, Merkle::Hash& x) { get_As(col, x); }
@@ -474,6 +515,18 @@ public:
 	void InsertKernel(const Blob&, Height h);
 	void DeleteKernel(const Blob&, Height h);
 	Height FindKernel(const Blob&); // in case of duplicates - returning the one with the largest Height
+	bool FindKernelAt(const Blob&, Height);
+	uint64_t get_KernelsCount();
+
+	struct WalkerKernel
+	{
+		Recordset m_Rs;
+		Blob m_ID;
+
+		bool MoveNext();
+	};
+
+	void EnumKernels(WalkerKernel&);
     Height FindBlock(const Blob&);
 
 	uint64_t FindStateWorkGreater(const Difficulty::Raw&);
@@ -512,6 +565,18 @@ public:
 
 	void EnumSystemStatesBkwd(WalkerSystemState&, const StateID&);
 
+	// Optional memory-mapped copy of a stream. It's maintained by the owner (not covered by the DB transaction).
+	// If attached - the reads are served from it without SQLite round-trips, the writes go to both.
+	struct IStreamImage
+	{
+		virtual void Resize(uint64_t) = 0;
+		virtual void Read(uint64_t pos, uint8_t*, uint64_t nCount) = 0;
+		virtual void Write(uint64_t pos, const uint8_t*, uint64_t nCount) = 0;
+	};
+
+	void StreamImageAttach(StreamType::Enum, IStreamImage*, bool bFill); // bFill - copy the stream contents to the image
+	uint64_t get_StreamSize(StreamType::Enum);
+
 	class StreamMmr
 		:public Merkle::FlatMmr
 	{
@@ -571,6 +636,7 @@ public:
 	bool UniqueInsertSafe(const Blob& key, const Blob* pVal); // returns false if not unique (and doesn't update the value)
 	bool UniqueFind(const Blob& key, Recordset&);
 	void UniqueDeleteStrict(const Blob& key);
+	uint64_t get_UniqueCount();
 
 	void AssetAdd(Asset::Full&); // sets ID=0 to auto assign, otherwise - specified ID must be used
 	Asset::ID AssetFindByOwner(const PeerID&);
@@ -603,6 +669,7 @@ private:
 
 	void Create();
 	void CreateTables20();
+	void CreateTables22();
 	void ExecQuick(const char*);
 	std::string ExecTextOut(const char*);
 	bool ExecStep(sqlite3_stmt*);
@@ -627,11 +694,73 @@ private:
 	void MigrateFrom20();
 
 	static const uint32_t s_StreamBlob;
+	IStreamImage* m_ppStreamImage[StreamType::count];
 
 	void StreamIO(StreamType::Enum, uint64_t pos, uint8_t*, uint64_t nCount, bool bWrite);
 	void StreamResize(StreamType::Enum, uint64_t n, uint64_t n0);
 
 	void ShieldeIO(uint64_t pos, ECC::Point::Storage*, uint64_t nCount, bool bWrite);
+
+	struct BlockStore
+	{
+		static const uint32_t s_SegmentSize = 1U << 28; // 256MB
+		static const uint32_t s_Align = 0x10;
+
+		// packed into 64 bits: segment (16 bits), offset in s_Align units (24 bits), size (24 bits)
+		struct Ref
+		{
+			uint32_t m_iSeg;
+			uint32_t m_Offset;
+			uint32_t m_Size;
+
+			static const uint32_t s_SegMax = 0xffff;
+			static const uint32_t s_SizeMax = 0xffffff;
+
+			uint64_t Export() const;
+			void Import(uint64_t);
+		};
+
+		class File
+		{
+#ifdef WIN32
+			HANDLE m_hFile = INVALID_HANDLE_VALUE;
+#else // WIN32
+			int m_hFile = -1;
+#endif // WIN32
+
+		public:
+			~File() { Close(); }
+
+			bool IsOpen() const;
+			bool Open(const char*);
+			void Close();
+			uint64_t get_Size();
+			bool Resize(uint64_t);
+			bool Read(uint64_t nOffset, void*, uint32_t);
+			bool Write(uint64_t nOffset, const void*, uint32_t);
+			bool Sync();
+			void PunchHole(uint64_t nOffset, uint32_t);
+		};
+
+		std::string m_sPrefix; // empty if not used
+		std::map<uint32_t, File> m_Files; // opened on demand
+		std::set<uint32_t> m_setDirty; // written since the last sync
+
+		bool IsOpen() const { return !m_sPrefix.empty(); }
+		void get_Path(std::string&, uint32_t iSeg) const;
+
+	} m_BlockStore;
+
+	BlockStore::File& BlockStoreGetFile(uint32_t iSeg);
+	void BlockStoreGetLast(BlockStore::Ref&);
+	void BlockStoreNewSegment(uint32_t iSeg);
+	bool BlockStoreAppend(const Blob&, uint64_t& ref);
+	void BlockStoreRead(uint64_t ref, ByteBuffer&);
+	void BlockStoreRelease(uint64_t ref);
+	void BlockStoreReleaseBody(uint64_t rowid, bool bPerishable, bool bEthernal);
+	void BlockStorePut(Recordset&, int col, const Blob&);
+	void BlockStoreGet(Recordset&, int col, ByteBuffer&);
+	void BlockStoreSync();
 
 	static const Asset::ID s_AssetEmpty0;
 	void AssetInsertRaw(Asset::ID, const Asset::Full*);
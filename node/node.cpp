@@ -47,6 +47,39 @@ void Node::SyncStatus::ToRelative(Height hDone0)
 	m_Total -= hDone0;
 }
 
+void Node::HdrRate::OnStart(SyncStatus& ss, uint64_t now_ms)
+{
+	if (m_Last_ms && (now_ms - m_Last_ms < s_Idle_ms))
+		return;
+
+	// first pack, or after a long pause. Older measurement is irrelevant
+	ss.m_HdrsPerSec = 0;
+	m_Start_ms = now_ms;
+	m_Count = 0;
+}
+
+void Node::HdrRate::OnStop(SyncStatus& ss)
+{
+	// headers sync is over (or not needed). Don't report the stale rate during the blocks sync
+	ss.m_HdrsPerSec = 0;
+	m_Last_ms = 0;
+}
+
+void Node::HdrRate::OnDone(SyncStatus& ss, uint64_t now_ms, uint32_t nCount)
+{
+	m_Last_ms = now_ms;
+	m_Count += nCount;
+
+	uint64_t dt_ms = now_ms - m_Start_ms;
+	if (dt_ms < s_Window_ms)
+		return;
+
+	ss.m_HdrsPerSec = static_cast<uint32_t>(m_Count * 1000 / dt_ms);
+
+	m_Start_ms = now_ms;
+	m_Count = 0;
+}
+
 void Node::RefreshCongestions()
 {
 	for (TaskSet::iterator it = m_setTasks.begin(); m_setTasks.end() != it; it++)
@@ -94,6 +127,7 @@ void Node::UpdateSyncStatusRaw()
 	Height hTotal = m_Processor.m_Cursor.m_ID.m_Height;
 	Height hDoneBlocks = hTotal;
 	Height hDoneHdrs = hTotal;
+	bool bHdrs = false;
 
 	if (m_Processor.IsFastSync())
 		hTotal = m_Processor.m_SyncData.m_Target.m_Height;
@@ -117,6 +151,8 @@ void Node::UpdateSyncStatusRaw()
 		}
 		else
 		{
+			bHdrs = true;
+
 			if (!t.m_pOwner)
 				continue; // don't account for unowned
 
@@ -165,6 +201,9 @@ void Node::UpdateSyncStatusRaw()
 
 	m_SyncStatus.m_Total = hTotal * (SyncStatus::s_WeightHdr + SyncStatus::s_WeightBlock);
 	m_SyncStatus.m_Done = hDoneHdrs * SyncStatus::s_WeightHdr + hDoneBlocks * SyncStatus::s_WeightBlock;
+
+	if (!bHdrs)
+		m_HdrRate.OnStop(m_SyncStatus);
 }
 
 void Node::DeleteUnassignedTask(Task& t)
@@ -565,6 +604,7 @@ void Node::Processor::DeleteOutdated()
 void Node::Processor::OnNewState()
 {
     m_Cwp.Reset();
+	get_ParentObj().m_RecentBodies.Clear(); // TxoLo/TxoHi and the fast-sync state may change, the served bodies should be re-checked
 
 	if (!IsTreasuryHandled())
         return;
@@ -586,6 +626,8 @@ void Node::Processor::OnNewState()
     proto::NewTip msg;
     msg.m_Description = m_Cursor.m_Full;
 
+    proto::SharedMsg sm; // serialized once for all the peers
+
     for (PeerList::iterator it = get_ParentObj().m_lstPeers.begin(); get_ParentObj().m_lstPeers.end() != it; it++)
     {
         Peer& peer = *it;
@@ -603,7 +645,7 @@ void Node::Processor::OnNewState()
 				continue;
 		}
 
-        peer.Send(msg);
+        peer.Send(sm, msg);
     }
 
     get_ParentObj().RefreshCongestions();
@@ -665,6 +707,8 @@ void Node::Processor::OnRolledBack()
 {
     LOG_INFO() << "Rolled back to: " << m_Cursor.m_ID;
 
+	get_ParentObj().m_RecentBodies.Clear(); // conservative, the served bodies may depend on the current state
+
 	// Delete shielded txs which referenced shielded outputs which were reverted
 	TxPool::Fluff& txp = get_ParentObj().m_TxPool;
 	for (TxPool::Fluff::Queue::iterator it = txp.m_Queue.begin(); txp.m_Queue.end() != it; )
@@ -705,7 +749,7 @@ void Node::Processor::MyExecutorMT::RunThread(uint32_t iThread)
 {
     MyExecutor::MyContext ctx;
     ctx.m_iThread = iThread;
-    ECC::InnerProduct::BatchContext::Scope scope(ctx.m_BatchCtx);
+    ECC::InnerProduct::BatchContext::Scope scope(*ctx.m_pBatchCtx);
 
     RunThreadCtx(ctx);
 }
@@ -744,12 +788,61 @@ void Node::Processor::OnGoUpTimer()
 	get_ParentObj().UpdateSyncStatus();
 }
 
+void Node::Processor::StartVacuum()
+{
+	const Config::Vacuum& cfg = get_ParentObj().m_Cfg.m_Vacuum;
+	if (!cfg.m_PagesPerStep || !get_DB().IsVacuumIncremental())
+		return;
+
+	if (!m_pVacuumTimer)
+		m_pVacuumTimer = io::Timer::create(io::Reactor::get_Current());
+
+	m_pVacuumTimer->start(cfg.m_Period_ms, true, [this]() { OnVacuumTimer(); });
+}
+
+void Node::Processor::OnVacuumTimer()
+{
+	if (m_bGoUpPending || m_bFlushPending)
+		return; // not idle
+
+	Node& n = get_ParentObj();
+	const Config::Vacuum& cfg = n.m_Cfg.m_Vacuum;
+
+	if (!m_VacuumTotal)
+	{
+		uint64_t nFree = get_DB().get_FreePages();
+		if (nFree < cfg.m_FreePagesMin)
+			return;
+
+		LOG_INFO() << "DB online compaction, free pages: " << nFree;
+		m_VacuumTotal = nFree;
+	}
+
+	uint64_t nRemaining = VacuumStep(cfg.m_PagesPerStep);
+	std::setmin(nRemaining, m_VacuumTotal); // may grow, if more data was deleted meanwhile
+
+	if (!nRemaining || (++m_VacuumSteps >= cfg.m_StepsPerCommit))
+		OnFlushTimer();
+
+	if (n.m_Cfg.m_Observer)
+		n.m_Cfg.m_Observer->OnVacuumProgress(m_VacuumTotal - nRemaining, m_VacuumTotal);
+
+	if (!nRemaining)
+	{
+		LOG_INFO() << "DB online compaction completed";
+		m_VacuumTotal = 0;
+	}
+}
+
 void Node::Processor::Stop()
 {
     m_ExecutorMT.Stop();
     m_bGoUpPending = false;
     m_bFlushPending = false;
 
+    if (m_pVacuumTimer)
+        m_pVacuumTimer->cancel();
+
     if (m_pGoUpTimer)
     {
         m_pGoUpTimer->cancel();
@@ -809,6 +902,7 @@ void Node::Processor::InitializeUtxosProgress(uint64_t done, uint64_t total)
 void Node::Processor::OnFlushTimer()
 {
     m_bFlushPending = false;
+    m_VacuumSteps = 0; // committed as well
     CommitDB();
 }
 
@@ -829,6 +923,7 @@ Node::Peer* Node::AllocPeer(const beam::io::Address& addr)
     m_lstPeers.push_back(*pPeer);
 
 	pPeer->m_UnsentHiMark = m_Cfg.m_BandwidthCtl.m_Drown;
+	pPeer->m_pIoPool = &m_IoPool;
     pPeer->m_pInfo = NULL;
     pPeer->m_Flags = 0;
     pPeer->m_Port = 0;
@@ -889,6 +984,9 @@ void Node::Initialize(IExternalPOW* externalPOW)
 	ZeroObject(m_SyncStatus);
     RefreshCongestions();
 
+	if (m_Cfg.m_IoThreads)
+		m_IoPool.Start(m_Cfg.m_IoThreads);
+
     if (m_Cfg.m_Listen.port())
     {
         m_Server.Listen(m_Cfg.m_Listen);
@@ -901,6 +999,8 @@ void Node::Initialize(IExternalPOW* externalPOW)
 	m_Processor.get_DB().get_BbsTotals(m_Bbs.m_Totals);
     m_Bbs.Cleanup();
 	m_Bbs.m_HighestPosted_s = m_Processor.get_DB().get_BbsMaxTime();
+
+	m_Processor.StartVacuum();
 }
 
 uint32_t Node::get_AcessiblePeerCount() const
@@ -1070,6 +1170,8 @@ Node::~Node()
     while (!m_lstPeers.empty())
         m_lstPeers.front().DeleteSelf(false, proto::NodeConnection::ByeReason::Stopping);
 
+    m_IoPool.Stop();
+
     while (!m_lstTasksUnassigned.empty())
         DeleteUnassignedTask(m_lstTasksUnassigned.front());
 
@@ -1413,6 +1515,7 @@ void Node::Peer::DeleteSelf(bool bIsError, uint8_t nByeReason)
 
     ReleaseTasks();
     Unsubscribe();
+    m_This.m_TxAdmission.OnPeerDeleted(*this);
 
     if (m_pInfo)
     {
@@ -1687,7 +1790,7 @@ bool Node::DecodeAndCheckHdrs(std::vector<Block::SystemState::Full>& v, const pr
 	{
 		const Block::SystemState::Full* m_pV;
 		uint32_t m_Count;
-		bool m_Valid;
+		volatile bool m_Valid;
 
 		virtual ~MyTask() {}
 
@@ -1697,8 +1800,11 @@ bool Node::DecodeAndCheckHdrs(std::vector<Block::SystemState::Full>& v, const pr
             ctx.get_Portion(i0, nCount, m_Count);
             nCount += i0;
 
-			for (; i0 < nCount; i0++)
-				if (!m_pV[i0].IsValid())
+			// verified in batches (the PoW hashes are computed together).
+			// once any header fails - the whole pack is rejected, no need to verify the rest
+			const uint32_t nBatch = 32;
+			for (; (i0 < nCount) && m_Valid; i0 += nBatch)
+				if (!Block::SystemState::Full::IsValidBatch(m_pV + i0, std::min(nBatch, nCount - i0)))
 					m_Valid = false;
 		}
 	};
@@ -1722,6 +1828,8 @@ void Node::Peer::OnMsg(proto::HdrPack&& msg)
 		ThrowUnexpected();
 	}
 
+	m_This.m_HdrRate.OnStart(m_This.m_SyncStatus, GetTime_ms());
+
 	std::vector<Block::SystemState::Full> v;
 	if (!m_This.DecodeAndCheckHdrs(v, msg))
         ThrowUnexpected();
@@ -1754,6 +1862,8 @@ void Node::Peer::OnMsg(proto::HdrPack&& msg)
 
 	ModifyRatingWrtData(sizeof(msg.m_Prefix) + msg.m_vElements.size() * sizeof(msg.m_vElements.front()));
 
+	m_This.m_HdrRate.OnDone(m_This.m_SyncStatus, GetTime_ms(), static_cast<uint32_t>(v.size()));
+
 	OnFirstTaskDone(NodeProcessor::DataStatus::Accepted);
 	m_This.UpdateSyncStatus();
 }
@@ -1815,10 +1925,29 @@ void Node::Peer::OnMsg(proto::GetBodyPack&& msg)
 			}
 			else
 			{
+				RecentBodies& rb = m_This.m_RecentBodies;
+				RecentBodies::Key key;
+				key.Set(msg);
+				bool bCache = (m_This.m_Cfg.m_BandwidthCtl.m_RecentBodies > 0) && key.IsFullBlock();
+
+				RecentBodies::Item* pItem = bCache ? rb.Find(msg) : nullptr;
+				if (pItem)
+				{
+					Send(pItem->m_Serialized, pItem->m_Msg);
+					return;
+				}
+
 				proto::Body msgBody;
 				if (GetBlock(msgBody.m_Body, sid, msg, false))
 				{
-					Send(msgBody);
+					if (bCache)
+					{
+						RecentBodies::Item& x = rb.Add(msg, std::move(msgBody));
+						Send(x.m_Serialized, x.m_Msg);
+					}
+					else
+						Send(msgBody);
+
 					return;
 				}
 			}
@@ -1988,25 +2117,340 @@ void Node::Peer::OnMsg(proto::NewTransaction&& msg)
         ThrowUnexpected(); // our deserialization permits NULL Ptrs.
     // However the transaction body must have already been checked for NULLs
 
-    if (msg.m_Fluff)
-        m_This.OnTransactionFluff(std::move(msg.m_Transaction), this, NULL);
-    else
-    {
-        proto::Status msgOut;
-		msgOut.m_Value = m_This.OnTransactionStem(std::move(msg.m_Transaction), this);
+    m_This.m_TxAdmission.Push(std::move(msg.m_Transaction), this, msg.m_Fluff); // for stem the status is sent once verified
+}
 
-        Send(msgOut);
-    }
+const Node::TxAdmissionStats& Node::get_TxAdmissionStats() const
+{
+	return m_TxAdmission.m_Stats;
+}
+
+const Node::RecentBodiesStats& Node::get_RecentBodiesStats() const
+{
+	return m_RecentBodies.m_Stats;
+}
+
+void Node::RecentBodies::Key::Set(const proto::GetBodyPack& msg)
+{
+	m_ID = msg.m_Top;
+	m_Height0 = msg.m_Height0;
+	m_FlagP = msg.m_FlagP;
+	m_FlagE = msg.m_FlagE;
+
+	// normalize the horizons the same way NodeProcessor::GetBlock does, so that the peers with different settings share the same item
+	m_HorizonHi1 = std::max(msg.m_HorizonHi1, m_ID.m_Height);
+	m_HorizonLo1 = std::max(msg.m_HorizonLo1, m_ID.m_Height - 1);
+}
+
+bool Node::RecentBodies::Key::IsFullBlock() const
+{
+	return (m_HorizonHi1 == m_ID.m_Height) && (m_HorizonLo1 + 1 == m_ID.m_Height);
+}
+
+bool Node::RecentBodies::Key::operator < (const Key& k) const
+{
+	if (m_ID < k.m_ID)
+		return true;
+	if (k.m_ID < m_ID)
+		return false;
+
+	if (m_Height0 != k.m_Height0)
+		return m_Height0 < k.m_Height0;
+	if (m_HorizonLo1 != k.m_HorizonLo1)
+		return m_HorizonLo1 < k.m_HorizonLo1;
+	if (m_HorizonHi1 != k.m_HorizonHi1)
+		return m_HorizonHi1 < k.m_HorizonHi1;
+	if (m_FlagP != k.m_FlagP)
+		return m_FlagP < k.m_FlagP;
+
+	return m_FlagE < k.m_FlagE;
 }
 
-uint8_t Node::ValidateTx(Transaction::Context& ctx, const Transaction& tx)
+Node::RecentBodies::Item* Node::RecentBodies::Find(const proto::GetBodyPack& msg)
 {
-	ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
+	Item n;
+	n.m_Key.Set(msg);
+
+	Set::iterator it = m_set.find(n);
+	if (m_set.end() == it)
+	{
+		m_Stats.m_Misses++;
+		return nullptr;
+	}
+
+	m_Stats.m_Hits++;
+
+	Item& x = *it;
+	m_lst.erase(List::s_iterator_to(x));
+	m_lst.push_front(x);
 
-	if (!(m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader()) && ctx.IsValidTransaction()))
-		return proto::TxStatus::Invalid;
+	return &x;
+}
+
+Node::RecentBodies::Item& Node::RecentBodies::Add(const proto::GetBodyPack& msg, proto::Body&& msgBody)
+{
+	Item* p = new Item;
+	p->m_Key.Set(msg);
+	p->m_Msg = std::move(msgBody);
+
+	m_set.insert(*p);
+	m_lst.push_front(*p);
+
+	uint32_t nMax = std::max(get_ParentObj().m_Cfg.m_BandwidthCtl.m_RecentBodies, 1U);
+	while (m_lst.size() > nMax)
+		Delete(m_lst.back());
+
+	return *p;
+}
+
+void Node::RecentBodies::Delete(Item& x)
+{
+	m_lst.erase(List::s_iterator_to(x));
+	m_set.erase(Set::s_iterator_to(x));
+	delete &x;
+}
+
+void Node::RecentBodies::Clear()
+{
+	while (!m_lst.empty())
+		Delete(m_lst.front());
+}
+
+void Node::TxAdmission::Push(Transaction::Ptr&& ptx, Peer* pPeer, bool bFluff)
+{
+	if (IsKnown(*ptx, bFluff))
+	{
+		// the pool decides without verifying it
+		Node& n = get_ParentObj();
+		m_Stats.m_Known++;
+
+		if (bFluff)
+			n.OnTransactionFluff(std::move(ptx), pPeer, nullptr, nullptr, false);
+		else
+		{
+			proto::Status msgOut;
+			msgOut.m_Value = n.OnTransactionStem(std::move(ptx), pPeer, nullptr, false);
+			if (pPeer)
+				pPeer->Send(msgOut);
+		}
+		return;
+	}
+
+	if (m_Queue.size() >= s_QueueMax)
+	{
+		// overloaded
+		if (!bFluff && pPeer)
+		{
+			proto::Status msgOut;
+			msgOut.m_Value = proto::TxStatus::LimitExceeded;
+			pPeer->Send(msgOut);
+		}
+		return;
+	}
+
+	Pending& x = m_Queue.emplace_back();
+	x.m_pTx = std::move(ptx);
+	x.m_pPeer = pPeer;
+	x.m_Fluff = bFluff;
+	x.m_Group = 0;
+	x.m_Time_ms = GetTime_ms();
+
+	m_Stats.m_Pending++;
+	std::setmax(m_Stats.m_PendingMax, m_Stats.m_Pending);
+
+	TryStart();
+}
+
+bool Node::TxAdmission::IsKnown(const Transaction& tx, bool bFluff)
+{
+	Node& n = get_ParentObj();
+
+	if (bFluff)
+	{
+		TxPool::Fluff::Element::Tx key;
+		tx.get_Key(key.m_Key);
 
-    uint8_t nCode = m_Processor.ValidateTxContextEx(tx, ctx.m_Height, false);
+		return (n.m_TxPool.m_setTxs.end() != n.m_TxPool.m_setTxs.find(key));
+	}
+
+	// the same lookup as in OnTransactionStem: the 1st stem element with a common kernel decides. Unless it's a dup or obscures the new tx - it must be verified
+	for (size_t i = 0; i < tx.m_vKernels.size(); i++)
+	{
+		TxPool::Stem::Element::Kernel key;
+		key.m_pKrn = tx.m_vKernels[i].get();
+
+		TxPool::Stem::KrnSet::iterator it = n.m_Dandelion.m_setKrns.find(key);
+		if (n.m_Dandelion.m_setKrns.end() == it)
+			continue;
+
+		bool bElemCovers = true, bNewCovers = true;
+		it->m_pThis->m_pValue->get_Reader().Compare(std::move(tx.get_Reader()), bElemCovers, bNewCovers);
+
+		return bElemCovers || !bNewCovers;
+	}
+
+	return false;
+}
+
+void Node::TxAdmission::OnPeerDeleted(const Peer& p)
+{
+	for (size_t i = 0; i < m_Queue.size(); i++)
+		if (&p == m_Queue[i].m_pPeer)
+			m_Queue[i].m_pPeer = nullptr;
+
+	if (m_pBatch)
+		for (size_t i = 0; i < m_pBatch->m_vSrc.size(); i++)
+			if (&p == m_pBatch->m_vSrc[i].m_pPeer)
+				m_pBatch->m_vSrc[i].m_pPeer = nullptr;
+}
+
+void Node::TxAdmission::TryStart()
+{
+	if (m_pBatch || m_Queue.empty())
+		return;
+
+	if (!m_pEvent)
+	{
+		io::AsyncEvent::Callback cb = [this]() { OnBatchDone(); };
+		m_pEvent = io::AsyncEvent::create(io::Reactor::get_Current(), std::move(cb));
+	}
+
+	// take the txs from the queue. Parts of a bisected batch go as-is
+	size_t n = m_Queue.front().m_Group;
+	if (!n)
+	{
+		for (n = 1; (n < m_Queue.size()) && (n < s_BatchMax) && !m_Queue[n].m_Group; n++)
+			;
+
+		// unless there are enough txs - wait for more during the admission window
+		uint32_t nWindow_ms = get_ParentObj().m_Cfg.m_TxAdmissionWindow_ms;
+		if ((n < s_BatchMax) && nWindow_ms)
+		{
+			uint32_t dt_ms = GetTime_ms() - m_Queue.front().m_Time_ms;
+			if (dt_ms < nWindow_ms)
+			{
+				if (!m_pTimer)
+					m_pTimer = io::Timer::create(io::Reactor::get_Current());
+
+				m_pTimer->start(nWindow_ms - dt_ms, false, [this]() { TryStart(); });
+				return;
+			}
+		}
+	}
+
+	m_pBatch = std::make_shared<Batch>();
+	m_pBatch->m_Trigger = m_pEvent;
+	m_pBatch->m_vSrc.resize(n);
+	m_pBatch->m_vItems.resize(n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		Pending& x = m_pBatch->m_vSrc[i];
+		x = std::move(m_Queue.front());
+		m_Queue.pop_front();
+
+		m_pBatch->m_vItems[i].m_pTx = x.m_pTx;
+	}
+
+	get_ParentObj().m_Processor.TxBatchStart(m_pBatch);
+}
+
+void Node::TxAdmission::Batch::OnDone()
+{
+	m_Trigger(); // from the verification thread
+}
+
+void Node::TxAdmission::OnBatchDone()
+{
+	if (!m_pBatch)
+		return;
+
+	Batch& b = *m_pBatch;
+	get_ParentObj().m_Processor.TxBatchFinalize(b);
+
+	// if the batch arithmetics failed, and it's not clear which tx is responsible - bisect: re-verify each half of the remaining txs as a separate batch.
+	// If it couldn't be evaluated at all - re-verify them all together
+	bool bRetry = !b.m_bBatchValid && ((b.m_vItems.size() > 1) || b.m_bBatchRetry);
+	size_t nRetry = 0;
+
+	// m_pBatch is kept while processing, peers may be deleted meanwhile
+	for (size_t i = 0; i < b.m_vItems.size(); i++)
+	{
+		Pending& x = b.m_vSrc[i];
+		NodeProcessor::TxBatch::Item& v = b.m_vItems[i];
+
+		if (bRetry && v.m_bValid)
+		{
+			m_Queue.insert(m_Queue.begin() + nRetry++, std::move(x));
+			continue;
+		}
+
+		if (!b.m_bBatchValid)
+			v.m_bValid = false;
+
+		Process(x, v);
+	}
+
+	size_t nHalf = b.m_bBatchRetry ? nRetry : (nRetry + 1) / 2;
+	for (size_t i = 0; i < nRetry; i++)
+		m_Queue[i].m_Group = static_cast<uint32_t>(((i < nHalf) ? nHalf : nRetry) - i);
+
+	m_pBatch.reset();
+	TryStart();
+}
+
+void Node::TxAdmission::Process(Pending& x, NodeProcessor::TxBatch::Item& v)
+{
+	Node& n = get_ParentObj();
+
+	uint8_t nCode = proto::TxStatus::Invalid;
+
+	if (x.m_Fluff)
+	{
+		if (v.m_bValid)
+			n.OnTransactionFluff(std::move(x.m_pTx), x.m_pPeer, nullptr, &v.m_Ctx, v.m_bShieldedBatched);
+		else
+		{
+			Transaction::KeyType key;
+			x.m_pTx->get_Key(key);
+
+			n.m_Wtx.Delete(key);
+			n.LogTx(*x.m_pTx, nCode, key);
+		}
+	}
+	else
+	{
+		if (v.m_bValid)
+			nCode = n.OnTransactionStem(std::move(x.m_pTx), x.m_pPeer, &v.m_Ctx, v.m_bShieldedBatched);
+
+		if (x.m_pPeer)
+		{
+			proto::Status msgOut;
+			msgOut.m_Value = nCode;
+			x.m_pPeer->Send(msgOut);
+		}
+	}
+
+	assert(m_Stats.m_Pending);
+	m_Stats.m_Pending--;
+	m_Stats.m_Processed++;
+
+	uint32_t dt_ms = GetTime_ms() - x.m_Time_ms;
+	m_Stats.m_Latency_ms += dt_ms;
+	std::setmax(m_Stats.m_LatencyMax_ms, dt_ms);
+}
+
+uint8_t Node::ValidateTx(Transaction::Context& ctx, const Transaction& tx, bool bContextFreeVerified, bool bShieldedTested)
+{
+	if (!bContextFreeVerified)
+	{
+		ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
+
+		if (!(m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader()) && ctx.IsValidTransaction()))
+			return proto::TxStatus::Invalid;
+	}
+
+    uint8_t nCode = m_Processor.ValidateTxContextEx(tx, ctx.m_Height, bShieldedTested);
 	if (proto::TxStatus::Ok != nCode)
 		return nCode;
 
@@ -2111,7 +2555,7 @@ uint32_t Node::RandomUInt32(uint32_t threshold)
     return threshold;
 }
 
-uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
+uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer, Transaction::Context* pCtxVerified, bool bShieldedTested)
 {
 	TxStats s;
 	ptx->get_Reader().AddStats(s);
@@ -2125,7 +2569,8 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
     }
 
 	Transaction::Context::Params pars;
-	Transaction::Context ctx(pars);
+	Transaction::Context ctxLocal(pars);
+	Transaction::Context& ctx = pCtxVerified ? *pCtxVerified : ctxLocal;
     bool bTested = false;
     TxPool::Stem::Element* pDup = nullptr;
 
@@ -2168,7 +2613,7 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
 
 		if (!bTested)
 		{
-			uint8_t nCode = ValidateTx(ctx, *ptx);
+			uint8_t nCode = ValidateTx(ctx, *ptx, !!pCtxVerified, bShieldedTested);
 			if (proto::TxStatus::Ok != nCode)
 				return nCode;
 
@@ -2183,7 +2628,7 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
     {
 		if (!bTested)
 		{
-			uint8_t nCode = ValidateTx(ctx, *ptx);
+			uint8_t nCode = ValidateTx(ctx, *ptx, !!pCtxVerified, bShieldedTested);
 			if (proto::TxStatus::Ok != nCode)
 				return nCode;
 		}
@@ -2467,13 +2912,14 @@ Height Node::SampleDummySpentHeight()
 	return h;
 }
 
-bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPool::Stem::Element* pElem)
+bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPool::Stem::Element* pElem, Transaction::Context* pCtxVerified, bool bShieldedTested)
 {
     Transaction::Ptr ptx;
     ptx.swap(ptxArg);
 
 	Transaction::Context::Params pars;
-	Transaction::Context ctx(pars);
+	Transaction::Context ctxLocal(pars);
+	Transaction::Context& ctx = pCtxVerified ? *pCtxVerified : ctxLocal;
     if (pElem)
     {
 		bool bValid = pElem->m_Height.IsInRange(m_Processor.m_Cursor.m_ID.m_Height + 1);
@@ -2511,7 +2957,7 @@ bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPo
     m_Wtx.Delete(key.m_Key);
 
     // new transaction
-    uint8_t nCode = pElem ? proto::TxStatus::Ok : ValidateTx(ctx, tx);
+    uint8_t nCode = pElem ? proto::TxStatus::Ok : ValidateTx(ctx, tx, !!pCtxVerified, bShieldedTested);
     LogTx(tx, nCode, key.m_Key);
 
 	if (proto::TxStatus::Ok != nCode) {
@@ -2618,13 +3064,29 @@ bool Node::Peer::IsChocking(size_t nExtra /* = 0 */)
 	if (Flags::Chocking & m_Flags)
 		return true;
 
-	if (get_Unsent() + nExtra  <= m_This.m_Cfg.m_BandwidthCtl.m_Chocking)
+	if (get_Unsent() + nExtra  <= get_ChockingThreshold())
 		return false;
 
 	OnChocking();
 	return true;
 }
 
+size_t Node::Peer::get_ChockingThreshold() const
+{
+	return m_This.m_Cfg.m_BandwidthCtl.get_ChockingThreshold(get_DrainRate());
+}
+
+size_t Node::Config::BandwidthCtl::get_ChockingThreshold(uint64_t nDrainRate) const
+{
+	if (!nDrainRate)
+		return m_Chocking; // drains quickly
+
+	uint64_t nVal = nDrainRate * m_ChockingDrain_ms / 1000;
+	std::setmax(nVal, (uint64_t) m_ChockingMin);
+
+	return (size_t) std::min(nVal, (uint64_t) m_Chocking);
+}
+
 void Node::Peer::OnChocking()
 {
 	if (!(Flags::Chocking & m_Flags))
@@ -2739,7 +3201,16 @@ void Node::Peer::OnMsg(proto::GetTransaction&& msg)
     if (m_This.m_TxPool.m_setTxs.end() == it)
         return; // don't have it
 
-    SendTx(it->get_ParentObj().m_pValue, true);
+    // typically requested by many peers after the HaveTransaction broadcast
+    TxPool::Fluff::Element& x = it->get_ParentObj();
+
+    proto::NewTransaction msgOut;
+    msgOut.m_Fluff = true;
+
+    TemporarySwap scope(msgOut.m_Transaction, x.m_pValue);
+
+    Send(x.m_Msg.m_Value, msgOut);
+    m_This.m_TxPool.OnMsgUsed(x);
 }
 
 void Node::Peer::SendTx(Transaction::Ptr& ptx, bool bFluff)
@@ -3045,34 +3516,7 @@ bool Node::Processor::BuildCwp()
     if (m_Cursor.m_Full.m_Height < Rules::HeightGenesis)
         return false;
 
-    struct Source
-        :public Block::ChainWorkProof::ISource
-    {
-        Processor& m_Proc;
-
-        Source(Processor& proc)
-            :m_Proc(proc)
-        {}
-
-        virtual void get_StateAt(Block::SystemState::Full& s, const Difficulty::Raw& d) override
-        {
-            uint64_t rowid = m_Proc.get_DB().FindStateWorkGreater(d);
-            m_Proc.get_DB().get_State(rowid, s);
-        }
-
-        virtual void get_Proof(Merkle::IProofBuilder& bld, Height h) override
-        {
-            m_Proc.m_Mmr.m_States.get_Proof(bld, m_Proc.m_Mmr.m_States.H2I(h));
-        }
-    };
-
-    Source src(*this);
-
-    m_Cwp.Create(src, m_Cursor.m_Full);
-
-    Evaluator ev(*this);
-    ev.get_Live(m_Cwp.m_hvRootLive);
-
+    GenerateCwp(m_Cwp);
     return true;
 }
 
@@ -3164,6 +3608,8 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
     proto::BbsHaveMsg msgOut;
     msgOut.m_Key = wlk.m_Data.m_Key;
 
+    proto::SharedMsg smHave, smMsg; // serialized once for all the peers
+
     for (PeerList::iterator it = m_This.m_lstPeers.begin(); m_This.m_lstPeers.end() != it; it++)
     {
         Peer& peer = *it;
@@ -3173,7 +3619,7 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
         if (!(peer.m_LoginFlags & proto::LoginFlags::Bbs) || peer.IsChocking())
             continue;
 
-        peer.Send(msgOut);
+        peer.Send(smHave, msgOut);
     }
 
     // 2. Send to subscribed
@@ -3190,7 +3636,7 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
         if (s.m_pPeer->IsChocking())
             continue;
 
-        s.m_pPeer->SendBbsMsg(wlk.m_Data);
+        s.m_pPeer->Send(smMsg, msg); // same as SendBbsMsg(wlk.m_Data)
 		s.m_Cursor = id;
 
 		s.m_pPeer->IsChocking(); // in case it's chocking - for faster recovery recheck it ASAP
@@ -4162,6 +4608,20 @@ void Node::PeerMan::PeerInfoPlus::DetachStrict()
 	m_Live.m_p = nullptr;
 }
 
+bool Node::ExportSnapshot(const char* szPath)
+{
+	try
+	{
+		return m_Processor.ExportSnapshot(szPath);
+	}
+	catch (const std::exception& ex)
+	{
+		LOG_ERROR() << "Snapshot export failed: " << ex.what();
+	}
+
+	return false;
+}
+
 bool Node::GenerateRecoveryInfo(const char* szPath)
 {
 	if (!m_Processor.BuildCwp())
@@ -38,6 +38,7 @@ struct Node
 		virtual void OnStateChanged() {}
 		virtual void OnRolledBack(const Block::SystemState::ID& id) {};
 		virtual void InitializeUtxosProgress(uint64_t done, uint64_t total) {};
+		virtual void OnVacuumProgress(uint64_t done, uint64_t total) {}; // DB pages, online compaction
 
         enum Error
         {
@@ -71,8 +72,16 @@ struct Node
 
 		uint32_t m_MaxConcurrentBlocksRequest = 18;
 		uint32_t m_MaxPoolTransactions = 100 * 1000;
+		// Incoming txs are collected for up to this time (or until a full batch is formed) before their verification starts.
+		// 0: don't wait
+		uint32_t m_TxAdmissionWindow_ms = 50;
 		uint32_t m_MiningThreads = 0; // by default disabled
 
+		// Threads dedicated to the peers' network I/O: framing, encryption and deserialization. Peers are spread among them,
+		// the processing of the messages remains on the node thread.
+		// 0: everything on the node thread
+		uint32_t m_IoThreads = 0;
+
 		bool m_LogEvents = false; // may be insecure. Off by default.
 		bool m_LogTxStem = true;
 		bool m_LogTxFluff = true;
@@ -108,9 +117,18 @@ struct Node
 			size_t m_Chocking = 1024 * 1024;
 			size_t m_Drown    = 1024*1024 * 20;
 
+			// For the peers that drain slowly the chocking threshold is lowered to what they'd receive within this time,
+			// so that the broadcasts don't pile up in their queues
+			uint32_t m_ChockingDrain_ms = 3000;
+			size_t m_ChockingMin = 1024 * 64;
+
+			size_t get_ChockingThreshold(uint64_t nDrainRate) const; // nDrainRate in bytes/sec, 0 if unknown
+
 			size_t m_MaxBodyPackSize = 1024 * 1024 * 5;
 			uint32_t m_MaxBodyPackCount = 3000;
 
+			uint32_t m_RecentBodies = 8; // max num of recently served bodies kept for subsequent requests. 0 to disable
+
 		} m_BandwidthCtl;
 
 		struct TestMode {
@@ -144,6 +162,16 @@ struct Node
 
 		} m_Recovery;
 
+		struct Vacuum
+		{
+			// Online DB compaction, runs in small steps when the node is idle (no pending blocks or DB flush).
+			uint32_t m_PagesPerStep = 256; // 1MB for the default 4KB pages. Set to 0 to disable
+			uint32_t m_Period_ms = 1000;
+			uint32_t m_StepsPerCommit = 16; // the steps are committed in bulks (or with the regular commits), to save on fsyncs
+			uint64_t m_FreePagesMin = 1024; // don't start below this
+
+		} m_Vacuum;
+
 		NodeProcessor::StartParams m_ProcessorParams;
 
 		IObserver* m_Observer = nullptr;
@@ -181,6 +209,8 @@ struct Node
 		Height m_Done;
 		Height m_Total;
 
+		uint32_t m_HdrsPerSec; // headers verified and accepted, measured over the recent packs. Not a part of the progress
+
 		bool operator == (const SyncStatus&) const;
 
 		void ToRelative(Height hDone0);
@@ -190,16 +220,52 @@ struct Node
 	uint32_t get_AcessiblePeerCount() const; // all the peers with known addresses. Including temporarily banned
     const PeerManager::AddrSet& get_AcessiblePeerAddrs() const;
 
+	struct TxAdmissionStats
+	{
+		uint32_t m_Pending = 0; // received txs, not processed yet (queued or being verified)
+		uint32_t m_PendingMax = 0;
+		uint64_t m_Processed = 0;
+		uint64_t m_Known = 0; // resolved by the pool lookups (duplicates, obscured), not queued for verification
+		uint64_t m_Latency_ms = 0; // total, from reception till the pool decision
+		uint32_t m_LatencyMax_ms = 0;
+	};
+
+	const TxAdmissionStats& get_TxAdmissionStats() const;
+
+	struct RecentBodiesStats
+	{
+		uint64_t m_Hits = 0;
+		uint64_t m_Misses = 0;
+	};
+
+	const RecentBodiesStats& get_RecentBodiesStats() const;
+
 	bool m_UpdatedFromPeers = false;
 	bool m_PostStartSynced = false;
 
 	bool GenerateRecoveryInfo(const char*);
+	bool ExportSnapshot(const char*); // see NodeProcessor::ExportSnapshot
 	void PrintTxos();
 
 	bool DecodeAndCheckHdrs(std::vector<Block::SystemState::Full>&, const proto::HdrPack&);
 
 private:
 
+	struct HdrRate
+	{
+		static const uint32_t s_Window_ms = 1000;
+		static const uint32_t s_Idle_ms = 10000; // after such a pause the measurement restarts
+
+		uint64_t m_Start_ms = 0;
+		uint64_t m_Last_ms = 0;
+		uint64_t m_Count = 0;
+
+		void OnStart(SyncStatus&, uint64_t now_ms);
+		void OnDone(SyncStatus&, uint64_t now_ms, uint32_t nCount);
+		void OnStop(SyncStatus&);
+
+	} m_HdrRate;
+
 	struct Processor
 		:public NodeProcessor
 	{
@@ -246,6 +312,12 @@ private:
 		void TryGoUpAsync();
 		void OnGoUpTimer();
 
+		uint64_t m_VacuumTotal = 0; // free pages at the beginning of the current compaction round
+		uint32_t m_VacuumSteps = 0; // not committed yet
+		io::Timer::Ptr m_pVacuumTimer;
+		void StartVacuum();
+		void OnVacuumTimer();
+
 		std::deque<PeerID> m_lstInsanePeers;
 		io::AsyncEvent::Ptr m_pAsyncPeerInsane;
 		void FlushInsanePeers();
@@ -349,7 +421,94 @@ private:
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Dandelion)
 	} m_Dandelion;
 
-	uint8_t OnTransactionStem(Transaction::Ptr&&, const Peer*);
+	// Txs received from peers are verified (context-free) in batches by the executor. Then their processing continues on the reactor thread.
+	struct TxAdmission
+	{
+		struct Pending
+		{
+			Transaction::Ptr m_pTx;
+			Peer* m_pPeer; // reset if the peer is deleted meanwhile
+			bool m_Fluff;
+			uint32_t m_Group; // if nonzero - the number of txs (starting from this one) that must be verified together, a part of a bisected batch
+			uint32_t m_Time_ms;
+		};
+
+		struct Batch
+			:public NodeProcessor::TxBatch
+		{
+			std::vector<Pending> m_vSrc;
+			io::AsyncEvent::Trigger m_Trigger;
+
+			virtual void OnDone() override;
+		};
+
+		static const uint32_t s_BatchMax = 64;
+		static const uint32_t s_QueueMax = 5000;
+
+		std::deque<Pending> m_Queue;
+		std::shared_ptr<Batch> m_pBatch; // in progress
+		io::AsyncEvent::Ptr m_pEvent;
+		io::Timer::Ptr m_pTimer; // admission window
+
+		TxAdmissionStats m_Stats;
+
+		void Push(Transaction::Ptr&&, Peer*, bool bFluff);
+		bool IsKnown(const Transaction&, bool bFluff);
+		void OnPeerDeleted(const Peer&);
+		void TryStart();
+		void OnBatchDone();
+		void Process(Pending&, NodeProcessor::TxBatch::Item&);
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_TxAdmission)
+	} m_TxAdmission;
+
+	struct RecentBodies
+	{
+		// Recently served block bodies, kept along with their serialized form.
+		// Once a new block arrives - most of the peers request the same body at once.
+		struct Key
+		{
+			Block::SystemState::ID m_ID;
+			Height m_Height0;
+			Height m_HorizonLo1;
+			Height m_HorizonHi1;
+			uint8_t m_FlagP;
+			uint8_t m_FlagE;
+
+			void Set(const proto::GetBodyPack&);
+			bool operator < (const Key&) const;
+			bool IsFullBlock() const; // only full blocks are cached, the reduced ones depend on the current state
+		};
+
+		struct Item
+			:public boost::intrusive::set_base_hook<>
+			,public boost::intrusive::list_base_hook<>
+		{
+			Key m_Key;
+			proto::Body m_Msg;
+			proto::SharedMsg m_Serialized;
+
+			bool operator < (const Item& n) const { return (m_Key < n.m_Key); }
+		};
+
+		typedef boost::intrusive::list<Item> List; // most recent first
+		typedef boost::intrusive::multiset<Item> Set;
+
+		List m_lst;
+		Set m_set;
+		RecentBodiesStats m_Stats;
+
+		Item* Find(const proto::GetBodyPack&);
+		Item& Add(const proto::GetBodyPack&, proto::Body&&);
+		void Delete(Item&);
+		void Clear();
+
+		~RecentBodies() { Clear(); }
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_RecentBodies)
+	} m_RecentBodies;
+
+	uint8_t OnTransactionStem(Transaction::Ptr&&, const Peer*, Transaction::Context* pCtxVerified = nullptr, bool bShieldedTested = false);
 	void OnTransactionAggregated(Dandelion::Element&);
 	void PerformAggregation(Dandelion::Element&);
 	void AddDummyInputs(Transaction&);
@@ -357,9 +516,9 @@ private:
 	bool AddDummyInputEx(Transaction& tx, const CoinID&);
 	void AddDummyOutputs(Transaction&);
 	Height SampleDummySpentHeight();
-	bool OnTransactionFluff(Transaction::Ptr&&, const Peer*, Dandelion::Element*);
+	bool OnTransactionFluff(Transaction::Ptr&&, const Peer*, Dandelion::Element*, Transaction::Context* pCtxVerified = nullptr, bool bShieldedTested = false);
 
-	uint8_t ValidateTx(Transaction::Context&, const Transaction&); // complete validation
+	uint8_t ValidateTx(Transaction::Context&, const Transaction&, bool bContextFreeVerified, bool bShieldedTested = false); // complete validation
 	void LogTx(const Transaction&, uint8_t nStatus, const Transaction::KeyType&);
 	void LogTxStem(const Transaction&, const char* szTxt);
 
@@ -506,6 +665,7 @@ private:
 		bool GetBlock(proto::BodyBuffers&, const NodeDB::StateID&, const proto::GetBodyPack&, bool bActive);
 
 		bool IsChocking(size_t nExtra = 0);
+		size_t get_ChockingThreshold() const;
 		bool ShouldAssignTasks();
 		bool ShouldFinalizeMining();
 		Task& get_FirstTask();
@@ -587,6 +747,8 @@ private:
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Server)
 	} m_Server;
 
+	proto::IoPool m_IoPool;
+
 	struct Beacon
 	{
 		struct OutCtx;
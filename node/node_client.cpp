@@ -55,10 +55,27 @@ namespace
 
             boost::filesystem::remove(nodePath);
 
+            // the images and the block body segments accompany the DB, they're useless without it
+            std::vector<std::string> imagePaths;
+            beam::NodeProcessor::get_ImagePaths(imagePaths, nodePathStr.c_str());
+            for (const auto& path : imagePaths)
+            {
+                boost::filesystem::remove(pathFromStdString(path));
+            }
+
+            std::string blockStorePrefix;
+            beam::NodeProcessor::get_BlockStorePath(blockStorePrefix, nodePathStr.c_str());
+            auto blockStoreName = pathFromStdString(blockStorePrefix).filename().wstring();
+
             std::vector<boost::filesystem::path> macroBlockFiles;
             for (boost::filesystem::directory_iterator endDirIt, it{ appDataPath }; it != endDirIt; ++it)
             {
-                if (it->path().filename().wstring().find(L"tempmb") == 0)
+                auto fileName = it->path().filename().wstring();
+                if (fileName.find(L"tempmb") == 0)
+                {
+                    macroBlockFiles.push_back(it->path());
+                }
+                else if ((fileName.find(blockStoreName) == 0) && (it->path().extension().wstring() == L".dat"))
                 {
                     macroBlockFiles.push_back(it->path());
                 }
@@ -21,6 +21,7 @@
 #include "../utility/logger_checkpoints.h"
 #include <condition_variable>
 #include <cctype>
+#include <deque>
 
 namespace beam {
 
@@ -86,9 +87,25 @@ void NodeProcessor::Initialize(const char* szPath)
 
 void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 {
+	Block::SystemState::Full sTipSnapshot;
+	bool bSnapshot = !sp.m_sSnapshot.empty() && ImportSnapshot(szPath, sp.m_sSnapshot.c_str(), sTipSnapshot);
+
+	m_sPath = szPath;
 	m_DB.Open(szPath);
 	m_DbTx.Start(m_DB);
 
+	std::string sPath;
+	get_BlockStorePath(sPath, szPath);
+
+	if (bSnapshot)
+	{
+		std::string sPathSrc;
+		get_BlockStorePath(sPathSrc, sp.m_sSnapshot.c_str());
+		m_DB.CopyBlockStore(sPathSrc.c_str(), sPath.c_str());
+	}
+
+	m_DB.OpenBlockStore(sPath.c_str());
+
 	if (sp.m_CheckIntegrity)
 	{
 		LOG_INFO() << "DB integrity check...";
@@ -163,7 +180,15 @@ void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 	m_Mmr.m_States.m_Count = m_Cursor.m_Sid.m_Height - Rules::HeightGenesis;
 	InitCursor(false);
 
-	InitializeUtxos(szPath);
+	uint32_t nUtxoFlags = 0;
+	if (sp.m_UtxoHugePages)
+		nUtxoFlags |= MappedFile::Flags::HugePages;
+	if (sp.m_UtxoPrefault)
+		nUtxoFlags |= MappedFile::Flags::Prefault;
+
+	InitializeUtxos(szPath, nUtxoFlags, sp.m_Vacuum);
+	InitKernelFilter(szPath);
+	InitStreamImages(szPath);
 
 	m_Extra.m_Txos = get_TxosBefore(m_Cursor.m_ID.m_Height + 1);
 
@@ -177,20 +202,37 @@ void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 	if (sp.m_Vacuum)
 		Vacuum();
 
+	if (!m_DB.IsVacuumIncremental())
+	{
+		LOG_INFO() << "Online DB compaction is not available for this DB. It can be enabled by the vacuum (once)";
+	}
+
+	if (bSnapshot)
+		VerifySnapshot(sTipSnapshot);
+
 	TryGoUp();
 }
 
-void NodeProcessor::InitializeUtxos(const char* sz)
+void NodeProcessor::InitializeUtxos(const char* sz, uint32_t nFlags, bool bCompact)
 {
-	if (InitUtxoMapping(sz, false))
+	if (InitUtxoMapping(sz, false, nFlags))
 	{
 		LOG_INFO() << "UTXO image found";
 		if (TestDefinition())
+		{
+			if (bCompact || m_Utxos.IsFragmented())
+			{
+				LOG_INFO() << "UTXO image compacting...";
+				m_Utxos.Compact();
+				LOG_INFO() << "UTXO image compacting completed";
+			}
+
 			return; // ok
+		}
 
 		LOG_WARNING() << "Definition mismatch, discarding UTXO image";
 		m_Utxos.Close();
-		InitUtxoMapping(sz, true);
+		InitUtxoMapping(sz, true, nFlags);
 	}
 
 	LOG_INFO() << "Rebuilding UTXO image...";
@@ -234,9 +276,9 @@ int My_strcmpi(const char* sz1, const char* sz2)
 	return 0;
 }
 
-void NodeProcessor::get_UtxoMappingPath(std::string& sPath, const char* sz)
+void NodeProcessor::get_DerivedPath(std::string& sPath, const char* sz, const char* szSufixNew)
 {
-	// derive UTXO path from db path
+	// derive path from db path
 	sPath = sz;
 
 	static const char szSufix[] = ".db";
@@ -245,16 +287,54 @@ void NodeProcessor::get_UtxoMappingPath(std::string& sPath, const char* sz)
 	if ((sPath.size() >= nSufix) && !My_strcmpi(sPath.c_str() + sPath.size() - nSufix, szSufix))
 		sPath.resize(sPath.size() - nSufix);
 
-	sPath += "-utxo-image.bin";
+	sPath += szSufixNew;
+}
+
+void NodeProcessor::get_UtxoMappingPath(std::string& sPath, const char* sz)
+{
+	get_DerivedPath(sPath, sz, "-utxo-image.bin");
+}
+
+void NodeProcessor::get_KernelFilterPath(std::string& sPath, const char* sz)
+{
+	get_DerivedPath(sPath, sz, "-kernel-filter.bin");
+}
+
+void NodeProcessor::get_BlockStorePath(std::string& sPath, const char* sz)
+{
+	get_DerivedPath(sPath, sz, "-blocks-");
 }
 
-bool NodeProcessor::InitUtxoMapping(const char* sz, bool bForceReset)
+void NodeProcessor::get_SnapshotManifestPath(std::string& sPath, const char* sz)
+{
+	get_DerivedPath(sPath, sz, "-snapshot.bin");
+}
+
+void NodeProcessor::get_ImagePaths(std::vector<std::string>& v, const char* sz)
+{
+	v.resize(2 + NodeDB::StreamType::count);
+
+	get_UtxoMappingPath(v[0], sz);
+	get_KernelFilterPath(v[1], sz);
+
+	for (uint32_t i = 0; i < NodeDB::StreamType::count; i++)
+		get_StreamImagePath(v[2 + i], sz, static_cast<NodeDB::StreamType::Enum>(i));
+}
+
+bool NodeProcessor::InitUtxoMapping(const char* sz, bool bForceReset, uint32_t nFlags)
 {
 	// derive UTXO path from db path
 	std::string sPath;
 	get_UtxoMappingPath(sPath, sz);
 
 	UtxoTreeMapped::Stamp us;
+	get_ImageStamp(us, bForceReset);
+
+	return m_Utxos.Open(sPath.c_str(), us, nFlags);
+}
+
+void NodeProcessor::get_ImageStamp(Merkle::Hash& us, bool bForceReset)
+{
 	Blob blob(us);
 
 	// don't use the saved image if no height: we may contain treasury UTXOs, but no way to verify the contents
@@ -263,8 +343,360 @@ bool NodeProcessor::InitUtxoMapping(const char* sz, bool bForceReset)
 		us = 1U;
 		us.Negate();
 	}
+}
+
+void NodeProcessor::InitKernelFilter(const char* sz)
+{
+	std::string sPath;
+	get_KernelFilterPath(sPath, sz);
+
+	Merkle::Hash us;
+	get_ImageStamp(us, false);
+
+	if (!m_KernelFilter.Open(sPath.c_str(), us) || m_KernelFilter.IsOverloaded())
+		RebuildKernelFilter();
+}
+
+void NodeProcessor::RebuildKernelFilter()
+{
+	LOG_INFO() << "Rebuilding kernel filter...";
+
+	m_KernelFilter.Reset(m_DB.get_KernelsCount() * 2); // leave room for growth
+
+	NodeDB::WalkerKernel wlk;
+	for (m_DB.EnumKernels(wlk); wlk.MoveNext(); )
+	{
+		if (wlk.m_ID.n != Merkle::Hash::nBytes)
+			OnCorrupted();
+
+		m_KernelFilter.Add(*reinterpret_cast<const Merkle::Hash*>(wlk.m_ID.p));
+	}
+}
+
+void NodeProcessor::get_StreamImagePath(std::string& sPath, const char* sz, NodeDB::StreamType::Enum eType)
+{
+	const char* szSufix = nullptr;
+	switch (eType)
+	{
+	case NodeDB::StreamType::StatesMmr: szSufix = "-states-mmr.bin"; break;
+	case NodeDB::StreamType::Shielded: szSufix = "-shielded.bin"; break;
+	case NodeDB::StreamType::ShieldedMmr: szSufix = "-shielded-mmr.bin"; break;
+	case NodeDB::StreamType::AssetsMmr: szSufix = "-assets-mmr.bin"; break;
+	default:
+		assert(false);
+	}
+
+	get_DerivedPath(sPath, sz, szSufix);
+}
+
+void NodeProcessor::InitStreamImages(const char* sz)
+{
+	Merkle::Hash us;
+	get_ImageStamp(us, false);
+
+	for (uint32_t i = 0; i < NodeDB::StreamType::count; i++)
+	{
+		NodeDB::StreamType::Enum eType = static_cast<NodeDB::StreamType::Enum>(i);
+
+		std::string sPath;
+		get_StreamImagePath(sPath, sz, eType);
+
+		StreamImage& x = m_pStreamImage[i];
+		bool bValid = x.Open(sPath.c_str(), us);
+		if (!bValid)
+		{
+			LOG_INFO() << "Rebuilding stream image " << i << "...";
+			x.Reset();
+		}
+
+		m_DB.StreamImageAttach(eType, &x, !bValid);
+	}
+}
+
+/////////////////////////////
+// StreamImage
+void NodeProcessor::StreamImage::get_Defs(MappedFile::Defs& d)
+{
+	// change this when format changes
+	static const uint8_t s_pSig[] = {
+		0x3E, 0x81, 0x5D, 0xA9,
+		0x64, 0xF0, 0x17, 0xC2,
+		0x9B, 0x2A, 0xD6, 0x40,
+		0x85, 0x7C, 0xE3, 0x1F
+	};
+
+	d.m_pSig = s_pSig;
+	d.m_nSizeSig = sizeof(s_pSig);
+	d.m_nBanks = 0;
+	d.m_nFixedHdr = sizeof(Hdr);
+}
+
+bool NodeProcessor::StreamImage::Open(const char* sz, const Merkle::Hash& stamp)
+{
+	m_sPath = sz;
+
+	MappedFile::Defs d;
+	get_Defs(d);
+
+	try
+	{
+		m_Mapping.Open(sz, d);
+	}
+	catch (const std::exception& e)
+	{
+		// promote it
+		CorruptionException exc;
+		exc.m_sErr = e.what();
+		throw exc;
+	}
+
+	const Hdr& h = get_Hdr();
+	if (h.m_Dirty || !(h.m_Stamp == stamp))
+		return false;
+
+	return (m_Mapping.get_Size() >= d.get_SizeMin() + h.m_Size);
+}
+
+void NodeProcessor::StreamImage::Reset()
+{
+	MappedFile::Defs d;
+	get_Defs(d);
+
+	try
+	{
+		m_Mapping.Open(m_sPath.c_str(), d, true);
+	}
+	catch (const std::exception& e)
+	{
+		// promote it
+		CorruptionException exc;
+		exc.m_sErr = e.what();
+		throw exc;
+	}
+
+	get_Hdr().m_Dirty = 1;
+}
+
+NodeProcessor::StreamImage::Hdr& NodeProcessor::StreamImage::get_Hdr() const
+{
+	return *static_cast<Hdr*>(m_Mapping.get_FixedHdr());
+}
+
+uint8_t* NodeProcessor::StreamImage::get_Data(uint64_t pos, uint64_t nCount) const
+{
+	const Hdr& h = get_Hdr();
+	if ((pos > h.m_Size) || (h.m_Size - pos < nCount))
+		OnCorrupted();
+
+	return reinterpret_cast<uint8_t*>(Cast::NotConst(&h + 1)) + pos;
+}
+
+void NodeProcessor::StreamImage::FlushStrict(const Merkle::Hash& stamp)
+{
+	Hdr& h = get_Hdr();
+	assert(h.m_Dirty);
+
+	h.m_Dirty = 0;
+	h.m_Stamp = stamp;
+}
+
+void NodeProcessor::StreamImage::Resize(uint64_t n)
+{
+	MappedFile::Defs d;
+	get_Defs(d);
+
+	get_Hdr().m_Dirty = 1;
+
+	try
+	{
+		m_Mapping.SetSize(d.get_SizeMin() + n);
+	}
+	catch (const std::exception& e)
+	{
+		// promote it
+		CorruptionException exc;
+		exc.m_sErr = e.what();
+		throw exc;
+	}
+
+	get_Hdr().m_Size = n;
+}
+
+void NodeProcessor::StreamImage::Read(uint64_t pos, uint8_t* p, uint64_t nCount)
+{
+	memcpy(p, get_Data(pos, nCount), nCount);
+}
+
+void NodeProcessor::StreamImage::Write(uint64_t pos, const uint8_t* p, uint64_t nCount)
+{
+	get_Hdr().m_Dirty = 1;
+	memcpy(get_Data(pos, nCount), p, nCount);
+}
+
+/////////////////////////////
+// KernelFilter
+void NodeProcessor::KernelFilter::get_Defs(MappedFile::Defs& d, uint64_t nBlocks)
+{
+	// change this when format changes
+	static const uint8_t s_pSig[] = {
+		0x7A, 0x31, 0xC2, 0x5E,
+		0x0B, 0x94, 0xE8, 0x13,
+		0x56, 0xAF, 0x28, 0xD1,
+		0x6C, 0x03, 0x9B, 0x47
+	};
+
+	d.m_pSig = s_pSig;
+	d.m_nSizeSig = sizeof(s_pSig);
+	d.m_nBanks = 0;
+	d.m_nFixedHdr = static_cast<uint32_t>(sizeof(Hdr) + sizeof(Block) * (nBlocks + 1)); // extra block for the alignment
+}
+
+bool NodeProcessor::KernelFilter::Open(const char* sz, const Merkle::Hash& stamp)
+{
+	m_sPath = sz;
+
+	MappedFile::Defs d;
+	get_Defs(d, 0); // actual size is verified after the header is read
+
+	try
+	{
+		m_Mapping.Open(sz, d);
+	}
+	catch (const std::exception& e)
+	{
+		// promote it
+		CorruptionException exc;
+		exc.m_sErr = e.what();
+		throw exc;
+	}
 
-	return m_Utxos.Open(sPath.c_str(), us);
+	const Hdr& h = get_Hdr();
+	if (h.m_Dirty || !(h.m_Stamp == stamp) || !h.m_Blocks || (h.m_Blocks & (h.m_Blocks - 1)))
+		return false;
+
+	get_Defs(d, h.m_Blocks);
+	return (m_Mapping.get_Size() >= d.get_SizeMin());
+}
+
+void NodeProcessor::KernelFilter::Reset(uint64_t nCapacity)
+{
+	std::setmax(nCapacity, s_CapacityMin);
+
+	uint64_t nBlocks = 1;
+	while ((nBlocks << 9) < nCapacity * s_BitsPerElement)
+		nBlocks <<= 1;
+
+	MappedFile::Defs d;
+	get_Defs(d, nBlocks);
+
+	try
+	{
+		m_Mapping.Open(m_sPath.c_str(), d, true);
+	}
+	catch (const std::exception& e)
+	{
+		// promote it
+		CorruptionException exc;
+		exc.m_sErr = e.what();
+		throw exc;
+	}
+
+	Hdr& h = get_Hdr();
+	h.m_Blocks = nBlocks;
+	h.m_Dirty = 1;
+}
+
+void NodeProcessor::KernelFilter::Close()
+{
+	m_Mapping.Close();
+}
+
+NodeProcessor::KernelFilter::Hdr& NodeProcessor::KernelFilter::get_Hdr() const
+{
+	return *static_cast<Hdr*>(m_Mapping.get_FixedHdr());
+}
+
+NodeProcessor::KernelFilter::Block& NodeProcessor::KernelFilter::get_Block(const Merkle::Hash& id) const
+{
+	const Hdr& h = get_Hdr();
+
+	uint64_t iBlock = 0;
+	for (uint32_t i = 0; i < sizeof(iBlock); i++)
+		iBlock = (iBlock << 8) | id.m_pData[i];
+
+	// blocks are aligned to the cache line, the mapping base is page-aligned
+	uintptr_t nPtr = reinterpret_cast<uintptr_t>(&h + 1);
+	nPtr = (nPtr + sizeof(Block) - 1) & ~uintptr_t(sizeof(Block) - 1);
+
+	return reinterpret_cast<Block*>(nPtr)[iBlock & (h.m_Blocks - 1)];
+}
+
+bool NodeProcessor::KernelFilter::IsOverloaded() const
+{
+	const Hdr& h = get_Hdr();
+	return h.m_Count * s_BitsPerElement > (h.m_Blocks << 9);
+}
+
+void NodeProcessor::KernelFilter::FlushStrict(const Merkle::Hash& stamp)
+{
+	Hdr& h = get_Hdr();
+	assert(h.m_Dirty);
+
+	h.m_Dirty = 0;
+	h.m_Stamp = stamp;
+}
+
+void NodeProcessor::KernelFilter::Add(const Merkle::Hash& id)
+{
+	Block& b = get_Block(id);
+
+	// the ID is a hash, its bytes are used as-is. Each probe takes 9 bits
+	for (uint32_t i = 0; i < s_Probes; i++)
+	{
+		uint32_t nBit = ((id.m_pData[8 + i * 2] << 8) | id.m_pData[9 + i * 2]) & 0x1ff;
+		b.m_p[nBit >> 6] |= uint64_t(1) << (nBit & 0x3f);
+	}
+
+	Hdr& h = get_Hdr();
+	h.m_Count++;
+	h.m_Dirty = 1;
+}
+
+bool NodeProcessor::KernelFilter::MayContain(const Merkle::Hash& id) const
+{
+	const Block& b = get_Block(id);
+
+	for (uint32_t i = 0; i < s_Probes; i++)
+	{
+		uint32_t nBit = ((id.m_pData[8 + i * 2] << 8) | id.m_pData[9 + i * 2]) & 0x1ff;
+		if (!(b.m_p[nBit >> 6] & (uint64_t(1) << (nBit & 0x3f))))
+			return false;
+	}
+
+	return true;
+}
+
+Height NodeProcessor::FindKernel(const Merkle::Hash& id)
+{
+	if (m_KernelFilter.IsOpen())
+	{
+		KernelFilter::Stats& s = m_KernelFilter.m_Stats;
+		if (!m_KernelFilter.MayContain(id))
+		{
+			s.m_Absent++;
+			return Rules::HeightGenesis - 1;
+		}
+
+		s.m_Present++;
+
+		Height h = m_DB.FindKernel(id);
+		if (h < Rules::HeightGenesis)
+			s.m_FalsePositive++;
+
+		return h;
+	}
+
+	return m_DB.FindKernel(id);
 }
 
 void NodeProcessor::LogSyncData()
@@ -314,10 +746,15 @@ void NodeProcessor::CommitUtxosAndDB()
 {
 	UtxoTreeMapped::Stamp us;
 
-	bool bFlushUtxos = (m_Utxos.IsOpen() && m_Utxos.get_Hdr().m_Dirty);
+	if (m_KernelFilter.IsOpen() && m_KernelFilter.IsOverloaded())
+		RebuildKernelFilter(); // includes the uncommitted kernels too
 
-	if (bFlushUtxos)
+	bool bFlush = IsImageDirty();
+	if (bFlush)
 	{
+		// all the images share the stamp, hence all must be invalidated until the DB is committed
+		SetImagesDirty();
+
 		Blob blob(us);
 
 		if (m_DB.ParamGet(NodeDB::ParamID::UtxoStamp, nullptr, &blob)) {
@@ -331,8 +768,49 @@ void NodeProcessor::CommitUtxosAndDB()
 
 	m_DbTx.Commit();
 
-	if (bFlushUtxos)
+	if (bFlush)
+		FlushImages(us);
+}
+
+bool NodeProcessor::IsImageDirty() const
+{
+	if (m_Utxos.IsOpen() && Cast::NotConst(m_Utxos).get_Hdr().m_Dirty)
+		return true;
+
+	if (m_KernelFilter.IsDirty())
+		return true;
+
+	for (size_t i = 0; i < _countof(m_pStreamImage); i++)
+		if (m_pStreamImage[i].IsDirty())
+			return true;
+
+	return false;
+}
+
+void NodeProcessor::SetImagesDirty()
+{
+	if (m_Utxos.IsOpen())
+		m_Utxos.OnDirty();
+
+	if (m_KernelFilter.IsOpen())
+		m_KernelFilter.OnDirty();
+
+	for (size_t i = 0; i < _countof(m_pStreamImage); i++)
+		if (m_pStreamImage[i].IsOpen())
+			m_pStreamImage[i].OnDirty();
+}
+
+void NodeProcessor::FlushImages(const Merkle::Hash& us)
+{
+	if (m_Utxos.IsOpen())
 		m_Utxos.FlushStrict(us);
+
+	if (m_KernelFilter.IsOpen())
+		m_KernelFilter.FlushStrict(us);
+
+	for (size_t i = 0; i < _countof(m_pStreamImage); i++)
+		if (m_pStreamImage[i].IsOpen())
+			m_pStreamImage[i].FlushStrict(us);
 }
 
 void NodeProcessor::Vacuum()
@@ -347,13 +825,409 @@ void NodeProcessor::Vacuum()
 	m_DbTx.Start(m_DB);
 }
 
+uint64_t NodeProcessor::VacuumStep(uint32_t nPages)
+{
+	m_DB.VacuumIncremental(nPages); // within the current DB transaction, the space returns to the FS once it's committed
+	return m_DB.get_FreePages();
+}
+
 void NodeProcessor::CommitDB()
 {
 	if (m_DbTx.IsInProgress())
 	{
 		CommitUtxosAndDB();
 		m_DbTx.Start(m_DB);
+
+		m_DB.CleanupBlockStore();
+	}
+}
+
+namespace
+{
+	bool CopyFileStrict(const char* szSrc, const char* szDst, bool bMustExist)
+	{
+		std::FStream fSrc;
+		if (!fSrc.Open(szSrc, true, bMustExist))
+			return false;
+
+		std::FStream fDst;
+		fDst.Open(szDst, false, true);
+
+		std::vector<uint8_t> vBuf(1U << 20);
+		while (fSrc.get_Remaining())
+		{
+			size_t n = static_cast<size_t>(std::min<uint64_t>(vBuf.size(), fSrc.get_Remaining()));
+			fSrc.read(&vBuf.front(), n);
+			fDst.write(&vBuf.front(), n);
+		}
+
+		fDst.Flush();
+		return true;
+	}
+
+	typedef yas::binary_oarchive<std::FStream, SERIALIZE_OPTIONS> SnapshotSerializer;
+	typedef yas::binary_iarchive<std::FStream, SERIALIZE_OPTIONS> SnapshotDeserializer;
+
+	void ThrowSnapshotError(const char* sz)
+	{
+		std::ostringstream os;
+		os << "Snapshot: " << sz;
+		throw std::runtime_error(os.str());
+	}
+}
+
+bool NodeProcessor::ExportSnapshot(const char* szPath)
+{
+	if ((m_Cursor.m_ID.m_Height < Rules::HeightGenesis) || IsFastSync())
+		return false; // no consistent state yet
+
+	LOG_INFO() << "Exporting snapshot at " << m_Cursor.m_ID << "...";
+
+	// the images must be flushed and stamped consistently with the committed DB, and no transaction is allowed during the DB copy
+	if (m_DbTx.IsInProgress())
+		CommitUtxosAndDB();
+
+	m_DB.VacuumInto(szPath);
+	m_DbTx.Start(m_DB);
+
+	std::vector<std::string> vSrc, vDst;
+	get_ImagePaths(vSrc, m_sPath.c_str());
+	get_ImagePaths(vDst, szPath);
+
+	for (size_t i = 0; i < vSrc.size(); i++)
+		CopyFileStrict(vSrc[i].c_str(), vDst[i].c_str(), false); // missing images are rebuilt by the importer
+
+	std::string sSrc, sDst;
+	get_BlockStorePath(sSrc, m_sPath.c_str());
+	get_BlockStorePath(sDst, szPath);
+	m_DB.CopyBlockStore(sSrc.c_str(), sDst.c_str());
+
+	{
+		NodeDB db;
+		db.Open(szPath);
+
+		NodeDB::Transaction t(db);
+		db.EraseOwnData();
+		t.Commit();
+	}
+
+	Block::ChainWorkProof cwp;
+	GenerateCwp(cwp);
+
+	std::string sManifest;
+	get_SnapshotManifestPath(sManifest, szPath);
+
+	std::FStream fs;
+	fs.Open(sManifest.c_str(), false, true);
+	SnapshotSerializer ser(fs);
+
+	// same header as in the recovery info: the forks passed so far, then the proof of the tip
+	const Rules& r = Rules::get();
+
+	uint32_t nForks = 0;
+	for (; nForks < _countof(r.pForks); nForks++)
+	{
+		if (m_Cursor.m_ID.m_Height < r.pForks[nForks].m_Height)
+			break;
+	}
+
+	ser & nForks;
+	for (uint32_t iFork = 0; iFork < nForks; iFork++)
+		ser & r.pForks[iFork].m_Hash;
+
+	ser & cwp;
+	fs.Flush();
+
+	LOG_INFO() << "Snapshot exported";
+	return true;
+}
+
+bool NodeProcessor::ImportSnapshot(const char* szPath, const char* szSnapshot, Block::SystemState::Full& sTip)
+{
+	{
+		std::FStream fs;
+		if (fs.Open(szPath, true))
+		{
+			LOG_WARNING() << "Local data exists, snapshot ignored";
+			return false;
+		}
+	}
+
+	std::string sManifest;
+	get_SnapshotManifestPath(sManifest, szSnapshot);
+
+	{
+		std::FStream fs;
+		fs.Open(sManifest.c_str(), true, true);
+		SnapshotDeserializer der(fs);
+
+		const Rules& r = Rules::get();
+
+		uint32_t nForks = 0;
+		der & nForks;
+		if (nForks > _countof(r.pForks))
+			ThrowSnapshotError("rules mismatch");
+
+		for (uint32_t iFork = 0; iFork < nForks; iFork++)
+		{
+			ECC::Hash::Value hv;
+			der & hv;
+
+			if (hv != r.pForks[iFork].m_Hash)
+				ThrowSnapshotError("rules mismatch");
+		}
+
+		Block::ChainWorkProof cwp;
+		der & cwp;
+
+		if (!cwp.IsValid(&sTip))
+			ThrowSnapshotError("chainwork proof invalid");
+
+		if ((nForks < _countof(r.pForks)) && (sTip.m_Height >= r.pForks[nForks].m_Height))
+			ThrowSnapshotError("rules mismatch");
+	}
+
+	Block::SystemState::ID id;
+	sTip.get_ID(id);
+	LOG_INFO() << "Importing snapshot at " << id << "...";
+
+	CopyFileStrict(szSnapshot, szPath, true);
+
+	std::vector<std::string> vSrc, vDst;
+	get_ImagePaths(vSrc, szSnapshot);
+	get_ImagePaths(vDst, szPath);
+
+	for (size_t i = 0; i < vSrc.size(); i++)
+	{
+		if (!CopyFileStrict(vSrc[i].c_str(), vDst[i].c_str(), false))
+			DeleteFile(vDst[i].c_str()); // leftover of other data, must not be used
+	}
+
+	// block bodies are copied once the DB is opened, the list of the segments is there
+	return true;
+}
+
+void NodeProcessor::VerifySnapshot(const Block::SystemState::Full& sTip)
+{
+	// The tip is proven by the chainwork. Make sure the data corresponds to it.
+	// Nothing derived is trusted: the cached hashes, the MMRs and the shielded list are recalculated from the headers, the kernels and the DB.
+	// The kernels table and the shielded unique keys must match the kernels as well
+	Block::SystemState::ID id;
+	sTip.get_ID(id);
+
+	if (IsFastSync() || (m_Cursor.m_ID != id))
+		ThrowSnapshotError("tip mismatch");
+
+	// the imported sync state must not relax the checks (TestDefinition skips the heights below its TxoLo)
+	ZeroObject(m_SyncData);
+	SaveSyncData();
+
+	struct Verifier
+		:public Evaluator
+	{
+		Merkle::CompactMmr m_History;
+		Merkle::CompactMmr m_Shielded;
+		Merkle::CompactMmr m_Assets;
+
+		Verifier(NodeProcessor& p) :Evaluator(p) {}
+
+		virtual bool get_History(Merkle::Hash& hv) override
+		{
+			m_History.get_Hash(hv);
+			return true;
+		}
+
+		virtual bool get_Shielded(Merkle::Hash& hv) override
+		{
+			m_Shielded.get_Hash(hv);
+			return true;
+		}
+
+		virtual bool get_Assets(Merkle::Hash& hv) override
+		{
+			m_Assets.get_Hash(hv);
+			return true;
+		}
+	} ev(*this);
+
+	struct ShieldedWalker
+		:public TxKernel::IWalker
+	{
+		NodeProcessor& m_This;
+		Merkle::CompactMmr& m_Mmr;
+		Height m_Height = 0;
+		TxoID m_Outputs = 0;
+
+		ShieldedWalker(NodeProcessor& p, Merkle::CompactMmr& mmr) :m_This(p), m_Mmr(mmr) {}
+
+		// the unique key and its value, the same way HandleKernel stores them
+		bool IsUniqueStored(const ECC::Point& key, const Blob& val)
+		{
+			NodeDB::Recordset rs;
+			if (!m_This.m_DB.UniqueFind(Blob(&key, sizeof(key)), rs))
+				return false;
+
+			Blob blob;
+			rs.get(0, blob);
+			return !blob.cmp(val);
+		}
+
+		virtual bool OnKrn(const TxKernel& krn) override
+		{
+			Merkle::Hash hv;
+
+			switch (krn.get_Subtype())
+			{
+			case TxKernel::Subtype::ShieldedOutput:
+				{
+					const TxKernelShieldedOutput& v = Cast::Up<TxKernelShieldedOutput>(krn);
+
+					ShieldedTxo::DescriptionOutp d;
+					d.m_SerialPub = v.m_Txo.m_Serial.m_SerialPub;
+					d.m_Commitment = v.m_Txo.m_Commitment;
+					d.m_ID = m_Outputs;
+					d.m_Height = m_Height;
+					d.get_Hash(hv);
+
+					// the shielded list element, the same way HandleKernel stores it
+					if (m_Outputs >= m_This.m_Extra.m_ShieldedOutputs)
+						return false;
+
+					ECC::Point::Native pt, pt2;
+					pt.Import(v.m_Txo.m_Commitment);
+					pt2.Import(v.m_Txo.m_Serial.m_SerialPub);
+					pt += pt2;
+
+					ECC::Point::Storage pt_s, pt_s2;
+					pt.Export(pt_s);
+					m_This.m_DB.ShieldedRead(m_Outputs, &pt_s2, 1);
+
+					if (memcmp(&pt_s, &pt_s2, sizeof(pt_s)))
+						return false;
+
+					ShieldedOutpPacked sop;
+					sop.m_Height = m_Height;
+					sop.m_MmrIndex = m_Mmr.m_Count;
+					sop.m_TxoID = m_Outputs;
+					sop.m_Commitment = v.m_Txo.m_Commitment;
+
+					if (!IsUniqueStored(v.m_Txo.m_Serial.m_SerialPub, Blob(&sop, sizeof(sop))))
+						return false;
+
+					m_Outputs++;
+				}
+				break;
+
+			case TxKernel::Subtype::ShieldedInput:
+				{
+					ShieldedTxo::DescriptionInp d;
+					d.m_SpendPk = Cast::Up<TxKernelShieldedInput>(krn).m_SpendProof.m_SpendPk;
+					d.m_Height = m_Height;
+					d.get_Hash(hv);
+
+					ShieldedInpPacked sip;
+					sip.m_Height = m_Height;
+					sip.m_MmrIndex = m_Mmr.m_Count;
+
+					ECC::Point key = d.m_SpendPk;
+					key.m_Y |= 2;
+
+					if (!IsUniqueStored(key, Blob(&sip, sizeof(sip))))
+						return false;
+				}
+				break;
+
+			default:
+				return true;
+			}
+
+			m_Mmr.Append(hv);
+			return true;
+		}
+
+	} wlkShielded(*this, ev.m_Shielded);
+
+	// headers, from the genesis up to the tip. Each must be linked to the previous, and have the kernels of its block
+	Merkle::Hash hvPrev = Rules::get().Prehistoric;
+	uint64_t nKernels = 0;
+	for (Height h = Rules::HeightGenesis; h <= m_Cursor.m_ID.m_Height; h++)
+	{
+		uint64_t rowid = FindActiveAtStrict(h);
+
+		Block::SystemState::Full s;
+		m_DB.get_State(rowid, s);
+
+		if (s.m_Prev != hvPrev)
+			ThrowSnapshotError("headers mismatch");
+
+		s.get_Hash(hvPrev);
+		if (h < m_Cursor.m_ID.m_Height)
+			ev.m_History.Append(hvPrev);
+
+		ByteBuffer bbE;
+		m_DB.GetStateBlock(rowid, nullptr, &bbE, nullptr);
+		if (bbE.empty())
+			ThrowSnapshotError("block missing");
+
+		TxVectors::Eternal txve;
+
+		Deserializer der;
+		der.reset(bbE);
+		der & txve;
+
+		Merkle::FixedMmr mmr;
+		mmr.Resize(txve.m_vKernels.size());
+		ProcessKrnMmr(mmr, txve.m_vKernels, Zero, nullptr);
+
+		Merkle::Hash hv;
+		mmr.get_Hash(hv);
+		if (hv != s.m_Kernels)
+			ThrowSnapshotError("kernels mismatch");
+
+		for (size_t i = 0; i < txve.m_vKernels.size(); i++)
+			if (!m_DB.FindKernelAt(txve.m_vKernels[i]->m_Internal.m_ID, h))
+				ThrowSnapshotError("kernels mismatch");
+
+		nKernels += txve.m_vKernels.size();
+
+		wlkShielded.m_Height = h;
+		if (!wlkShielded.Process(txve.m_vKernels))
+			ThrowSnapshotError("shielded mismatch");
+	}
+
+	if (hvPrev != id.m_Hash)
+		ThrowSnapshotError("headers mismatch");
+
+	if (nKernels != m_DB.get_KernelsCount())
+		ThrowSnapshotError("kernels mismatch");
+
+	if ((wlkShielded.m_Outputs != m_Extra.m_ShieldedOutputs) || (ev.m_Shielded.m_Count != m_Mmr.m_Shielded.m_Count) || (ev.m_Shielded.m_Count != m_DB.get_UniqueCount()))
+		ThrowSnapshotError("shielded mismatch");
+
+	for (uint64_t i = 0; i < m_Mmr.m_Assets.m_Count; i++)
+	{
+		Asset::Full ai;
+		ai.m_ID = static_cast<Asset::ID>(i + 1);
+
+		Merkle::Hash hv;
+		if (m_DB.AssetGetSafe(ai))
+			ai.get_Hash(hv);
+		else
+			hv = Zero;
+
+		ev.m_Assets.Append(hv);
 	}
+
+	// the UTXO image is rehashed entirely, the kernel filter is rebuilt
+	m_Utxos.MarkAllDirty();
+	RebuildKernelFilter();
+
+	Merkle::Hash hvDef;
+	ev.get_Definition(hvDef);
+	if (hvDef != sTip.m_Definition)
+		ThrowSnapshotError("definition mismatch");
+
+	LOG_INFO() << "Snapshot verified";
 }
 
 void NodeProcessor::InitCursor(bool bMovingUp)
@@ -738,6 +1612,7 @@ struct NodeProcessor::MultiSigmaContext
 
 		ECC::Scalar::Native m_pS[s_Chunk];
 		uint32_t m_Min, m_Max;
+		Sigma::CmList* m_pLstAsync; // set by PrepareAsync
 
 		typedef boost::intrusive::multiset<ID> IDSet;
 	};
@@ -756,15 +1631,23 @@ struct NodeProcessor::MultiSigmaContext
 
 	void Calculate(ECC::Point::Native&, NodeProcessor&);
 
+	// Asynchronous evaluation, doesn't block the caller. Each window gets its own list, so that all the windows are evaluated concurrently, each split into nPortions.
+	// PrepareAsync should be called once (returns the total number of portions), then each portion may be calculated by a different executor thread.
+	uint32_t PrepareAsync(uint32_t nPortions);
+	void CalculateAsync(ECC::Point::Native&, uint32_t iPortion) const;
+
 private:
 
 	struct MyTask;
 
 	void DeleteRaw(Node&);
 	std::vector<ECC::Point::Native> m_vRes;
+	std::vector<const Node*> m_vAsync;
+	uint32_t m_nPortionsAsync = 0;
 
 	virtual Sigma::CmList& get_List() = 0;
 	virtual void PrepareList(NodeProcessor&, const Node&) = 0;
+	virtual Sigma::CmList* get_ListAsync(const Node&) = 0; // may be called from any thread, but not concurrently
 };
 
 void NodeProcessor::MultiSigmaContext::ClearLocked()
@@ -872,14 +1755,64 @@ void NodeProcessor::MultiSigmaContext::Calculate(ECC::Point::Native& res, NodePr
 	}
 }
 
+uint32_t NodeProcessor::MultiSigmaContext::PrepareAsync(uint32_t nPortions)
+{
+	assert(nPortions);
+	m_nPortionsAsync = nPortions;
+	m_vAsync.clear();
+
+	for (Node::IDSet::iterator it = m_Set.begin(); m_Set.end() != it; it++)
+	{
+		Node& n = it->get_ParentObj();
+		assert(n.m_Min < n.m_Max);
+		assert(n.m_Max <= s_Chunk);
+
+		n.m_pLstAsync = get_ListAsync(n);
+		assert(n.m_pLstAsync);
+
+		m_vAsync.push_back(&n);
+	}
+
+	return static_cast<uint32_t>(m_vAsync.size()) * nPortions;
+}
+
+void NodeProcessor::MultiSigmaContext::CalculateAsync(ECC::Point::Native& res, uint32_t iPortion) const
+{
+	const Node& n = *m_vAsync[iPortion / m_nPortionsAsync];
+	iPortion %= m_nPortionsAsync;
+
+	uint32_t nTotal = n.m_Max - n.m_Min;
+	uint32_t i0 = n.m_Min + static_cast<uint32_t>(uint64_t(nTotal) * iPortion / m_nPortionsAsync);
+	uint32_t i1 = n.m_Min + static_cast<uint32_t>(uint64_t(nTotal) * (iPortion + 1) / m_nPortionsAsync);
+
+	res = Zero;
+	if (i0 < i1)
+		n.m_pLstAsync->Calculate(res, i0, i1 - i0, n.m_pS);
+}
+
 struct NodeProcessor::MultiShieldedContext
 	:public NodeProcessor::MultiSigmaContext
 {
 	bool IsValid(const TxVectors::Eternal&, ECC::InnerProduct::BatchContext&, uint32_t iVerifier, uint32_t nTotal);
+
+	// For the asynchronous evaluation the windows are read in advance, the DB is accessed by the owner thread only
+	void Prefetch(NodeDB&, const TxVectors::Eternal&);
+
 private:
 
 	Sigma::CmListVec m_Lst;
 
+	struct Prefetched
+	{
+		Sigma::CmListVec m_Lst;
+		uint32_t m_Min;
+		uint32_t m_Max;
+	};
+
+	std::map<TxoID, Prefetched> m_mapPrefetched; // chunk -> elements read
+
+	void Prefetch(NodeDB&, const TxKernelShieldedInput&);
+
 	bool IsValid(const TxKernelShieldedInput&, std::vector<ECC::Scalar::Native>& vBuf, ECC::InnerProduct::BatchContext&);
 
 	virtual Sigma::CmList& get_List() override
@@ -887,12 +1820,86 @@ private:
 		return m_Lst;
 	}
 
-	virtual void PrepareList(NodeProcessor& np, const Node& n) override
+	virtual void PrepareList(NodeProcessor& np, const Node& n) override
+	{
+		m_Lst.m_vec.resize(s_Chunk); // will allocate if empty
+		np.get_DB().ShieldedRead(n.m_ID.m_Value + n.m_Min, &m_Lst.m_vec.front() + n.m_Min, n.m_Max - n.m_Min);
+	}
+
+	virtual Sigma::CmList* get_ListAsync(const Node& n) override
+	{
+		std::map<TxoID, Prefetched>::iterator it = m_mapPrefetched.find(n.m_ID.m_Value);
+		if (m_mapPrefetched.end() == it)
+			return nullptr;
+
+		Prefetched& x = it->second;
+		if ((n.m_Min < x.m_Min) || (n.m_Max > x.m_Max))
+			return nullptr;
+
+		return &x.m_Lst;
+	}
+};
+
+void NodeProcessor::MultiShieldedContext::Prefetch(NodeDB& db, const TxKernelShieldedInput& krn)
+{
+	// the same window as the verification accumulates (see IsValid)
+	TxoID id1 = krn.m_WindowEnd;
+	uint32_t N = krn.m_SpendProof.m_Cfg.get_N();
+	TxoID id0 = (id1 >= N) ? (id1 - N) : 0;
+
+	while (id0 < id1)
+	{
+		uint32_t nOffset = static_cast<uint32_t>(id0 % s_Chunk);
+		TxoID key = id0 - nOffset;
+		uint32_t nEnd = static_cast<uint32_t>(std::min<TxoID>(id1 - key, s_Chunk));
+
+		Prefetched& x = m_mapPrefetched[key];
+		if (x.m_Lst.m_vec.empty())
+		{
+			x.m_Lst.m_vec.resize(s_Chunk);
+			x.m_Min = x.m_Max = nOffset;
+		}
+
+		// keep the read range contiguous, the windows of the same chunk are merged during the verification
+		ECC::Point::Storage* pS = &x.m_Lst.m_vec.front();
+
+		if (nOffset < x.m_Min)
+		{
+			db.ShieldedRead(key + nOffset, pS + nOffset, x.m_Min - nOffset);
+			x.m_Min = nOffset;
+		}
+
+		if (nEnd > x.m_Max)
+		{
+			db.ShieldedRead(key + x.m_Max, pS + x.m_Max, nEnd - x.m_Max);
+			x.m_Max = nEnd;
+		}
+
+		id0 = key + nEnd;
+	}
+}
+
+void NodeProcessor::MultiShieldedContext::Prefetch(NodeDB& db, const TxVectors::Eternal& txve)
+{
+	struct Walker
+		:public TxKernel::IWalker
 	{
-		m_Lst.m_vec.resize(s_Chunk); // will allocate if empty
-		np.get_DB().ShieldedRead(n.m_ID.m_Value + n.m_Min, &m_Lst.m_vec.front() + n.m_Min, n.m_Max - n.m_Min);
-	}
-};
+		MultiShieldedContext* m_pThis;
+		NodeDB* m_pDB;
+
+		virtual bool OnKrn(const TxKernel& krn) override
+		{
+			if (TxKernel::Subtype::ShieldedInput == krn.get_Subtype())
+				m_pThis->Prefetch(*m_pDB, Cast::Up<TxKernelShieldedInput>(krn));
+			return true;
+		}
+
+	} wlk;
+	wlk.m_pThis = this;
+	wlk.m_pDB = &db;
+
+	wlk.Process(txve.m_vKernels);
+}
 
 bool NodeProcessor::MultiShieldedContext::IsValid(const TxKernelShieldedInput& krn, std::vector<ECC::Scalar::Native>& vKs, ECC::InnerProduct::BatchContext& bc)
 {
@@ -974,19 +1981,32 @@ struct NodeProcessor::MultiAssetContext
 
 private:
 
-	Asset::Proof::CmList m_Lst;
+	Sigma::CmList* m_pLst = nullptr;
+	std::list<Asset::Proof::CmList> m_lstAsync; // the generators are calculated on-demand, by the executor threads
+
+	virtual Sigma::CmList* get_ListAsync(const Node& n) override
+	{
+		m_lstAsync.emplace_back();
+		m_lstAsync.back().m_Begin = static_cast<Asset::ID>(n.m_ID.m_Value);
+		return &m_lstAsync.back();
+	}
 
 	virtual Sigma::CmList& get_List() override
 	{
-		return m_Lst;
+		assert(m_pLst);
+		return *m_pLst;
 	}
 
 	virtual void PrepareList(NodeProcessor& np, const Node& n) override
 	{
-		static_assert(sizeof(n.m_ID.m_Value) >= sizeof(m_Lst.m_Begin));
+		AssetGens& ag = np.m_AssetGens;
+		static_assert(sizeof(n.m_ID.m_Value) >= sizeof(ag.m_Src.m_Begin));
+
+		// calculated in the owner thread only, the list elements are read concurrently by the executor threads
+		ag.m_Src.m_Begin = static_cast<Asset::ID>(n.m_ID.m_Value);
+		ag.m_Cache.SetWindow(ag.m_Src, n.m_ID.m_Value, s_Chunk);
 
-		// TODO: maybe cache it in DB
-		m_Lst.m_Begin = static_cast<Asset::ID>(n.m_ID.m_Value);
+		m_pLst = &ag.m_Cache;
 	}
 };
 
@@ -1097,6 +2117,18 @@ struct NodeProcessor::MultiblockContext
 			TxBase::Context::Params m_Pars;
 			TxBase::Context m_Ctx;
 
+			// raw body, valid until deserialized
+			ByteBuffer m_bbP;
+			ByteBuffer m_bbE;
+
+			enum struct Status {
+				Pending,
+				Deserialized,
+				Corrupted
+			};
+
+			Status m_Status = Status::Pending; // protected by m_Mbc.m_Mutex
+
 			SharedBlock(MultiblockContext& mbc)
 				:Shared(mbc)
 				,m_Ctx(m_Pars)
@@ -1106,12 +2138,108 @@ struct NodeProcessor::MultiblockContext
 			virtual ~SharedBlock() {} // auto
 
 			virtual void Exec(uint32_t iVerifier) override;
+
+			void Deserialize();
 		};
 
 		Shared::Ptr m_pShared;
 		uint32_t m_iVerifier;
 	};
 
+	// Import pipeline: block bodies are read from the DB (on the caller thread) and deserialized (by the executor) ahead of time.
+	// So that several subsequent blocks are decoded while the current one is being interpreted, and their context-free
+	// verification is started as soon as they're handled.
+	struct DeserializeTask
+		:public Executor::TaskAsync
+	{
+		MyTask::SharedBlock::Ptr m_pShared;
+
+		virtual void Exec(Executor::Context&) override
+		{
+			m_pShared->Deserialize();
+		}
+		virtual ~DeserializeTask() {}
+	};
+
+	struct Prefetched
+	{
+		uint64_t m_Row;
+		MyTask::SharedBlock::Ptr m_pShared;
+	};
+
+	static const uint32_t s_PrefetchBlocks = 16;
+	static const size_t s_PrefetchSize = 1024 * 1024 * 10;
+
+	std::deque<Prefetched> m_Prefetch;
+	size_t m_SizePrefetch = 0;
+
+	// pRows is the remaining path, in reverse order (the next block is the last one)
+	void Prefetch(const uint64_t* pRows, size_t nRows)
+	{
+		assert(m_Prefetch.size() <= nRows);
+		while ((m_Prefetch.size() < nRows) && (m_Prefetch.size() < s_PrefetchBlocks))
+		{
+			if (!m_Prefetch.empty() && (m_SizePrefetch >= s_PrefetchSize))
+				break;
+
+			PrefetchOne(pRows[nRows - m_Prefetch.size() - 1]);
+		}
+	}
+
+	void PrefetchOne(uint64_t row)
+	{
+		Prefetched& x = m_Prefetch.emplace_back();
+		x.m_Row = row;
+		x.m_pShared = std::make_shared<MyTask::SharedBlock>(*this);
+
+		MyTask::SharedBlock& sb = *x.m_pShared;
+		m_This.m_DB.GetStateBlock(row, &sb.m_bbP, &sb.m_bbE, nullptr);
+
+		sb.m_Size = sb.m_bbP.size() + sb.m_bbE.size();
+		m_SizePrefetch += sb.m_Size;
+
+		std::unique_ptr<DeserializeTask> pTask(new DeserializeTask);
+		pTask->m_pShared = x.m_pShared;
+		m_This.get_Executor().Push(std::move(pTask));
+	}
+
+	MyTask::SharedBlock::Ptr get_Prefetched(uint64_t row)
+	{
+		if (!m_Prefetch.empty() && (m_Prefetch.front().m_Row != row))
+		{
+			// path changed. Discard (pending tasks will complete harmlessly)
+			m_Prefetch.clear();
+			m_SizePrefetch = 0;
+		}
+
+		if (m_Prefetch.empty())
+			PrefetchOne(row);
+
+		MyTask::SharedBlock::Ptr pShared = std::move(m_Prefetch.front().m_pShared);
+		m_Prefetch.pop_front();
+
+		assert(m_SizePrefetch >= pShared->m_Size);
+		m_SizePrefetch -= pShared->m_Size;
+
+		Executor& ex = m_This.get_Executor();
+		for (uint32_t nTasks = static_cast<uint32_t>(-1); ; )
+		{
+			{
+				std::unique_lock<std::mutex> scope(m_Mutex);
+				if (MyTask::SharedBlock::Status::Pending != pShared->m_Status)
+					break;
+			}
+
+			assert(nTasks);
+			nTasks = ex.Flush(nTasks - 1);
+		}
+
+		if (MyTask::SharedBlock::Status::Corrupted == pShared->m_Status)
+			pShared.reset();
+
+		return pShared;
+	}
+
 	bool Flush()
 	{
 		FlushInternal();
@@ -1324,6 +2452,30 @@ void NodeProcessor::MultiblockContext::MyTask::Exec(Executor::Context&)
 	m_pShared->Exec(m_iVerifier);
 }
 
+void NodeProcessor::MultiblockContext::MyTask::SharedBlock::Deserialize()
+{
+	Status status = Status::Deserialized;
+
+	try {
+		Deserializer der;
+		der.reset(m_bbP);
+		der & Cast::Down<Block::BodyBase>(m_Body);
+		der & Cast::Down<TxVectors::Perishable>(m_Body);
+
+		der.reset(m_bbE);
+		der & Cast::Down<TxVectors::Eternal>(m_Body);
+	}
+	catch (const std::exception&) {
+		status = Status::Corrupted;
+	}
+
+	ByteBuffer().swap(m_bbP);
+	ByteBuffer().swap(m_bbE);
+
+	std::unique_lock<std::mutex> scope(m_Mbc.m_Mutex);
+	m_Status = status;
+}
+
 void NodeProcessor::MultiblockContext::MyTask::SharedBlock::Exec(uint32_t iVerifier)
 {
 	TxBase::Context ctx(m_Ctx.m_Params);
@@ -1439,6 +2591,7 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 	while (iPos)
 	{
 		sidFwd.m_Height = m_Cursor.m_Sid.m_Height + 1;
+		mbc.Prefetch(&vPath.front(), iPos);
 		sidFwd.m_Row = vPath[--iPos];
 
 		Block::SystemState::Full s;
@@ -1832,7 +2985,17 @@ bool NodeProcessor::Evaluator::get_History(Merkle::Hash& hv)
 
 bool NodeProcessor::Evaluator::get_Utxos(Merkle::Hash& hv)
 {
-	m_Proc.m_Utxos.get_Hash(hv);
+	// Use the executor for parallel hashing only if it's idle. Otherwise its threads are already busy with the block verification,
+	// and waiting for them would stall the pipeline.
+	Executor& ex = m_Proc.get_Executor();
+	if (!ex.Flush(static_cast<uint32_t>(-1))) // doesn't wait, just returns the number of pending tasks
+	{
+		Executor::Scope scope(ex);
+		m_Proc.m_Utxos.get_Hash(hv);
+	}
+	else
+		m_Proc.m_Utxos.get_Hash(hv);
+
 	return true;
 }
 
@@ -1882,9 +3045,40 @@ uint64_t NodeProcessor::ProcessKrnMmr(Merkle::Mmr& mmr, std::vector<TxKernel::Pt
 	return iRet;
 }
 
+void NodeProcessor::GenerateCwp(Block::ChainWorkProof& cwp)
+{
+	struct Source
+		:public Block::ChainWorkProof::ISource
+	{
+		NodeProcessor& m_Proc;
+
+		Source(NodeProcessor& proc)
+			:m_Proc(proc)
+		{}
+
+		virtual void get_StateAt(Block::SystemState::Full& s, const Difficulty::Raw& d) override
+		{
+			uint64_t rowid = m_Proc.m_DB.FindStateWorkGreater(d);
+			m_Proc.m_DB.get_State(rowid, s);
+		}
+
+		virtual void get_Proof(Merkle::IProofBuilder& bld, Height h) override
+		{
+			m_Proc.m_Mmr.m_States.get_Proof(bld, m_Proc.m_Mmr.m_States.H2I(h));
+		}
+	};
+
+	Source src(*this);
+
+	cwp.Create(src, m_Cursor.m_Full);
+
+	Evaluator ev(*this);
+	ev.get_Live(cwp.m_hvRootLive);
+}
+
 Height NodeProcessor::get_ProofKernel(Merkle::Proof& proof, TxKernel::Ptr* ppRes, const Merkle::Hash& idKrn)
 {
-	Height h = m_DB.FindKernel(idKrn);
+	Height h = FindKernel(idKrn);
 	if (h < Rules::HeightGenesis)
 		return h;
 
@@ -2120,30 +3314,19 @@ struct NodeProcessor::KrnFlyMmr
 
 bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemState::Full& s, MultiblockContext& mbc)
 {
-	ByteBuffer bbP, bbE;
-	m_DB.GetStateBlock(sid.m_Row, &bbP, &bbE, nullptr);
-
-	MultiblockContext::MyTask::SharedBlock::Ptr pShared = std::make_shared<MultiblockContext::MyTask::SharedBlock>(mbc);
-	Block::Body& block = pShared->m_Body;
-
-	try {
-		Deserializer der;
-		der.reset(bbP);
-		der & Cast::Down<Block::BodyBase>(block);
-		der & Cast::Down<TxVectors::Perishable>(block);
-
-		der.reset(bbE);
-		der & Cast::Down<TxVectors::Eternal>(block);
-	}
-	catch (const std::exception&) {
+	MultiblockContext::MyTask::SharedBlock::Ptr pShared = mbc.get_Prefetched(sid.m_Row);
+	if (!pShared)
+	{
 		LOG_WARNING() << LogSid(m_DB, sid) << " Block deserialization failed";
 		return false;
 	}
 
+	Block::Body& block = pShared->m_Body;
+	ByteBuffer bbP;
+
 	bool bFirstTime = (m_DB.get_StateTxos(sid.m_Row) == MaxHeight);
 	if (bFirstTime)
 	{
-		pShared->m_Size = bbP.size() + bbE.size();
 		pShared->m_Ctx.m_Height = sid.m_Height;
 
 		PeerID pid;
@@ -2658,7 +3841,7 @@ bool NodeProcessor::IsDummy(const CoinID&  cid)
 
 Height NodeProcessor::FindVisibleKernel(const Merkle::Hash& id, const BlockInterpretCtx& bic)
 {
-	Height h = m_DB.FindKernel(id);
+	Height h = FindKernel(id);
 	if (h >= Rules::HeightGenesis)
 	{
 		assert(h <= bic.m_Height);
@@ -3004,6 +4187,7 @@ bool NodeProcessor::HandleKernel(const TxKernelShieldedOutput& krn, BlockInterpr
 
 		assert(m_Extra.m_ShieldedOutputs);
 		m_Extra.m_ShieldedOutputs--;
+		m_ShieldedRollbacks++;
 	}
 
 	if (bic.m_StoreShieldedOutput)
@@ -3331,7 +4515,10 @@ bool NodeProcessor::HandleBlockElement(const TxKernel& v, BlockInterpretCtx& bic
 	}
 
 	if (bSaveID && bic.m_Fwd)
+	{
 		m_DB.InsertKernel(v.m_Internal.m_ID, bic.m_Height);
+		m_KernelFilter.Add(v.m_Internal.m_ID);
+	}
 
 	return true;
 }
@@ -4357,7 +5544,7 @@ uint32_t NodeProcessor::MyExecutor::Flush(uint32_t)
 
 void NodeProcessor::MyExecutor::ExecAll(TaskSync& t)
 {
-	ECC::InnerProduct::BatchContext::Scope scope(m_Ctx.m_BatchCtx);
+	ECC::InnerProduct::BatchContext::Scope scope(*m_Ctx.m_pBatchCtx);
 	t.Exec(m_Ctx);
 }
 
@@ -4414,6 +5601,298 @@ bool NodeProcessor::ValidateAndSummarize(TxBase::Context& ctx, const TxBase& txb
 	return mbc.Flush();
 }
 
+struct NodeProcessor::TxBatch::Internal
+{
+	std::mutex m_Mutex;
+	uint32_t m_Pending = 0; // tasks
+	Height m_hMin;
+	uint64_t m_ShieldedRollbacks; // when the shielded windows were read
+
+	Executor* m_pExecutor;
+	MultiAssetContext m_Mac;
+	MultiShieldedContext m_Msc; // shared by all the txs, those that reference overlapping windows are calculated at once
+
+	typedef ECC::InnerProduct::BatchContextEx<4> BatchCtx;
+	std::vector<std::unique_ptr<BatchCtx> > m_vBc; // per executor thread, created on demand
+	ECC::Point::Native m_Sigma; // sum of the batch contexts residuals
+
+	struct TaskVerify
+		:public Executor::TaskAsync
+	{
+		TxBatch::Ptr m_pBatch;
+		uint32_t m_iItem;
+		uint32_t m_iVerifier;
+
+		virtual void Exec(Executor::Context&) override;
+		virtual ~TaskVerify() {}
+	};
+
+	struct TaskFlush
+		:public Executor::TaskAsync
+	{
+		TxBatch::Ptr m_pBatch;
+		uint32_t m_iBc;
+
+		virtual void Exec(Executor::Context&) override;
+		virtual ~TaskFlush() {}
+	};
+
+	struct TaskSigma
+		:public Executor::TaskAsync
+	{
+		TxBatch::Ptr m_pBatch;
+		const MultiSigmaContext* m_pCtx;
+		uint32_t m_iPortion;
+
+		virtual void Exec(Executor::Context&) override;
+		virtual ~TaskSigma() {}
+	};
+
+	static void OnVerified(const TxBatch::Ptr&);
+	static void OnFlushed(const TxBatch::Ptr&);
+};
+
+NodeProcessor::TxBatch::TxBatch()
+{
+}
+
+NodeProcessor::TxBatch::~TxBatch()
+{
+}
+
+void NodeProcessor::TxBatchStart(const TxBatch::Ptr& pBatch)
+{
+	TxBatch& b = *pBatch;
+	assert(!b.m_vItems.empty() && !b.m_pInternal);
+
+	Executor& ex = get_Executor();
+	uint32_t nThreads = ex.get_Threads();
+
+	b.m_bBatchValid = false;
+	b.m_bBatchRetry = false;
+	b.m_pInternal.reset(new TxBatch::Internal);
+	TxBatch::Internal& bi = *b.m_pInternal;
+
+	bi.m_pExecutor = &ex;
+	bi.m_vBc.resize(nThreads);
+	bi.m_Sigma = Zero;
+	bi.m_hMin = m_Cursor.m_ID.m_Height + 1;
+	bi.m_ShieldedRollbacks = m_ShieldedRollbacks;
+
+	// split the txs between several verifiers only if there are less txs than threads
+	uint32_t nItems = static_cast<uint32_t>(b.m_vItems.size());
+	uint32_t nVerifiers = std::max(nThreads / nItems, 1U);
+
+	bi.m_Pending = nItems * nVerifiers; // set before any task is pushed
+
+	for (uint32_t i = 0; i < nItems; i++)
+	{
+		TxBatch::Item& x = b.m_vItems[i];
+		assert(x.m_pTx);
+
+		x.m_Pars.m_nVerifiers = nVerifiers;
+		x.m_Pars.m_pAbort = &x.m_bAbort;
+		x.m_Ctx.m_Height.m_Min = bi.m_hMin;
+
+		// shielded inputs can be batched only if their windows are already present
+		x.m_bShieldedBatched = IsShieldedInPool(*x.m_pTx);
+		if (x.m_bShieldedBatched)
+			bi.m_Msc.Prefetch(m_DB, *x.m_pTx);
+	}
+
+	for (uint32_t i = 0; i < nItems; i++)
+	{
+		for (uint32_t iV = 0; iV < nVerifiers; iV++)
+		{
+			std::unique_ptr<TxBatch::Internal::TaskVerify> pTask(new TxBatch::Internal::TaskVerify);
+			pTask->m_pBatch = pBatch;
+			pTask->m_iItem = i;
+			pTask->m_iVerifier = iV;
+			ex.Push(std::move(pTask));
+		}
+	}
+}
+
+void NodeProcessor::TxBatch::Internal::TaskVerify::Exec(Executor::Context& ctxEx)
+{
+	TxBatch& b = *m_pBatch;
+	Internal& bi = *b.m_pInternal;
+	Item& x = b.m_vItems[m_iItem];
+
+	std::unique_ptr<BatchCtx>& pBc = bi.m_vBc[ctxEx.m_iThread]; // only this thread accesses it
+	if (!pBc)
+		pBc.reset(new BatchCtx);
+
+	ECC::InnerProduct::BatchContext::Scope scopeBc(*pBc);
+
+	MultiAssetContext::BatchCtx bcAssets(bi.m_Mac);
+	Asset::Proof::BatchContext::Scope scopeAssets(bcAssets);
+
+	TxBase::Context ctx(x.m_Pars);
+	ctx.m_Height.m_Min = bi.m_hMin;
+	ctx.m_iVerifier = m_iVerifier;
+
+	bool bValid = ctx.ValidateAndSummarize(*x.m_pTx, x.m_pTx->get_Reader());
+
+	if (bValid && x.m_bShieldedBatched)
+		bValid = bi.m_Msc.IsValid(*x.m_pTx, *pBc, m_iVerifier, x.m_Pars.m_nVerifiers);
+
+	bool bLast;
+	{
+		std::unique_lock<std::mutex> scope(bi.m_Mutex);
+
+		if (bValid)
+			bValid = x.m_Ctx.Merge(ctx);
+
+		if (!bValid)
+			x.m_bAbort = true;
+
+		assert(x.m_Done < x.m_Pars.m_nVerifiers);
+		if (++x.m_Done == x.m_Pars.m_nVerifiers)
+			x.m_bValid = !x.m_bAbort && x.m_Ctx.IsValidTransaction();
+
+		assert(bi.m_Pending);
+		bLast = !--bi.m_Pending;
+	}
+
+	if (bLast)
+		OnVerified(m_pBatch);
+}
+
+void NodeProcessor::TxBatch::Internal::OnVerified(const TxBatch::Ptr& pBatch)
+{
+	// all the txs are verified, now flush the batch contexts, in parallel
+	Internal& bi = *pBatch->m_pInternal;
+	Executor& ex = *bi.m_pExecutor;
+
+	std::vector<Executor::TaskAsync::Ptr> vTasks;
+	for (uint32_t i = 0; i < bi.m_vBc.size(); i++)
+	{
+		if (!bi.m_vBc[i])
+			continue;
+
+		std::unique_ptr<TaskFlush> pTask(new TaskFlush);
+		pTask->m_pBatch = pBatch;
+		pTask->m_iBc = i;
+		vTasks.push_back(std::move(pTask));
+	}
+
+	if (vTasks.empty())
+	{
+		OnFlushed(pBatch);
+		return;
+	}
+
+	bi.m_Pending = static_cast<uint32_t>(vTasks.size()); // no other task is running now
+
+	// don't access the batch internals while pushing, it may complete meanwhile
+	for (size_t i = 0; i < vTasks.size(); i++)
+		ex.Push(std::move(vTasks[i]));
+}
+
+void NodeProcessor::TxBatch::Internal::TaskFlush::Exec(Executor::Context&)
+{
+	Internal& bi = *m_pBatch->m_pInternal;
+	BatchCtx& bc = *bi.m_vBc[m_iBc];
+
+	bool bOk = bc.Flush();
+
+	bool bLast;
+	{
+		std::unique_lock<std::mutex> scope(bi.m_Mutex);
+
+		if (!bOk)
+			bi.m_Sigma += bc.m_Sum;
+
+		assert(bi.m_Pending);
+		bLast = !--bi.m_Pending;
+	}
+
+	if (bLast)
+		OnFlushed(m_pBatch);
+}
+
+void NodeProcessor::TxBatch::Internal::OnFlushed(const TxBatch::Ptr& pBatch)
+{
+	// evaluate the asset and shielded windows as well, in parallel
+	Internal& bi = *pBatch->m_pInternal;
+	Executor& ex = *bi.m_pExecutor;
+
+	uint32_t nThreads = static_cast<uint32_t>(bi.m_vBc.size());
+	const MultiSigmaContext* ppCtx[] = { &bi.m_Mac, &bi.m_Msc };
+	uint32_t pPortions[] = {
+		bi.m_Mac.PrepareAsync(nThreads),
+		bi.m_Msc.PrepareAsync(nThreads)
+	};
+
+	std::vector<Executor::TaskAsync::Ptr> vTasks;
+
+	for (uint32_t iCtx = 0; iCtx < _countof(ppCtx); iCtx++)
+	{
+		for (uint32_t i = 0; i < pPortions[iCtx]; i++)
+		{
+			std::unique_ptr<TaskSigma> pTask(new TaskSigma);
+			pTask->m_pBatch = pBatch;
+			pTask->m_pCtx = ppCtx[iCtx];
+			pTask->m_iPortion = i;
+			vTasks.push_back(std::move(pTask));
+		}
+	}
+
+	if (vTasks.empty())
+	{
+		pBatch->OnDone();
+		return;
+	}
+
+	bi.m_Pending = static_cast<uint32_t>(vTasks.size()); // no other task is running now
+
+	for (size_t i = 0; i < vTasks.size(); i++)
+		ex.Push(std::move(vTasks[i]));
+}
+
+void NodeProcessor::TxBatch::Internal::TaskSigma::Exec(Executor::Context&)
+{
+	Internal& bi = *m_pBatch->m_pInternal;
+
+	ECC::Point::Native val;
+	m_pCtx->CalculateAsync(val, m_iPortion);
+
+	bool bLast;
+	{
+		std::unique_lock<std::mutex> scope(bi.m_Mutex);
+
+		bi.m_Sigma += val;
+
+		assert(bi.m_Pending);
+		bLast = !--bi.m_Pending;
+	}
+
+	if (bLast)
+		m_pBatch->OnDone(); // must be the last access to the batch from this thread
+}
+
+void NodeProcessor::TxBatchFinalize(TxBatch& b)
+{
+	assert(b.m_pInternal);
+	TxBatch::Internal& bi = *b.m_pInternal;
+	assert(!bi.m_Pending);
+
+	// the shielded windows were read at the batch start. Make sure they're unchanged, and still in the pool (the state could be rolled back meanwhile)
+	bool bShieldedOk = (bi.m_ShieldedRollbacks == m_ShieldedRollbacks);
+	for (size_t i = 0; bShieldedOk && (i < b.m_vItems.size()); i++)
+	{
+		const TxBatch::Item& x = b.m_vItems[i];
+		if (x.m_bShieldedBatched && !IsShieldedInPool(*x.m_pTx))
+			bShieldedOk = false;
+	}
+
+	b.m_bBatchValid = bShieldedOk && (bi.m_Sigma == Zero);
+	b.m_bBatchRetry = !bShieldedOk; // not the txs' fault
+
+	b.m_pInternal.reset();
+}
+
 bool NodeProcessor::ExtractBlockWithExtra(Block::Body& block, const NodeDB::StateID& sid)
 {
 	ByteBuffer bbE;
@@ -34,9 +34,47 @@ class NodeProcessor
 	} m_DB;
 
 	NodeDB::Transaction m_DbTx;
+	std::string m_sPath; // DB path, the rest of the data is derived from it
 
 	UtxoTreeMapped m_Utxos;
 
+	// Memory-mapped copy of a DB stream (MMRs and the shielded list), stamped the same way as the UTXO image
+	class StreamImage
+		:public NodeDB::IStreamImage
+	{
+		MappedFile m_Mapping;
+		std::string m_sPath;
+
+#pragma pack(push, 1)
+		struct Hdr
+		{
+			uint64_t m_Size;
+			uint64_t m_Dirty; // boolean, just aligned
+			Merkle::Hash m_Stamp;
+		};
+#pragma pack(pop)
+
+		static void get_Defs(MappedFile::Defs&);
+		Hdr& get_Hdr() const;
+		uint8_t* get_Data(uint64_t pos, uint64_t nCount) const;
+
+	public:
+		bool Open(const char* sz, const Merkle::Hash& stamp); // returns false if the image is invalid and should be refilled
+		void Reset();
+		bool IsOpen() const { return m_Mapping.get_Base() != nullptr; }
+
+		bool IsDirty() const { return IsOpen() && get_Hdr().m_Dirty; }
+		void OnDirty() { get_Hdr().m_Dirty = 1; }
+		void FlushStrict(const Merkle::Hash& stamp);
+
+		// IStreamImage
+		virtual void Resize(uint64_t) override;
+		virtual void Read(uint64_t pos, uint8_t*, uint64_t nCount) override;
+		virtual void Write(uint64_t pos, const uint8_t*, uint64_t nCount) override;
+	};
+
+	StreamImage m_pStreamImage[NodeDB::StreamType::count];
+
 	size_t m_nSizeUtxoComission;
 
 	struct MultiblockContext;
@@ -44,6 +82,15 @@ class NodeProcessor
 	struct MultiShieldedContext;
 	struct MultiAssetContext;
 
+	// Asset generators don't depend on the state, the recently used window is kept across the blocks and tx batches
+	struct AssetGens
+	{
+		Asset::Proof::CmList m_Src;
+		Sigma::CmListCache m_Cache;
+	} m_AssetGens;
+
+	uint64_t m_ShieldedRollbacks = 0; // incremented once a shielded output is removed, the shielded list is append-only otherwise
+
 	void RollbackTo(Height);
 	Height PruneOld();
 	Height RaiseFossil(Height);
@@ -104,10 +151,21 @@ class NodeProcessor
 	void AdjustOffset(ECC::Scalar&, uint64_t rowid, bool bAdd);
 
 	void InitCursor(bool bMovingUp);
-	bool InitUtxoMapping(const char*, bool bForceReset);
-	void InitializeUtxos(const char*);
+	void get_ImageStamp(Merkle::Hash&, bool bForceReset);
+	bool InitUtxoMapping(const char*, bool bForceReset, uint32_t nFlags);
+	void InitKernelFilter(const char*);
+	void RebuildKernelFilter();
+	void InitStreamImages(const char*);
+	bool IsImageDirty() const;
+	void SetImagesDirty();
+	void FlushImages(const Merkle::Hash&);
+	Height FindKernel(const Merkle::Hash&);
+	void InitializeUtxos(const char*, uint32_t nFlags, bool bCompact); // nFlags - MappedFile::Flags
 	static void OnCorrupted();
 
+	bool ImportSnapshot(const char* szPath, const char* szSnapshot, Block::SystemState::Full& sTip); // returns false if the local data already exists
+	void VerifySnapshot(const Block::SystemState::Full& sTip);
+
 	typedef std::pair<int64_t, std::pair<int64_t, Difficulty::Raw> > THW; // Time-Height-Work. Time and Height are signed
 	Difficulty get_NextDifficulty();
 	Timestamp get_MovingMedian();
@@ -169,12 +227,25 @@ public:
 		bool m_Vacuum = false;
 		bool m_ResetSelfID = false;
 		bool m_EraseSelfID = false;
+		bool m_UtxoHugePages = false;
+		bool m_UtxoPrefault = false;
+		std::string m_sSnapshot; // DB path of the snapshot to bootstrap from, used only if there's no local data yet
 	};
 
 	void Initialize(const char* szPath);
 	void Initialize(const char* szPath, const StartParams&);
 
 	static void get_UtxoMappingPath(std::string&, const char*);
+	static void get_KernelFilterPath(std::string&, const char*);
+	static void get_StreamImagePath(std::string&, const char*, NodeDB::StreamType::Enum);
+	static void get_BlockStorePath(std::string&, const char*); // prefix of the block body segment files
+	static void get_ImagePaths(std::vector<std::string>&, const char*); // all the images that accompany the DB
+	static void get_DerivedPath(std::string&, const char*, const char* szSufix);
+	static void get_SnapshotManifestPath(std::string&, const char*);
+
+	// Self-verifying snapshot of the current state. The snapshot DB is written to szPath, the rest is derived from it the same way as for the node data:
+	// images, block bodies, and the manifest with the chainwork proof of the tip. Importing node verifies it and starts at the same height without replaying the blocks.
+	bool ExportSnapshot(const char* szPath);
 
 	NodeProcessor();
 	virtual ~NodeProcessor();
@@ -237,6 +308,61 @@ public:
 
 	bool IsFastSync() const { return m_SyncData.m_Target.m_Row != 0; }
 
+	// Blocked bloom filter of the kernel IDs, mapped to a file next to the UTXO image, and stamped the same way.
+	// Answers "definitely absent" without touching the DB. Deleted kernels are not removed (false positives only)
+	class KernelFilter
+	{
+		MappedFile m_Mapping;
+		std::string m_sPath;
+
+#pragma pack(push, 1)
+		struct Hdr
+		{
+			uint64_t m_Blocks; // power of 2
+			uint64_t m_Count;
+			uint64_t m_Dirty; // boolean, just aligned
+			Merkle::Hash m_Stamp;
+		};
+#pragma pack(pop)
+
+		static const uint32_t s_BlockWords = 8; // 512 bits, single cache line
+		static const uint32_t s_Probes = 8;
+		static const uint32_t s_BitsPerElement = 16; // ~0.1% false positives at the full load
+		static const uint64_t s_CapacityMin = 1ULL << 20;
+
+		struct Block {
+			uint64_t m_p[s_BlockWords];
+		};
+
+		Hdr& get_Hdr() const;
+		Block& get_Block(const Merkle::Hash&) const;
+		static void get_Defs(MappedFile::Defs&, uint64_t nBlocks);
+
+	public:
+
+		struct Stats
+		{
+			uint64_t m_Absent = 0; // DB lookups saved
+			uint64_t m_Present = 0; // DB lookups needed
+			uint64_t m_FalsePositive = 0; // DB lookups that found nothing
+
+		} m_Stats;
+
+		bool Open(const char* sz, const Merkle::Hash& stamp); // returns false if the image is invalid and should be rebuilt
+		void Reset(uint64_t nCapacity); // empty and dirty
+		void Close();
+		bool IsOpen() const { return m_Mapping.get_Base() != nullptr; }
+
+		bool IsDirty() const { return IsOpen() && get_Hdr().m_Dirty; }
+		bool IsOverloaded() const;
+		void OnDirty() { get_Hdr().m_Dirty = 1; }
+		void FlushStrict(const Merkle::Hash& stamp);
+
+		void Add(const Merkle::Hash&);
+		bool MayContain(const Merkle::Hash&) const;
+
+	} m_KernelFilter;
+
 	void SaveSyncData();
 	void LogSyncData();
 
@@ -304,8 +430,10 @@ public:
 	};
 
 	Height get_ProofKernel(Merkle::Proof&, TxKernel::Ptr*, const Merkle::Hash& idKrn);
+	void GenerateCwp(Block::ChainWorkProof&); // for the current tip
 
 	void CommitDB();
+	uint64_t VacuumStep(uint32_t nPages); // online DB compaction step. Doesn't commit the DB, returns the number of the remaining free pages
 
 	void EnumCongestions();
 	const uint64_t* get_CachedRows(const NodeDB::StateID&, Height nCountExtra); // retval valid till next call to this func, or to EnumCongestions()
@@ -331,7 +459,11 @@ public:
 		struct MyContext
 			:public Context
 		{
-			ECC::InnerProduct::BatchContextEx<4> m_BatchCtx; // seems to be ok, for larger batches difference is marginal
+			// Large enough for the bucket multi-exponentiation to pay off (few flushes per block). Allocated on heap, the verifier threads' stacks may be small
+			typedef ECC::InnerProduct::BatchContextEx<64> BatchCtx;
+			std::unique_ptr<BatchCtx> m_pBatchCtx;
+
+			MyContext() :m_pBatchCtx(std::make_unique<BatchCtx>()) {}
 		};
 
 		MyContext m_Ctx;
@@ -348,6 +480,43 @@ public:
 
 	bool ValidateAndSummarize(TxBase::Context&, const TxBase&, TxBase::IReader&&);
 
+	// Asynchronous context-free verification of several transactions. Performed by the executor, the caller thread is not blocked.
+	// All the bulletproofs of the batch are accumulated in per-thread batch contexts, and verified by a single multi-exponentiation each. The asset and shielded windows are evaluated by the executor as well (the shielded ones are read at the start).
+	struct TxBatch
+	{
+		typedef std::shared_ptr<TxBatch> Ptr;
+
+		struct Item
+		{
+			Transaction::Ptr m_pTx;
+			Transaction::Context::Params m_Pars;
+			Transaction::Context m_Ctx;
+			volatile bool m_bAbort = false;
+			bool m_bValid = false; // context-free, not including the batch arithmetics
+			bool m_bShieldedBatched = false; // shielded inputs are verified within the batch arithmetics (valid only if the whole batch is valid)
+			uint32_t m_Done = 0; // verifiers
+
+			Item() :m_Ctx(m_Pars) {}
+		};
+
+		std::vector<Item> m_vItems; // must be set before start, and not modified until done
+		bool m_bBatchValid = false; // if false - the valid items should be re-verified, in smaller batches
+		bool m_bBatchRetry = false; // the batch arithmetics couldn't be evaluated (shielded windows rolled back meanwhile). The valid items should be re-verified as-is
+
+		TxBatch();
+		virtual ~TxBatch();
+
+		virtual void OnDone() = 0; // called from a verification thread. Should post the result to the owner thread, and call Finalize there
+
+	private:
+		friend class NodeProcessor;
+		struct Internal;
+		std::unique_ptr<Internal> m_pInternal;
+	};
+
+	void TxBatchStart(const TxBatch::Ptr&);
+	void TxBatchFinalize(TxBatch&); // should be called after OnDone, on the thread that owns the NodeProcessor
+
 	virtual Key::IPKdf* get_ViewerKey() { return nullptr; }
 	virtual const ShieldedTxo::Viewer* get_ViewerShieldedKey() { return nullptr; }
 
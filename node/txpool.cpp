@@ -67,6 +67,7 @@ void TxPool::Fluff::Delete(Element& x)
 {
 	assert(x.m_pValue);
 	x.m_pValue.reset();
+	DeleteMsg(x);
 
 	m_setThreshold.erase(ThresholdSet::s_iterator_to(x.m_Threshold));
 	m_setProfit.erase(ProfitSet::s_iterator_to(x.m_Profit));
@@ -75,6 +76,34 @@ void TxPool::Fluff::Delete(Element& x)
 	Release(x);
 }
 
+void TxPool::Fluff::OnMsgUsed(Element& x)
+{
+	if (x.m_Msg.is_linked())
+	{
+		m_lstMsg.erase(MsgList::s_iterator_to(x.m_Msg));
+		m_MsgSize -= x.m_Msg.m_Size;
+	}
+
+	x.m_Msg.m_Size = x.m_Msg.m_Value.get_Size();
+	m_MsgSize += x.m_Msg.m_Size;
+	m_lstMsg.push_front(x.m_Msg);
+
+	while ((m_MsgSize > s_MsgSizeMax) && (&m_lstMsg.back() != &x.m_Msg))
+		DeleteMsg(m_lstMsg.back().get_ParentObj());
+}
+
+void TxPool::Fluff::DeleteMsg(Element& x)
+{
+	if (!x.m_Msg.is_linked())
+		return;
+
+	m_lstMsg.erase(MsgList::s_iterator_to(x.m_Msg));
+	m_MsgSize -= x.m_Msg.m_Size;
+
+	x.m_Msg.m_Value.Reset();
+	x.m_Msg.m_Size = 0;
+}
+
 void TxPool::Fluff::Release(Element& x)
 {
 	assert(x.m_Queue.m_Refs);
@@ -17,6 +17,7 @@
 #include <boost/intrusive/set.hpp>
 #include <boost/intrusive/list.hpp>
 #include "../core/block_crypt.h"
+#include "../core/shared_msg.h"
 #include "../utility/io/timer.h"
 
 namespace beam {
@@ -71,19 +72,34 @@ struct TxPool
 				uint32_t m_Refs = 0;
 				IMPLEMENT_GET_PARENT_OBJ(Element, m_Queue)
 			} m_Queue;
+
+			struct Msg
+				:public boost::intrusive::list_base_hook<>
+			{
+				proto::SharedMsg m_Value; // NewTransaction (fluff), serialized once for all the peers that request it. Kept for the recently requested txs only
+				size_t m_Size = 0; // as accounted in the cache
+				IMPLEMENT_GET_PARENT_OBJ(Element, m_Msg)
+			} m_Msg;
 		};
 
 		typedef boost::intrusive::multiset<Element::Tx> TxSet;
 		typedef boost::intrusive::multiset<Element::Profit> ProfitSet;
 		typedef boost::intrusive::multiset<Element::Threshold> ThresholdSet;
 		typedef boost::intrusive::list<Element::Queue> Queue;
+		typedef boost::intrusive::list<Element::Msg> MsgList;
 
 		TxSet m_setTxs;
 		ProfitSet m_setProfit;
 		ThresholdSet m_setThreshold;
 		Queue m_Queue;
 
+		MsgList m_lstMsg; // the most recently used first
+		size_t m_MsgSize = 0;
+		static const size_t s_MsgSizeMax = 1024 * 1024 * 4;
+
 		Element* AddValidTx(Transaction::Ptr&&, const Transaction::Context&, const Transaction::KeyType&);
+		void OnMsgUsed(Element&); // call after it's sent. Drops the least recently used msgs beyond the limit
+		void DeleteMsg(Element&);
 		void Delete(Element&);
 		void Release(Element&);
 		void Clear();
@@ -24,6 +24,7 @@
 #include "../../utility/test_helpers.h"
 #include "../../utility/serialize.h"
 #include "../../core/unittest/mini_blockchain.h"
+#include <thread>
 
 #ifndef LOG_VERBOSE_ENABLED
     #define LOG_VERBOSE_ENABLED 0
@@ -245,6 +246,10 @@ namespace beam
 		NodeDB db;
 		db.Open(sz);
 
+		std::string sBlockStore;
+		NodeProcessor::get_BlockStorePath(sBlockStore, sz);
+		db.OpenBlockStore(sBlockStore.c_str());
+
 		NodeDB::Transaction tr(db);
 
 		const uint32_t hMax = 250;
@@ -317,15 +322,36 @@ namespace beam
 
 		ByteBuffer bbBodyP, bbBodyE;
 		db.GetStateBlock(pRows[0], &bbBodyP, &bbBodyE, nullptr);
+		verify_test(Blob(bbBodyP) == bBodyP);
+		verify_test(Blob(bbBodyE) == bBodyE);
 
-		//db.DelStateBlockPP(pRows[0]);
-		//db.GetStateBlock(pRows[0], &bbBodyP, &bbBodyE);
+		// overwrite, the previous bodies are released
+		Blob bBodyP2("another body", 12);
+		db.SetStateBlock(pRows[0], bBodyP2, bBodyE, peer);
+		db.SetStateBlock(pRows[1], bBodyP, bBodyE, peer);
 
+		tr.Commit();
+		tr.Start(db);
+		db.CleanupBlockStore();
+
+		db.GetStateBlock(pRows[0], &bbBodyP, &bbBodyE, nullptr);
+		verify_test(Blob(bbBodyP) == bBodyP2);
+		verify_test(Blob(bbBodyE) == bBodyE);
+
+		db.DelStateBlockPP(pRows[1]);
+		bbBodyP.clear();
+		db.GetStateBlock(pRows[1], &bbBodyP, &bbBodyE, nullptr);
+		verify_test(bbBodyP.empty());
+		verify_test(Blob(bbBodyE) == bBodyE);
+
+		db.DelStateBlockAll(pRows[1]);
 		db.DelStateBlockAll(pRows[0]);
 		db.GetStateBlock(pRows[0], &bbBodyP, &bbBodyE, nullptr);
 
 		tr.Commit();
 		tr.Start(db);
+		db.CleanupBlockStore();
+		verify_test(!db.get_BlockStoreLive());
 
 		verify_test(CountTips(db, false) == 1);
 		verify_test(CountTips(db, true) == 0);
@@ -434,6 +460,10 @@ namespace beam
 		tr.Commit();
 		tr.Start(db);
 
+		// the deleted states release their bodies
+		db.SetStateBlock(pRows[hMax - 1], bBodyP, bBodyE, peer);
+		verify_test(db.get_BlockStoreLive());
+
 		// Delete main branch up to this tip
 		uint64_t row = pRows[hMax-1];
 		uint32_t h = hMax;
@@ -460,6 +490,9 @@ namespace beam
 		tr.Commit();
 		tr.Start(db);
 
+		verify_test(!db.get_BlockStoreLive());
+		db.CleanupBlockStore();
+
 		for (int i = 0; i < 20; i++)
 		{
 			NodeDB::WalkerPeer::Data d;
@@ -586,6 +619,13 @@ namespace beam
 
 		db.ShieldedResize(1, nShielded);
 		db.ShieldedResize(0, 1);
+
+		// online compaction
+		verify_test(db.IsVacuumIncremental());
+		uint64_t nFreePages = db.get_FreePages();
+		verify_test(nFreePages > 16);
+		db.VacuumIncremental(16);
+		verify_test(db.get_FreePages() == nFreePages - 16);
 
 		ECC::uintBig k1 = 223U;
 		Blob val(nullptr, 0);
@@ -996,8 +1036,21 @@ namespace beam
 				const Input& inp = *block.m_vInputs[i];
 				verify_test(inp.m_Internal.m_ID && inp.m_Internal.m_Maturity);
 			}
+
+			// kernel filter must never miss
+			for (size_t i = 0; i < block.m_vKernels.size(); i++)
+				verify_test(np.m_KernelFilter.MayContain(block.m_vKernels[i]->m_Internal.m_ID));
 		}
 
+		uint32_t nFalsePositive = 0;
+		for (uint32_t i = 0; i < 1000; i++)
+		{
+			Merkle::Hash hv;
+			ECC::SetRandom(hv);
+			if (np.m_KernelFilter.MayContain(hv))
+				nFalsePositive++;
+		}
+		verify_test(nFalsePositive < 10);
 	}
 
 
@@ -1425,7 +1478,7 @@ namespace beam
 
 	const uint16_t g_Port = 25003; // don't use the default port to prevent collisions with running nodes, beacons and etc.
 
-	void TestNodeConversation()
+	void TestNodeConversation(uint32_t nIoThreads)
 	{
 		// Testing configuration: Node0 <-> Node1 <-> Client.
 
@@ -1449,6 +1502,9 @@ namespace beam
 
 		node2.m_Cfg.m_BeaconPort = g_Port;
 
+		node.m_Cfg.m_IoThreads = nIoThreads;
+		node2.m_Cfg.m_IoThreads = nIoThreads;
+
 		ECC::SetRandom(node);
 		ECC::SetRandom(node2);
 
@@ -1578,6 +1634,109 @@ namespace beam
 		DeleteFile(g_sz3);
 	}
 
+	void TestFastPeerNotChocked()
+	{
+		// Node <-> Client, on the same loop, with long iterations. The client is subscribed to the BBS channel it sends to,
+		// so that the node broadcasts the messages back to it. The node must not take it for a slow peer and chock it
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Node node;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_Listen.port(g_Port);
+		node.m_Cfg.m_Listen.ip(INADDR_ANY);
+		node.m_Cfg.m_Treasury = g_Treasury;
+
+		// a peer with a measured drain rate below 1MB/sec is chocked once it has more than 1 message unsent
+		node.m_Cfg.m_BandwidthCtl.m_ChockingMin = 1024;
+		node.m_Cfg.m_BandwidthCtl.m_ChockingDrain_ms = 1;
+
+		ECC::SetRandom(node);
+		node.Initialize();
+
+		const BbsChannel nChannel = 5;
+		const uint32_t nBatch = 10;
+		const uint32_t nTotal = nBatch * 10;
+
+		struct MyClient
+			:public proto::NodeConnection
+		{
+			uint32_t m_Sent = 0;
+			uint32_t m_Received = 0;
+			io::Timer::Ptr m_pTimer;
+
+			MyClient()
+			{
+				m_pTimer = io::Timer::create(io::Reactor::get_Current());
+			}
+
+			virtual void OnConnectedSecure() override
+			{
+				proto::BbsSubscribe msg;
+				msg.m_Channel = nChannel;
+				msg.m_On = true;
+				Send(msg);
+
+				m_pTimer->start(1, true, [this]() { OnTimer(); });
+			}
+
+			void OnTimer()
+			{
+				if (m_Sent < nTotal)
+				{
+					for (uint32_t i = 0; i < nBatch; i++)
+					{
+						proto::BbsMsg msg;
+						msg.m_Channel = nChannel;
+						msg.m_TimePosted = getTimestamp();
+						msg.m_Message.resize(1024);
+						memcpy(&msg.m_Message.front(), &m_Sent, sizeof(m_Sent)); // unique
+						Send(msg);
+
+						m_Sent++;
+					}
+				}
+
+				// stall the loop, the node is on the same thread
+				std::this_thread::sleep_for(std::chrono::milliseconds(60));
+			}
+
+			virtual void OnMsg(proto::BbsMsg&&) override
+			{
+				if (++m_Received == nTotal)
+					io::Reactor::get_Current().stop();
+			}
+
+			virtual void OnMsg(proto::Ping&& msg) override
+			{
+				fail_test("fast peer chocked");
+				NodeConnection::OnMsg(std::move(msg));
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+			}
+		};
+
+		MyClient cl;
+
+		io::Address addr;
+		addr.resolve("127.0.0.1");
+		addr.port(g_Port);
+
+		cl.Connect(addr);
+
+		io::Timer::Ptr pTimer = io::Timer::create(*pReactor);
+		pTimer->start(30 * 1000, false, []() {
+			fail_test("not all the messages received");
+			io::Reactor::get_Current().stop();
+		});
+
+		pReactor->run();
+
+		verify_test(cl.m_Received == nTotal);
+	}
+
 
 
 	void TestNodeClientProto()
@@ -1623,6 +1782,8 @@ namespace beam
 			uint32_t m_nChainWorkProofsPending = 0;
 			uint32_t m_nBbsMsgsPending = 0;
 			uint32_t m_nRecoveryPending = 0;
+			uint32_t m_nBodiesPending = 0;
+			proto::BodyBuffers m_BodyPrev;
 
 			struct
 			{
@@ -1993,6 +2154,7 @@ namespace beam
 				t.Test(IsAllProofsReceived(), "some proofs missing");
 				t.Test(IsAllBbsReceived(), "some BBS messages missing");
 				t.Test(IsAllRecoveryReceived(), "some recovery messages missing");
+				t.Test(!m_nBodiesPending, "some bodies missing");
 				t.Test(m_Assets.m_ID != 0, "CA not created");
 				t.Test(m_Assets.m_Recognized, "CA output not recognized");
 				t.Test(m_Assets.m_EvtCreated, "CA creation not recognized by node");
@@ -2021,6 +2183,13 @@ namespace beam
 					return;
 				}
 
+				// request the same body twice, the 2nd is served from the node's recent bodies
+				proto::GetBody msgBody;
+				msg.m_Description.get_ID(msgBody.m_ID);
+				Send(msgBody);
+				Send(msgBody);
+				m_nBodiesPending += 2;
+
 				if (!m_Shielded.m_Sent && SendShielded())
 					m_Shielded.m_Sent = msg.m_Description.m_Height;
 
@@ -2262,6 +2431,18 @@ namespace beam
 					msg.m_Flags |= proto::LoginFlags::MiningFinalization;
 			}
 
+			virtual void OnMsg(proto::Body&& msg) override
+			{
+				verify_test(m_nBodiesPending);
+				if (1 & m_nBodiesPending--)
+				{
+					verify_test(msg.m_Body.m_Perishable == m_BodyPrev.m_Perishable);
+					verify_test(msg.m_Body.m_Eternal == m_BodyPrev.m_Eternal);
+				}
+				else
+					m_BodyPrev = std::move(msg.m_Body);
+			}
+
 			virtual void OnMsg(proto::ProofState&& msg) override
 			{
 				if (!m_queProofsStateExpected.empty())
@@ -2581,6 +2762,9 @@ namespace beam
 
 		cl.TestAllDone(true);
 
+		const Node::RecentBodiesStats& rbs = node.get_RecentBodiesStats();
+		verify_test(rbs.m_Hits >= cl.m_HeightTrg / 2);
+
 		struct TxoRecover
 			:public NodeProcessor::ITxoRecover
 		{
@@ -2936,6 +3120,28 @@ namespace beam
 		}
 	}
 
+	void TestChockingThreshold()
+	{
+		Node::Config::BandwidthCtl bc;
+		bc.m_Chocking = 1024 * 1024;
+		bc.m_ChockingMin = 1024 * 64;
+		bc.m_ChockingDrain_ms = 3000;
+
+		// unknown (fast) drain rate - the fixed limit
+		verify_test(bc.get_ChockingThreshold(0) == bc.m_Chocking);
+
+		// proportional to the drain rate
+		verify_test(bc.get_ChockingThreshold(100 * 1024) == 300 * 1024);
+		verify_test(bc.get_ChockingThreshold(100 * 1024) < bc.get_ChockingThreshold(200 * 1024));
+
+		// clamped to the bounds
+		verify_test(bc.get_ChockingThreshold(1) == bc.m_ChockingMin);
+		verify_test(bc.get_ChockingThreshold(1024 * 1024 * 1024) == bc.m_Chocking);
+
+		bc.m_ChockingMin = bc.m_Chocking;
+		verify_test(bc.get_ChockingThreshold(1) == bc.m_Chocking);
+	}
+
 }
 
 void TestAll()
@@ -2964,6 +3170,7 @@ void TestAll()
 	{
 		beam::TestHalving();
 		beam::TestChainworkProof();
+		beam::TestChockingThreshold();
 	}
 
 	// Make sure this test doesn't run in parallel. We have the following potential collisions for Nodes:
@@ -3009,9 +3216,22 @@ void TestAll()
 		printf("NodeX2 concurrent test...\n");
 		fflush(stdout);
 
-		beam::TestNodeConversation();
+		beam::TestNodeConversation(0);
 		beam::DeleteFile(beam::g_sz);
 		beam::DeleteFile(beam::g_sz2);
+
+		printf("NodeX2 concurrent test, peers' I/O on dedicated threads...\n");
+		fflush(stdout);
+
+		beam::TestNodeConversation(2);
+		beam::DeleteFile(beam::g_sz);
+		beam::DeleteFile(beam::g_sz2);
+
+		printf("Node <---> fast client, long loop iterations...\n");
+		fflush(stdout);
+
+		beam::TestFastPeerNotChocked();
+		beam::DeleteFile(beam::g_sz);
 	}
 
 	beam::Rules::get().pForks[2].m_Height = 17;
@@ -3032,9 +3252,127 @@ void TestAll()
 		beam::NodeProcessor::get_UtxoMappingPath(sPath, beam::g_sz);
 		beam::DeleteFile(sPath.c_str());
 
+		// stream images as well (they are refilled from the DB)
+		beam::NodeProcessor::get_StreamImagePath(sPath, beam::g_sz, beam::NodeDB::StreamType::ShieldedMmr);
+		beam::DeleteFile(sPath.c_str());
+		beam::NodeProcessor::get_StreamImagePath(sPath, beam::g_sz, beam::NodeDB::StreamType::Shielded);
+		beam::DeleteFile(sPath.c_str());
+
 		beam::Node node;
 		node.m_Cfg.m_sPathLocal = beam::g_sz;
 		node.Initialize();
+
+		// snapshot of this state, and bootstrap from it
+		beam::DeleteFile(beam::g_sz2);
+		beam::DeleteFile(beam::g_sz3);
+		verify_test(node.ExportSnapshot(beam::g_sz2));
+
+		beam::NodeProcessor np;
+		np.m_Horizon = node.m_Cfg.m_Horizon;
+
+		beam::NodeProcessor::StartParams sp;
+		sp.m_sSnapshot = beam::g_sz2;
+		np.Initialize(beam::g_sz3, sp);
+
+		verify_test(np.m_Cursor.m_ID == node.get_Processor().m_Cursor.m_ID);
+		verify_test(np.m_Extra.m_Txos == node.get_Processor().m_Extra.m_Txos);
+		verify_test(np.m_Extra.m_ShieldedOutputs == node.get_Processor().m_Extra.m_ShieldedOutputs);
+		ECC::Scalar skID;
+		beam::Blob blobID(skID.m_Value);
+		verify_test(!np.get_DB().ParamGet(beam::NodeDB::ParamID::MyID, nullptr, &blobID)); // not inherited
+
+		// the data is usable: some old block can be retrieved
+		beam::NodeDB::StateID sid;
+		sid.m_Height = np.m_Cursor.m_ID.m_Height - 1;
+		sid.m_Row = np.FindActiveAtStrict(sid.m_Height);
+		beam::ByteBuffer bbE, bbP;
+		verify_test(np.GetBlock(sid, &bbE, &bbP, 0, 0, sid.m_Height, true));
+
+		// tampered snapshots are rejected. Tamper with this copy and export it again
+		std::string sPathT = std::string(beam::g_sz3) + "-t";
+
+		auto TestTampered = [&np, &sPathT]()
+		{
+			beam::DeleteFile(beam::g_sz2);
+			verify_test(np.ExportSnapshot(beam::g_sz2));
+
+			beam::DeleteFile(sPathT.c_str());
+
+			beam::NodeProcessor::StartParams sp2;
+			sp2.m_sSnapshot = beam::g_sz2;
+
+			bool bRejected = false;
+			try
+			{
+				beam::NodeProcessor np2;
+				np2.Initialize(sPathT.c_str(), sp2);
+			}
+			catch (const std::exception&)
+			{
+				bRejected = true;
+			}
+
+			verify_test(bRejected);
+		};
+
+		// UTXO leaf, its cached hashes are left as-is
+		struct Traveler
+			:public beam::RadixTree::ITraveler
+		{
+			beam::UtxoTree::MyLeaf* m_pLeaf = nullptr;
+
+			virtual bool OnLeaf(const beam::RadixTree::Leaf& x) override
+			{
+				m_pLeaf = &Cast::NotConst(Cast::Up<beam::UtxoTree::MyLeaf>(x));
+				return false; // the first one is enough
+			}
+		} t;
+
+		np.get_Utxos().Traverse(t);
+		verify_test(t.m_pLeaf);
+
+		t.m_pLeaf->m_Key.V.m_pData[10] ^= 1;
+		TestTampered();
+		t.m_pLeaf->m_Key.V.m_pData[10] ^= 1;
+
+		// shielded list element
+		verify_test(np.m_Extra.m_ShieldedOutputs);
+
+		ECC::Point::Storage pt_s;
+		np.get_DB().ShieldedRead(0, &pt_s, 1);
+		pt_s.m_X.m_pData[0] ^= 1;
+		np.get_DB().ShieldedWrite(0, &pt_s, 1);
+		TestTampered();
+
+		pt_s.m_X.m_pData[0] ^= 1;
+		np.get_DB().ShieldedWrite(0, &pt_s, 1);
+
+		// kernel filter. It's not verified but rebuilt, an empty one would hide all the kernels
+		np.m_KernelFilter.Reset(0);
+
+		beam::DeleteFile(beam::g_sz2);
+		verify_test(np.ExportSnapshot(beam::g_sz2));
+		beam::DeleteFile(sPathT.c_str());
+
+		{
+			beam::NodeProcessor::StartParams sp2;
+			sp2.m_sSnapshot = beam::g_sz2;
+
+			beam::NodeProcessor np2;
+			np2.Initialize(sPathT.c_str(), sp2);
+
+			uint64_t nKernels = 0;
+			beam::NodeDB::WalkerKernel wlk;
+			for (np2.get_DB().EnumKernels(wlk); wlk.MoveNext(); nKernels++)
+			{
+				verify_test(wlk.m_ID.n == beam::Merkle::Hash::nBytes);
+				verify_test(np2.m_KernelFilter.MayContain(*reinterpret_cast<const beam::Merkle::Hash*>(wlk.m_ID.p)));
+			}
+
+			verify_test(nKernels);
+		}
+
+		beam::DeleteFile(sPathT.c_str());
 	}
 
 	beam::DeleteFile(beam::g_sz);
@@ -13,11 +13,82 @@
 // limitations under the License.
 
 #include "msg_reader.h"
+#include "utility/config.h"
 #include <assert.h>
 #include <algorithm>
 
 namespace beam {
 
+namespace {
+
+/// Set when the thread's pool is destroyed. Trivially destructible, hence valid for the whole lifetime of the thread
+thread_local bool s_bSlabPoolDown = false;
+
+/// Buffers for the large messages, shared by all the readers of the thread (there's a reactor per thread).
+/// Keeps the released ones up to the limit, so that the multi-MB messages don't allocate and touch fresh memory each time
+class SlabPool {
+public:
+    SlabPool() :
+        _maxIdleBytes(config().get_int("io.msg_slab_pool_size", 32*1024*1024, 0, 1024*1024*1024))
+    {}
+
+    ~SlabPool() {
+        s_bSlabPoolDown = true;
+    }
+
+    void alloc(MsgReader::Slab& slab, size_t size) {
+        assert(!slab.data);
+
+        // the smallest one that fits
+        auto itBest = _idle.end();
+        for (auto it = _idle.begin(); it != _idle.end(); ++it) {
+            if ((it->capacity >= size) && ((_idle.end() == itBest) || (it->capacity < itBest->capacity))) {
+                itBest = it;
+            }
+        }
+
+        if (_idle.end() != itBest) {
+            slab = std::move(*itBest);
+            _idle.erase(itBest);
+            _idleBytes -= slab.capacity;
+        } else {
+            allocNew(slab, size);
+        }
+    }
+
+    void release(MsgReader::Slab& slab) {
+        if (_idleBytes + slab.capacity <= _maxIdleBytes) {
+            _idleBytes += slab.capacity;
+            _idle.push_back(std::move(slab));
+        }
+        discard(slab);
+    }
+
+    static void allocNew(MsgReader::Slab& slab, size_t size) {
+        slab.data.reset(new uint8_t[size]);
+        slab.capacity = size;
+    }
+
+    static void discard(MsgReader::Slab& slab) {
+        slab.data.reset();
+        slab.capacity = 0;
+    }
+
+private:
+    std::vector<MsgReader::Slab> _idle;
+    size_t _idleBytes=0;
+    const size_t _maxIdleBytes;
+};
+
+thread_local SlabPool s_SlabPool;
+
+/// nullptr during the thread teardown, after the pool is destroyed (readers may outlive it)
+SlabPool* get_SlabPool() {
+    return s_bSlabPoolDown ? nullptr : &s_SlabPool;
+}
+
+} // namespace
+
 MsgReader::MsgReader(ProtocolBase& protocol, uint64_t streamId, size_t defaultSize) :
     _protocol(protocol),
     _streamId(streamId),
@@ -30,7 +101,7 @@ MsgReader::MsgReader(ProtocolBase& protocol, uint64_t streamId, size_t defaultSi
 
     assert(_defaultSize >= MsgHeader::SIZE);
     _msgBuffer.resize(_defaultSize);
-    _cursor = _msgBuffer.data();
+    _msg = _cursor = _msgBuffer.data();
 
     // by default, all message types are allowed
     enable_all_msg_types();
@@ -40,12 +111,41 @@ MsgReader::~MsgReader()
 {
 	if (_pAlive)
 		*_pAlive = false;
+
+    release_slab();
 }
 
 void MsgReader::reset() {
     _bytesLeft = MsgHeader::SIZE;
     _state = reading_header;
-    _cursor = _msgBuffer.data();
+    release_slab();
+    _msg = _cursor = _msgBuffer.data();
+}
+
+void MsgReader::release_slab() {
+    if (_slab.data) {
+        SlabPool* pPool = get_SlabPool();
+        if (pPool) {
+            pPool->release(_slab);
+        } else {
+            SlabPool::discard(_slab);
+        }
+    }
+}
+
+void MsgReader::pause() {
+    _paused = true;
+}
+
+bool MsgReader::resume() {
+    if (!_paused) return true;
+    _paused = false;
+
+    if (_pending.empty()) return true;
+
+    std::vector<uint8_t> data;
+    data.swap(_pending);
+    return new_data_from_stream(io::EC_OK, data.data(), data.size());
 }
 
 void MsgReader::change_id(uint64_t newStreamId) {
@@ -68,7 +168,7 @@ void MsgReader::disable_all_msg_types() {
     _expectedMsgTypes.reset();
 }
 
-bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void* data, size_t size) {
+bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, void* data, size_t size) {
     if (connectionStatus != 0) {
         _protocol.on_connection_error(_streamId, connectionStatus);
         return false;
@@ -78,21 +178,31 @@ bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void*
         return true;
     }
 
+    if (_paused) {
+        _pending.insert(_pending.end(), (const uint8_t*) data, (const uint8_t*) data + size);
+        return true;
+    }
+
 	std::shared_ptr<bool> pAlive(_pAlive);
 	volatile const bool& bAlive = *pAlive;
 
-    const uint8_t* p = (const uint8_t*)data;
+    uint8_t* p = (uint8_t*)data;
     size_t sz = size;
 
 	while (sz >= _bytesLeft)
 	{
-		memcpy(_cursor, p, _bytesLeft);
-		_protocol.Decrypt(_cursor, (uint32_t) _bytesLeft); // decrypt as much as we expect, no more (because cipher may change)
+		_protocol.Decrypt(p, (uint32_t) _bytesLeft); // decrypt as much as we expect, no more (because cipher may change)
+
+		// nothing accumulated yet - use the data in place
+		bool bInPlace = (_cursor == _msg);
+		const uint8_t* pMsg = bInPlace ? p : _msg;
+		if (!bInPlace)
+			memcpy(_cursor, p, _bytesLeft);
 
 		sz -= _bytesLeft;
 		p += _bytesLeft;
 
-		MsgHeader header(_msgBuffer.data());
+		MsgHeader header(pMsg);
 
 		if (_state == reading_header)
 		{
@@ -114,52 +224,68 @@ bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void*
 				return false;
 
 			// header deserialized successfully
-			_bytesLeft = header.size;
-			_msgBuffer.resize(MsgHeader::SIZE + _bytesLeft);
-			_cursor = _msgBuffer.data() + MsgHeader::SIZE;
+			if (bInPlace && (sz >= header.size))
+			{
+				// the whole message is here, no need to assemble it
+				_protocol.Decrypt(p, header.size);
+
+				sz -= header.size;
+				p += header.size;
+
+				if (!dispatch(pMsg, header, bAlive))
+					return false;
+			}
+			else
+			{
+				uint8_t pHdr[MsgHeader::SIZE];
+				memcpy(pHdr, pMsg, MsgHeader::SIZE);
+
+				size_t nTotal = MsgHeader::SIZE + header.size;
+				if (nTotal > _msgBuffer.size())
+				{
+					if (nTotal <= 2 * _defaultSize)
+						_msgBuffer.resize(nTotal);
+					else
+					{
+						SlabPool* pPool = get_SlabPool();
+						if (pPool)
+							pPool->alloc(_slab, nTotal);
+						else
+							SlabPool::allocNew(_slab, nTotal);
+					}
+				}
 
-			_state = reading_message;
+				_msg = _slab.data ? _slab.data.get() : _msgBuffer.data();
+				memcpy(_msg, pHdr, MsgHeader::SIZE);
 
+				_bytesLeft = header.size;
+				_cursor = _msg + MsgHeader::SIZE;
+
+				_state = reading_message;
+				continue;
+			}
 		}
 		else
 		{
 			// whole message has been read
-			if (!_protocol.VerifyMsg(_msgBuffer.data(), static_cast<uint32_t>(_msgBuffer.size())))
-			{
-				_protocol.on_corrupt_msg(_streamId);
-				return false;
-			}
-
-            if (!_protocol.on_new_message(_streamId, header.type, _msgBuffer.data() + MsgHeader::SIZE, header.size - _protocol.get_MacSize())) {
-                // at this moment, the *this* may be deleted
-                if (bAlive) {
-                    reset();
-                }
-                return false;
-            }
-
-			if (!bAlive)
+			if (!dispatch(pMsg, header, bAlive))
 				return false;
+		}
 
-			if (_msgBuffer.size() > 2 * _defaultSize) {
-				{
-					std::vector<uint8_t> newBuffer;
-					_msgBuffer.swap(newBuffer);
-				}
-				// preventing from excessive memory consumption per individual stream
-				_msgBuffer.resize(_defaultSize);
-			}
-			_bytesLeft = MsgHeader::SIZE;
-			_state = reading_header;
+		reset();
 
-			_cursor = _msgBuffer.data();
+		if (_paused)
+		{
+			// the rest must not be decrypted yet (the cipher may change)
+			_pending.assign(p, p + sz);
+			return true;
 		}
 	}
 
 	if (sz)
 	{
+		_protocol.Decrypt(p, (uint32_t) sz);
 		memcpy(_cursor, p, sz);
-		_protocol.Decrypt(_cursor, (uint32_t) sz);
 
 		_cursor += sz;
 		_bytesLeft -= sz;
@@ -168,5 +294,23 @@ bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void*
 	return true;
 }
 
+bool MsgReader::dispatch(const uint8_t* msg, const MsgHeader& header, volatile const bool& bAlive) {
+    if (!_protocol.VerifyMsg(msg, MsgHeader::SIZE + header.size))
+    {
+        _protocol.on_corrupt_msg(_streamId);
+        return false;
+    }
+
+    if (!_protocol.on_new_message(_streamId, header.type, msg + MsgHeader::SIZE, header.size - _protocol.get_MacSize())) {
+        // at this moment, the *this* may be deleted
+        if (bAlive) {
+            reset();
+        }
+        return false;
+    }
+
+    return bAlive;
+}
+
 
 } //namespace
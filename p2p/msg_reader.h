@@ -16,6 +16,7 @@
 #include "protocol_base.h"
 #include <vector>
 #include <bitset>
+#include <memory>
 
 namespace beam {
 
@@ -30,8 +31,9 @@ public:
     void change_id(uint64_t newStreamId);
 
     /// Called from the stream on new data.
-    /// Calls the callback whenever a new protocol message is exctracted or on errors
-    bool new_data_from_stream(io::ErrorCode connectionStatus, const void* data, size_t size);
+    /// Calls the callback whenever a new protocol message is exctracted or on errors.
+    /// The data is decrypted in place, messages that are entirely in it are dispatched without copying
+    bool new_data_from_stream(io::ErrorCode connectionStatus, void* data, size_t size);
 
     /// Allows receiving messages of given type
     void enable_msg_type(MsgType type);
@@ -48,10 +50,31 @@ public:
     /// Resets to initial state
     void reset();
 
+    /// Stops extracting messages, the incoming data is retained until resume().
+    /// May be called from the message callback, then the rest of the current data isn't decrypted/parsed.
+    void pause();
+
+    /// Processes the retained data, returns the same as new_data_from_stream()
+    bool resume();
+
+    bool is_paused() const { return _paused; }
+
+    /// Buffer for a large message. Not value-initialized, it's overwritten by the received data anyway
+    struct Slab {
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity=0;
+    };
+
 private:
     /// 2 states of the reader
     enum State { reading_header, reading_message };
 
+    /// Verifies and dispatches the complete message (header, body, MAC)
+    bool dispatch(const uint8_t* msg, const MsgHeader& header, volatile const bool& bAlive);
+
+    /// Returns the large message buffer to the pool
+    void release_slab();
+
     /// Callbacks
     ProtocolBase& _protocol;
 
@@ -67,9 +90,15 @@ private:
     /// Current state
     State _state;
 
-    /// Message buffer, grows if needed
+    /// Buffer for messages that span several reads, grows up to 2 * _defaultSize
     std::vector<uint8_t> _msgBuffer;
 
+    /// Larger messages are assembled in a buffer from the per-thread pool
+    Slab _slab;
+
+    /// Start of the message being assembled (either in _msgBuffer or in _slab)
+    uint8_t* _msg;
+
     /// Cursor inside the buffer
     uint8_t* _cursor;
 
@@ -77,6 +106,10 @@ private:
     std::bitset<256> _expectedMsgTypes;
 
 	std::shared_ptr<bool> _pAlive;
+
+    /// Raw data received while paused
+    std::vector<uint8_t> _pending;
+    bool _paused=false;
 };
 
 } //namespace
@@ -17,6 +17,7 @@
 #include "p2p/protocol.h"
 #include "utility/helpers.h"
 #include <iostream>
+#include <algorithm>
 #include <assert.h>
 
 using namespace beam;
@@ -83,11 +84,13 @@ struct MsgHandler : IErrorHandler {
     bool on_some_object(uint64_t fromStream, SomeObject&& msg) {
         cout << __FUNCTION__ << "(" << fromStream << "," << msg.i << ")" << endl;
         receivedObj = msg;
+        receivedObjs.push_back(msg);
         return true;
     }
 
     IntList receivedInts;
     SomeObject receivedObj;
+    std::vector<SomeObject> receivedObjs;
 };
 
 void msg_serializer_test_1() {
@@ -177,14 +180,54 @@ void msg_serializer_test_2() {
     );
 
     for (const auto& f: fragments) {
-        reader.new_data_from_stream(io::EC_OK, f.data, f.size);
+        // the reader decrypts in place
+        std::vector<uint8_t> data(f.data, f.data + f.size);
+        reader.new_data_from_stream(io::EC_OK, data.data(), data.size());
     }
 
     assert(msg == handler.receivedObj);
 }
 
+void msg_reader_test() {
+    MsgType type = 222;
+
+    MsgHandler handler;
+    Protocol protocol(0xAA, 0xBB, 0xCC, 256, handler, 50);
+
+    protocol.add_message_handler<MsgHandler, SomeObject, &MsgHandler::on_some_object>(type, &handler, 8, 1<<24);
+
+    // small and large messages back to back. Those that are entirely in the received data are dispatched in place, others are assembled
+    std::vector<SomeObject> msgs(5);
+    std::vector<uint8_t> stream;
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        SomeObject& msg = msgs[i];
+        msg.i = (int) i;
+        for (int j = 0; j < ((i & 1) ? 20000 : 10); ++j) msg.ooo.push_back(j);
+
+        std::vector<io::SharedBuffer> fragments;
+        protocol.serialize(fragments, type, msg);
+        for (const auto& f: fragments) {
+            stream.insert(stream.end(), f.data, f.data + f.size);
+        }
+    }
+
+    for (size_t chunk : { stream.size(), size_t(100000), size_t(1000), size_t(7) }) {
+        handler.receivedObjs.clear();
+
+        MsgReader reader(protocol, 123456, 64);
+        std::vector<uint8_t> data(stream);
+
+        for (size_t pos = 0; pos < data.size(); pos += chunk) {
+            reader.new_data_from_stream(io::EC_OK, data.data() + pos, std::min(chunk, data.size() - pos));
+        }
+
+        assert(handler.receivedObjs == msgs);
+    }
+}
+
 int main() {
     fragment_writer_test();
     msg_serializer_test_1();
     msg_serializer_test_2();
+    msg_reader_test();
 }
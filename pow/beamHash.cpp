@@ -20,6 +20,16 @@
 #include "utility/logger.h"
 #include <mutex>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#	define BEAMHASH_LANES_X86
+#	ifdef _MSC_VER
+#		define BEAMHASH_TARGET_AVX2
+#	else
+#		define BEAMHASH_TARGET_AVX2 __attribute__((target("avx2")))
+#	endif
+#	include <immintrin.h>
+#endif
+
 namespace beam
 {
 
@@ -98,13 +108,279 @@ bool Block::PoW::Solve(const void* pInput, uint32_t nSizeInput, Height h, const
 
 bool Block::PoW::IsValid(const void* pInput, uint32_t nSizeInput, Height h) const
 {
-	Helper hlp;
-	hlp.Reset(pInput, nSizeInput, m_Nonce, h);
+	BatchItem x;
+	x.m_pPoW = this;
+	x.m_pInput = pInput;
+	x.m_nSizeInput = nSizeInput;
+	x.m_Height = h;
+
+	return IsValidBatch(&x, 1);
+}
+
+/////////////////////
+// Batch verification.
+// The hash of each solution index is GenerateHash() of its group, which is a sum of up to 16 blake2b hashes of the base state + 4-byte group index.
+// Those are all single-block compressions, independent of each other. They are collected for several headers, and computed in 4 AVX2 lanes.
+namespace BeamHashLanes
+{
+	typedef EquihashR<Block::PoW::N, Block::PoW::K, 0> Scheme; // the sizes don't depend on R
+
+	const uint64_t s_pIV[8] = {
+		0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+		0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+	};
+
+	const uint8_t s_pSigma[12][16] = {
+		{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+		{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+		{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+		{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+		{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+		{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+		{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+		{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+		{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+		{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+		{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+		{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+	};
+
+	struct Job
+	{
+		const uint64_t* m_pH; // base state
+		const uint8_t* m_pBlock; // message template, the index is appended at m_nSize - 4
+		uint32_t m_nSize;
+		uint32_t m_Index;
+		uint32_t* m_pSum;
+	};
+
+#ifdef BEAMHASH_LANES_X86
+
+	bool IsSupported()
+	{
+		return ECC::Hash::Processor::IsSimdSupported(); // AVX2, and the OS saves ymm
+	}
+
+	// rotations by 32, 24, 16 are byte shuffles
+#	define BEAMHASH_ROTR32(x) _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#	define BEAMHASH_ROTR24(x) _mm256_shuffle_epi8(x, r24)
+#	define BEAMHASH_ROTR16(x) _mm256_shuffle_epi8(x, r16)
+#	define BEAMHASH_ROTR63(x) _mm256_xor_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x))
+
+#	define BEAMHASH_G(a, b, c, d, x, y) \
+		a = _mm256_add_epi64(_mm256_add_epi64(a, b), x); \
+		d = BEAMHASH_ROTR32(_mm256_xor_si256(d, a)); \
+		c = _mm256_add_epi64(c, d); \
+		b = BEAMHASH_ROTR24(_mm256_xor_si256(b, c)); \
+		a = _mm256_add_epi64(_mm256_add_epi64(a, b), y); \
+		d = BEAMHASH_ROTR16(_mm256_xor_si256(d, a)); \
+		c = _mm256_add_epi64(c, d); \
+		b = BEAMHASH_ROTR63(_mm256_xor_si256(b, c));
+
+	BEAMHASH_TARGET_AVX2 void Compress4(const Job* pJob)
+	{
+		const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+		const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+
+		uint64_t ppBlock[4][16];
+		for (uint32_t iLane = 0; iLane < 4; iLane++)
+		{
+			const Job& j = pJob[iLane];
+			memcpy(ppBlock[iLane], j.m_pBlock, sizeof(ppBlock[iLane]));
+			memcpy(reinterpret_cast<uint8_t*>(ppBlock[iLane]) + j.m_nSize - sizeof(j.m_Index), &j.m_Index, sizeof(j.m_Index)); // little-endian
+		}
+
+		__m256i pM[16], pV[16];
+		for (uint32_t i = 0; i < 16; i++)
+			pM[i] = _mm256_set_epi64x(ppBlock[3][i], ppBlock[2][i], ppBlock[1][i], ppBlock[0][i]);
+
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			pV[i] = _mm256_set_epi64x(pJob[3].m_pH[i], pJob[2].m_pH[i], pJob[1].m_pH[i], pJob[0].m_pH[i]);
+			pV[i + 8] = _mm256_set1_epi64x(s_pIV[i]);
+		}
+
+		// counter (single block), last block flag
+		pV[12] = _mm256_xor_si256(pV[12], _mm256_set_epi64x(pJob[3].m_nSize, pJob[2].m_nSize, pJob[1].m_nSize, pJob[0].m_nSize));
+		pV[14] = _mm256_xor_si256(pV[14], _mm256_set1_epi64x(-1));
+
+		for (uint32_t iRound = 0; iRound < 12; iRound++)
+		{
+			const uint8_t* s = s_pSigma[iRound];
+
+			BEAMHASH_G(pV[0], pV[4], pV[8], pV[12], pM[s[0]], pM[s[1]])
+			BEAMHASH_G(pV[1], pV[5], pV[9], pV[13], pM[s[2]], pM[s[3]])
+			BEAMHASH_G(pV[2], pV[6], pV[10], pV[14], pM[s[4]], pM[s[5]])
+			BEAMHASH_G(pV[3], pV[7], pV[11], pV[15], pM[s[6]], pM[s[7]])
+
+			BEAMHASH_G(pV[0], pV[5], pV[10], pV[15], pM[s[8]], pM[s[9]])
+			BEAMHASH_G(pV[1], pV[6], pV[11], pV[12], pM[s[10]], pM[s[11]])
+			BEAMHASH_G(pV[2], pV[7], pV[8], pV[13], pM[s[12]], pM[s[13]])
+			BEAMHASH_G(pV[3], pV[4], pV[9], pV[14], pM[s[14]], pM[s[15]])
+		}
+
+		alignas(32) uint64_t ppRes[8][4];
+		for (uint32_t i = 0; i < 8; i++)
+			_mm256_store_si256((__m256i*) ppRes[i], _mm256_xor_si256(pV[i], pV[i + 8]));
+
+		for (uint32_t iLane = 0; iLane < 4; iLane++)
+		{
+			const Job& j = pJob[iLane];
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				uint64_t val = ppRes[i][iLane] ^ j.m_pH[i];
+				j.m_pSum[i * 2] += static_cast<uint32_t>(val);
+				j.m_pSum[i * 2 + 1] += static_cast<uint32_t>(val >> 32);
+			}
+		}
+	}
+
+#	undef BEAMHASH_G
+#	undef BEAMHASH_ROTR32
+#	undef BEAMHASH_ROTR24
+#	undef BEAMHASH_ROTR16
+#	undef BEAMHASH_ROTR63
+
+#else // BEAMHASH_LANES_X86
+
+	bool IsSupported() { return false; }
+	void Compress4(const Job*) {}
+
+#endif // BEAMHASH_LANES_X86
+
+} // namespace BeamHashLanes
+
+bool Block::PoW::s_UseSimd = BeamHashLanes::IsSupported();
+
+struct Block::PoW::BatchVerifier
+{
+	static const uint32_t s_nMaxHdrs = 4;
+	static const uint32_t s_nHashOutput = BeamHashLanes::Scheme::HashOutput;
+	static const uint32_t s_nPerGroup = BeamHashLanes::Scheme::IndicesPerHashOutput;
+
+	struct Hdr
+	{
+		Helper m_Hlp;
+		PoWScheme* m_pScheme;
+		eh_index m_pIndices[nNumIndices];
+		uint8_t m_pHashes[nNumIndices * s_nHashOutput];
+		uint32_t m_ppSum[nNumIndices][16];
+		uint64_t m_pBlock[16]; // input | nonce | index, zero-padded
+		uint32_t m_nSize;
+	};
+
+	Hdr m_pHdrs[s_nMaxHdrs];
+	std::vector<BeamHashLanes::Job> m_vJobs;
+
+	bool IsValid(const BatchItem*, uint32_t nCount);
+};
+
+bool Block::PoW::BatchVerifier::IsValid(const BatchItem* pItems, uint32_t nCount)
+{
+	assert(nCount <= s_nMaxHdrs);
+	m_vJobs.clear();
+
+	for (uint32_t iHdr = 0; iHdr < nCount; iHdr++)
+	{
+		const BatchItem& x = pItems[iHdr];
+		const PoW& pow = *x.m_pPoW;
+		Hdr& hdr = m_pHdrs[iHdr];
+
+		if (!hdr.m_Hlp.TestDifficulty(&pow.m_Indices.front(), (uint32_t) pow.m_Indices.size(), pow.m_Difficulty))
+			return false;
+
+		hdr.m_pScheme = hdr.m_Hlp.getCurrentPoW(x.m_Height);
+		if (!hdr.m_pScheme->DecodeIndices(&pow.m_Indices.front(), pow.m_Indices.size(), hdr.m_pIndices))
+			return false;
+
+		hdr.m_Hlp.Reset(x.m_pInput, x.m_nSizeInput, pow.m_Nonce, x.m_Height);
+
+		// The lanes start from the initial state (the input is not compressed yet), and hash a single block
+		hdr.m_nSize = x.m_nSizeInput + pow.m_Nonce.nBytes + sizeof(eh_index);
+		if (!s_UseSimd || (hdr.m_nSize > sizeof(hdr.m_pBlock)))
+		{
+			// unused bits are cleared in IsValidCollisions wrt the scheme
+			for (uint32_t i = 0; i < nNumIndices; i++)
+				GenerateHash(hdr.m_Hlp.m_Blake, hdr.m_pIndices[i] / s_nPerGroup, hdr.m_pHashes + i * s_nHashOutput, s_nHashOutput, N, 0);
+
+			continue;
+		}
+
+		ZeroObject(hdr.m_pBlock);
+		uint8_t* pBlock = reinterpret_cast<uint8_t*>(hdr.m_pBlock);
+		memcpy(pBlock, x.m_pInput, x.m_nSizeInput);
+		memcpy(pBlock + x.m_nSizeInput, pow.m_Nonce.m_pData, pow.m_Nonce.nBytes);
+
+		ZeroObject(hdr.m_ppSum);
+
+		for (uint32_t i = 0; i < nNumIndices; i++)
+		{
+			uint32_t g = hdr.m_pIndices[i] / s_nPerGroup;
+			for (uint32_t g2 = g & ~0xfU; g2 <= g; g2++)
+			{
+				m_vJobs.emplace_back();
+				BeamHashLanes::Job& j = m_vJobs.back();
+				j.m_pH = hdr.m_Hlp.m_Blake.h;
+				j.m_pBlock = pBlock;
+				j.m_nSize = hdr.m_nSize;
+				j.m_Index = g2;
+				j.m_pSum = hdr.m_ppSum[i];
+			}
+		}
+	}
+
+	if (!m_vJobs.empty())
+	{
+		// pad to the lanes count, the dummy results are discarded
+		uint32_t nJobs = static_cast<uint32_t>(m_vJobs.size());
+		uint32_t pDummy[16];
+		for (; m_vJobs.size() & 3; )
+		{
+			m_vJobs.push_back(m_vJobs.front());
+			m_vJobs.back().m_pSum = pDummy;
+		}
+
+		for (size_t i = 0; i < m_vJobs.size(); i += 4)
+			BeamHashLanes::Compress4(&m_vJobs[i]);
+
+		for (uint32_t iHdr = 0; iHdr < nCount; iHdr++)
+		{
+			Hdr& hdr = m_pHdrs[iHdr];
+			if (hdr.m_nSize > sizeof(hdr.m_pBlock) || !s_UseSimd)
+				continue;
+
+			for (uint32_t i = 0; i < nNumIndices; i++)
+				memcpy(hdr.m_pHashes + i * s_nHashOutput, hdr.m_ppSum[i], s_nHashOutput); // little-endian
+		}
+
+		m_vJobs.resize(nJobs);
+	}
+
+	for (uint32_t iHdr = 0; iHdr < nCount; iHdr++)
+	{
+		Hdr& hdr = m_pHdrs[iHdr];
+		if (!hdr.m_pScheme->IsValidCollisions(hdr.m_pIndices, hdr.m_pHashes))
+			return false;
+	}
+
+	return true;
+}
+
+bool Block::PoW::IsValidBatch(const BatchItem* pItems, uint32_t nCount)
+{
+	std::unique_ptr<BatchVerifier> pBv = std::make_unique<BatchVerifier>();
+
+	while (nCount)
+	{
+		uint32_t n = std::min(nCount, BatchVerifier::s_nMaxHdrs);
+		if (!pBv->IsValid(pItems, n))
+			return false;
+
+		pItems += n;
+		nCount -= n;
+	}
 
-	std::vector<uint8_t> v(m_Indices.begin(), m_Indices.end());
-    return
-		hlp.getCurrentPoW(h)->IsValidSolution(hlp.m_Blake, v) &&
-		hlp.TestDifficulty(&m_Indices.front(), (uint32_t) m_Indices.size(), m_Difficulty);
+	return true;
 }
 
 } // namespace beam
@@ -89,9 +89,67 @@ void TestArrayExpanding()
     TestArrayExpanding(96, 5);
 }
 
+void TestBeamHashVerify()
+{
+    cout << "Test BeamHash verification...\n";
+
+    // a solution for BeamHashII, found by Block::PoW::Solve
+    static const uint8_t pSolution[] = {
+        0x00, 0x6b, 0xb1, 0x03, 0x2b, 0x2c, 0xf0, 0xa4, 0x1e, 0x94, 0x56, 0x07, 0xfb, 0x02, 0x43, 0x03, 0x86, 0x25, 0xf1, 0xc1, 0x56, 0xc3, 0xbc, 0x78, 0x2b, 0xe2,
+        0x08, 0x7a, 0x63, 0xc5, 0x5e, 0x1c, 0x70, 0xaa, 0xc5, 0x14, 0x68, 0x4a, 0xdb, 0x0d, 0xa6, 0x23, 0xc7, 0xff, 0xc6, 0xd1, 0x57, 0xae, 0x84, 0x62, 0x70, 0xfd,
+        0x02, 0xf0, 0xc6, 0x82, 0xac, 0xaf, 0x11, 0x56, 0xe6, 0xe4, 0x63, 0xaf, 0x98, 0x13, 0x11, 0x04, 0xc6, 0xf8, 0x70, 0x21, 0x9d, 0xf8, 0xfc, 0x68, 0xd5, 0x5a,
+        0x05, 0xb5, 0xfa, 0x02, 0x5e, 0xb1, 0xc1, 0x33, 0xc1, 0x18, 0x73, 0xdb, 0x59, 0x10, 0x45, 0x40, 0x86, 0x54, 0x84, 0x91, 0x2f, 0x53, 0xf8, 0x59, 0xea, 0xc9
+    };
+
+    beam::Merkle::Hash hv;
+    ECC::Hash::Processor() << "beamhash-test" << 1U >> hv;
+
+    beam::Block::PoW pow;
+    static_assert(sizeof(pSolution) == sizeof(pow.m_Indices));
+    memcpy(&pow.m_Indices.front(), pSolution, sizeof(pSolution));
+    pow.m_Nonce = 1U;
+    pow.m_Difficulty.m_Packed = 0;
+
+    const beam::Height h = beam::Rules::get().pForks[1].m_Height;
+    const bool bSimd0 = beam::Block::PoW::s_UseSimd;
+
+    for (int iSimd = 0; iSimd < 2; iSimd++)
+    {
+        beam::Block::PoW::s_UseSimd = iSimd && bSimd0;
+
+        WALLET_CHECK(pow.IsValid(hv.m_pData, hv.nBytes, h));
+        WALLET_CHECK(!pow.IsValid(hv.m_pData, hv.nBytes, 0)); // BeamHashI
+        WALLET_CHECK(!pow.IsValid(hv.m_pData, hv.nBytes - 1, h));
+
+        // batch, more than verified at once. Must fail if any is invalid
+        beam::Block::PoW pPow[11];
+        beam::Block::PoW::BatchItem pItems[_countof(pPow)];
+        for (size_t i = 0; i < _countof(pPow); i++)
+        {
+            pPow[i] = pow;
+            pItems[i].m_pPoW = pPow + i;
+            pItems[i].m_pInput = hv.m_pData;
+            pItems[i].m_nSizeInput = hv.nBytes;
+            pItems[i].m_Height = h;
+        }
+
+        WALLET_CHECK(beam::Block::PoW::IsValidBatch(pItems, _countof(pItems)));
+
+        pPow[9].m_Nonce.Inc();
+        WALLET_CHECK(!beam::Block::PoW::IsValidBatch(pItems, _countof(pItems)));
+        pPow[9] = pow;
+
+        pPow[2].m_Indices[50] ^= 0x10;
+        WALLET_CHECK(!beam::Block::PoW::IsValidBatch(pItems, _countof(pItems)));
+    }
+
+    beam::Block::PoW::s_UseSimd = bSimd0;
+}
+
 int main()
 {
     TestArrayExpanding();
+    TestBeamHashVerify();
     
     // commented since it doesn't complete in 10 minutes and failes auto tests
 /*
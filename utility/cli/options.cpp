@@ -136,6 +136,7 @@ namespace beam
         const char* WALLET_STORAGE = "wallet_path";
         const char* MINING_THREADS = "mining_threads";
         const char* VERIFICATION_THREADS = "verification_threads";
+        const char* IO_THREADS = "io_threads";
         const char* NONCEPREFIX_DIGITS = "nonceprefix_digits";
         const char* NODE_PEER = "peer";
         const char* PASS = "pass";
@@ -165,6 +166,9 @@ namespace beam
         const char* PRINT_TXO = "print_txo";
         const char* CHECKDB = "check_db";
         const char* VACUUM = "vacuum";
+        const char* UTXO_HUGE_PAGES = "utxo_huge_pages";
+        const char* UTXO_PREFAULT = "utxo_prefault";
+        const char* VACUUM_ONLINE_PAGES = "vacuum_online_pages";
         const char* CRASH = "crash";
         const char* INIT = "init";
         const char* RESTORE = "restore";
@@ -218,6 +222,8 @@ namespace beam
         const char* GENERATE_RECOVERY_PATH = "generate_recovery";
         const char* RECOVERY_AUTO_PATH = "recovery_auto_path";
         const char* RECOVERY_AUTO_PERIOD = "recovery_auto_period";
+        const char* SNAPSHOT_EXPORT_PATH = "snapshot_export";
+        const char* SNAPSHOT_IMPORT_PATH = "snapshot_import";
         const char* SWAP_INIT = "swap_init";
         const char* SWAP_ACCEPT = "swap_accept";
         const char* SWAP_TOKEN = "swap_token";
@@ -327,6 +333,7 @@ namespace beam
             (cli::MINING_THREADS, po::value<uint32_t>()->default_value(0), "number of mining threads(there is no mining if 0)")
 
             (cli::VERIFICATION_THREADS, po::value<int>()->default_value(-1), "number of threads for cryptographic verifications (0 = single thread, -1 = auto)")
+            (cli::IO_THREADS, po::value<uint32_t>()->default_value(0), "number of threads for the peers network I/O (0 = on the node thread)")
             (cli::NONCEPREFIX_DIGITS, po::value<unsigned>()->default_value(0), "number of hex digits for nonce prefix for stratum client (0..6)")
             (cli::NODE_PEER, po::value<vector<string>>()->multitoken(), "nodes to connect to")
             (cli::STRATUM_PORT, po::value<uint16_t>()->default_value(0), "port to start stratum server on")
@@ -336,7 +343,10 @@ namespace beam
             (cli::ERASE_ID, po::value<bool>()->default_value(false), "Reset self ID (used for network authentication) and stop before re-creating the new one.")
             (cli::PRINT_TXO, po::value<bool>()->default_value(false), "Print TXO movements (create/spend) recognized by the owner key.")
             (cli::CHECKDB, po::value<bool>()->default_value(false), "DB integrity check")
-            (cli::VACUUM, po::value<bool>()->default_value(false), "DB vacuum (compact)")
+            (cli::VACUUM, po::value<bool>()->default_value(false), "DB vacuum (compact), also compacts the UTXO image")
+            (cli::VACUUM_ONLINE_PAGES, po::value<uint32_t>()->default_value(256), "Online DB compaction: max pages released per step (0 = disabled)")
+            (cli::UTXO_HUGE_PAGES, po::value<bool>()->default_value(false), "Advise the OS to back the UTXO image by huge pages (where supported)")
+            (cli::UTXO_PREFAULT, po::value<bool>()->default_value(false), "Prefault the whole UTXO image into memory")
             (cli::BBS_ENABLE, po::value<bool>()->default_value(true), "Enable SBBS messaging")
             (cli::CRASH, po::value<int>()->default_value(0), "Induce crash (test proper handling)")
             (cli::OWNER_KEY, po::value<string>(), "Owner viewer key")
@@ -349,6 +359,8 @@ namespace beam
 			(cli::GENERATE_RECOVERY_PATH, po::value<string>(), "Recovery file to generate immediately after start")
 			(cli::RECOVERY_AUTO_PATH, po::value<string>(), "path and file prefix for recovery auto-generation")
 			(cli::RECOVERY_AUTO_PERIOD, po::value<uint32_t>()->default_value(30), "period (in blocks) for recovery auto-generation")
+			(cli::SNAPSHOT_EXPORT_PATH, po::value<string>(), "Snapshot (DB path, the rest is written next to it) to export immediately after start")
+			(cli::SNAPSHOT_IMPORT_PATH, po::value<string>(), "Snapshot (DB path) to bootstrap from, if there's no local data yet")
             ;
 
         po::options_description node_treasury_options("Node treasury options");
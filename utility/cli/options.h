@@ -35,6 +35,7 @@ namespace beam
         extern const char* WALLET_STORAGE;
         extern const char* MINING_THREADS;
         extern const char* VERIFICATION_THREADS;
+        extern const char* IO_THREADS;
         extern const char* NONCEPREFIX_DIGITS;
         extern const char* NODE_PEER;
         extern const char* PASS;
@@ -66,6 +67,9 @@ namespace beam
         extern const char* PRINT_TXO;
         extern const char* CHECKDB;
         extern const char* VACUUM;
+        extern const char* UTXO_HUGE_PAGES;
+        extern const char* UTXO_PREFAULT;
+        extern const char* VACUUM_ONLINE_PAGES;
         extern const char* CRASH;
         extern const char* INIT;
         extern const char* RESTORE;
@@ -121,6 +125,8 @@ namespace beam
 		extern const char* GENERATE_RECOVERY_PATH;
 		extern const char* RECOVERY_AUTO_PATH;
 		extern const char* RECOVERY_AUTO_PERIOD;
+		extern const char* SNAPSHOT_EXPORT_PATH;
+		extern const char* SNAPSHOT_IMPORT_PATH;
         extern const char* SWAP_INIT;
         extern const char* SWAP_ACCEPT;
         extern const char* SWAP_TOKEN;
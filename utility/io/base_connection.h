@@ -59,6 +59,10 @@ public:
 		return _stream->state().unsent;
 	}
 
+	uint64_t get_DrainRate() const {
+		return _stream->state().drainRate;
+	}
+
 protected:
     /// Ctor. Attaches connected tcp stream
     BaseConnection(Direction d, io::TcpStream::Ptr&& stream) :
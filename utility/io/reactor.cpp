@@ -23,6 +23,7 @@
 
 #ifndef WIN32
 #include <signal.h>
+#include <unistd.h>
 #endif // WIN32
 
 #ifndef LOG_VERBOSE_ENABLED
@@ -575,6 +576,33 @@ TcpStream* Reactor::move_stream(TcpStream* newStream, TcpStream* oldStream) {
     return newStream;
 }
 
+Result Reactor::attach_tcpstream(uv_os_sock_t sock, TcpStream::Ptr& stream) {
+    TcpStream::Ptr newStream(new TcpStream());
+
+    ErrorCode errorCode = init_tcpstream(newStream.get());
+    if (errorCode != 0) {
+        close_socket(sock);
+        return make_unexpected(errorCode);
+    }
+
+    errorCode = (ErrorCode)uv_tcp_open((uv_tcp_t*)newStream->_handle, sock);
+    if (errorCode != 0) {
+        close_socket(sock);
+        return make_unexpected(errorCode);
+    }
+
+    stream = std::move(newStream);
+    return Ok();
+}
+
+void Reactor::close_socket(uv_os_sock_t sock) {
+#ifdef WIN32
+    closesocket(sock);
+#else // WIN32
+    close(sock);
+#endif // WIN32
+}
+
 ErrorCode Reactor::accept_tcpstream(Object* acceptor, Object* newConnection) {
     assert(acceptor->_handle);
 
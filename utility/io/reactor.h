@@ -82,6 +82,13 @@ public:
 
     void cancel_tcp_connect(uint64_t tag);
 
+    /// Creates a stream from the socket detached from another reactor (see TcpStream::detach_socket).
+    /// Must be called on this reactor's thread. The socket is closed on errors
+    Result attach_tcpstream(uv_os_sock_t sock, std::unique_ptr<TcpStream>& stream);
+
+    /// Closes the detached socket that wasn't attached
+    static void close_socket(uv_os_sock_t sock);
+
 	class Scope
 	{
 		Reactor* m_pPrev;
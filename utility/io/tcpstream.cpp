@@ -16,6 +16,10 @@
 #include "utility/config.h"
 #include "utility/helpers.h"
 #include <assert.h>
+#ifndef WIN32
+#include <unistd.h>
+#include <errno.h>
+#endif // WIN32
 
 #define LOG_DEBUG_ENABLED 0
 #include "utility/logger.h"
@@ -24,10 +28,13 @@ namespace beam { namespace io {
 
 TcpStream::TcpStream() :
     _onDataWritten(BIND_THIS_MEMFN(on_data_written))
-{}
+{
+    _maxWriteFragments = config().get_int("io.stream_write_max_fragments", 512, 16, 1024);
+}
 
 TcpStream::~TcpStream() {
     disable_read();
+    if (is_connected() && !_writeBuffer.empty()) issue_write(); // hand the coalesced data to the socket before it's closed
     if (_handle) _handle->data = 0;
 }
 
@@ -55,17 +62,6 @@ Result TcpStream::enable_read(const TcpStream::Callback& callback) {
 
     alloc_read_buffer();
 
-    static uv_alloc_cb read_alloc_cb = [](
-        uv_handle_t* handle,
-        size_t /*suggested_size*/,
-        uv_buf_t* buf
-    ) {
-        TcpStream* self = reinterpret_cast<TcpStream*>(handle->data);
-        if (self) {
-            *buf = self->_readBuffer;
-        }
-    };
-
     ErrorCode errorCode = (ErrorCode)uv_read_start((uv_stream_t*)_handle, read_alloc_cb, read_cb);
     if (errorCode != 0) {
         _callback = Callback();
@@ -77,6 +73,32 @@ Result TcpStream::enable_read(const TcpStream::Callback& callback) {
     return Ok();
 }
 
+void TcpStream::read_alloc_cb(uv_handle_t* handle, size_t /*suggested_size*/, uv_buf_t* buf) {
+    TcpStream* self = reinterpret_cast<TcpStream*>(handle->data);
+    if (self) {
+        *buf = self->_readBuffer;
+    }
+}
+
+void TcpStream::suspend_read() {
+    if (is_connected()) {
+        int errorCode = uv_read_stop((uv_stream_t*)_handle);
+        if (errorCode) {
+            LOG_DEBUG() << "uv_read_stop failed,code=" << errorCode;
+        }
+    }
+}
+
+Result TcpStream::resume_read() {
+    if (!is_connected()) return make_unexpected(EC_ENOTCONN);
+    if (!_callback) return make_unexpected(EC_EINVAL);
+
+    ErrorCode errorCode = (ErrorCode)uv_read_start((uv_stream_t*)_handle, read_alloc_cb, read_cb);
+    if (errorCode != 0) return make_unexpected(errorCode);
+
+    return Ok();
+}
+
 void TcpStream::disable_read() {
     _callback = Callback();
     if (is_connected()) {
@@ -91,6 +113,7 @@ void TcpStream::disable_read() {
 Result TcpStream::write(const SharedBuffer& buf, bool flush) {
     if (!is_connected()) return make_unexpected(EC_ENOTCONN);
     _writeBuffer.append(buf);
+    _state.unsent += buf.size;
     return do_write(flush);
 }
 
@@ -99,6 +122,7 @@ Result TcpStream::write(const SerializedMsg& fragments, bool flush) {
     if (!fragments.empty()) {
         for (const auto& f : fragments) {
             _writeBuffer.append(f);
+            _state.unsent += f.size;
         }
     }
     return do_write(flush);
@@ -114,7 +138,7 @@ Result TcpStream::write(const BufferChain& fragments, bool flush) {
 void TcpStream::shutdown() {
     if (is_connected()) {
         disable_read();
-        do_write(true);
+        if (!_writeBuffer.empty()) issue_write();
         _reactor->shutdown_tcpstream(this);
         assert(!_callback);
         assert(!is_connected());
@@ -128,28 +152,129 @@ void TcpStream::enable_keepalive(unsigned initialDelaySecs) {
 }
 
 Result TcpStream::do_write(bool flush) {
+    if (!flush || _writeBuffer.empty()) return Ok();
+
+    // While a write request is in progress the subsequent messages are accumulated, and sent in a single request once it completes
+    // (i.e. not later than the next loop iteration). This way many small messages end up in a single writev
+    if (_state.writes && (_writeBuffer.num_fragments() < _maxWriteFragments)) return Ok();
+
+    return issue_write();
+}
+
+Result TcpStream::issue_write() {
     size_t nBytes = _writeBuffer.size();
-    if (flush && nBytes > 0) {
-        ErrorCode ec = _reactor->async_write(this, _writeBuffer, _onDataWritten);
-        if (ec != EC_OK) {
-            LOG_DEBUG() << __FUNCTION__ << " " << error_str(ec);
-            return make_unexpected(ec);
-        }
-        _state.unsent += nBytes;
+    update_drain_rate(); // before the queue grows
+
+    ErrorCode ec = _reactor->async_write(this, _writeBuffer, _onDataWritten);
+    if (ec != EC_OK) {
+        LOG_DEBUG() << __FUNCTION__ << " " << error_str(ec);
+        _writeBuffer.clear();
+        assert(_state.unsent >= nBytes);
+        _state.unsent -= nBytes;
+        return make_unexpected(ec);
+    }
+    assert(_writeBuffer.empty());
+
+    _state.writes++;
+    _state.writeRequests++;
+    _writeTimes.push_back(uv_hrtime());
+
+    // whatever the socket didn't accept right away is queued. Only such data says something about the peer bandwidth
+    _drainQueued = uv_stream_get_write_queue_size((const uv_stream_t*)_handle);
+    if (_drainQueued && !_drainStart) {
+        _drainStart = _writeTimes.back();
+        _drainBytes = 0;
+        _drainMeasured = false;
     }
-    if (flush) assert(_writeBuffer.empty());
+
     return Ok();
 }
 
+void TcpStream::update_drain_rate() {
+    if (!_drainStart) return;
+
+    // the queue only shrinks between the writes
+    size_t nQueued = uv_stream_get_write_queue_size((const uv_stream_t*)_handle);
+    assert(nQueued <= _drainQueued);
+    _drainBytes += _drainQueued - nQueued;
+    _drainQueued = nQueued;
+
+    // wall time, the loop time may be stale by the whole (long) iteration
+    const uint64_t nWindow_ms = 50;
+    uint64_t now = uv_hrtime();
+    uint64_t dt_ms = (now - _drainStart) / 1000000;
+
+    if (dt_ms >= nWindow_ms) {
+        uint64_t nRate = _drainBytes * 1000 / dt_ms;
+        _state.drainRate = _state.drainRate ? (_state.drainRate * 3 + nRate) / 4 : nRate;
+        _drainMeasured = true;
+
+        _drainStart = nQueued ? now : 0;
+        _drainBytes = 0;
+    } else if (!nQueued) {
+        if (!_drainMeasured)
+            _state.drainRate = 0; // drained quickly
+        _drainStart = 0;
+    }
+}
+
 void TcpStream::on_data_written(ErrorCode errorCode, size_t n) {
+    // write requests complete in order
+    assert(_state.writes && !_writeTimes.empty());
+    _state.writes--;
+    uint64_t t0 = _writeTimes.front();
+    _writeTimes.pop_front();
+
     if (errorCode != EC_OK) {
         if (_callback) _callback(errorCode, 0, 0);
-    } else {
-        _state.sent += n;
-        assert(_state.unsent >= n);
-        _state.unsent -= n;
+        return; // the stream may be already deleted
+    }
+
+    _state.sent += n;
+    assert(_state.unsent >= n);
+    _state.unsent -= n;
+
+    uint64_t dt = (uv_hrtime() - t0) / 1000000;
+    _state.writeLatency_ms = (uint32_t) std::min(dt, uint64_t(uint32_t(-1)));
+
+    update_drain_rate();
+
+    LOG_DEBUG() << __FUNCTION__ << TRACE(n) << TRACE(_state.unsent) << TRACE(_state.sent) << TRACE(_state.received) << TRACE(dt);
+
+    if (!_writeBuffer.empty()) {
+        // send what was accumulated meanwhile
+        Result res = issue_write();
+        if (!res && _callback) _callback(res.error(), 0, 0);
     }
-    LOG_DEBUG() << __FUNCTION__ << TRACE(n) << TRACE(_state.unsent) << TRACE(_state.sent) << TRACE(_state.received);
+}
+
+Result TcpStream::detach_socket(uv_os_sock_t& sock) {
+    if (!is_connected()) return make_unexpected(EC_ENOTCONN);
+    assert(!_state.unsent && _writeBuffer.empty());
+
+    uv_os_fd_t fd;
+    ErrorCode errorCode = (ErrorCode)uv_fileno(_handle, &fd);
+    if (errorCode != 0) return make_unexpected(errorCode);
+
+    // the handle is bound to this reactor's loop (and on Windows - to its completion port), hence the socket is duplicated,
+    // and the original is closed along with the handle
+#ifdef WIN32
+    WSAPROTOCOL_INFOW pi;
+    if (WSADuplicateSocketW((SOCKET)fd, GetCurrentProcessId(), &pi))
+        return make_unexpected(ErrorCode(uv_translate_sys_error(WSAGetLastError())));
+
+    sock = WSASocketW(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, &pi, 0, WSA_FLAG_OVERLAPPED);
+    if (INVALID_SOCKET == sock)
+        return make_unexpected(ErrorCode(uv_translate_sys_error(WSAGetLastError())));
+#else // WIN32
+    sock = dup(fd);
+    if (sock < 0)
+        return make_unexpected(ErrorCode(uv_translate_sys_error(errno)));
+#endif // WIN32
+
+    disable_read();
+    async_close();
+    return Ok();
 }
 
 bool TcpStream::is_connected() const {
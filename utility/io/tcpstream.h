@@ -15,6 +15,7 @@
 #pragma once
 #include "reactor.h"
 #include "bufferchain.h"
+#include <deque>
 
 namespace beam { namespace io {
 
@@ -35,6 +36,10 @@ public:
         uint64_t received=0;
         uint64_t sent=0;
         size_t unsent=0;
+        uint32_t writes=0; // write requests in progress
+        uint64_t writeRequests=0; // write requests issued in total
+        uint32_t writeLatency_ms=0; // of the last completed write request, since it was issued
+        uint64_t drainRate=0; // bytes/sec, measured while the written data is queued (not accepted by the socket right away). 0 if it's drained quickly
     };
 
     ~TcpStream();
@@ -48,6 +53,12 @@ public:
     /// Disables listening to data and events
     void disable_read();
 
+    /// Stops reading temporarily, keeps the callback (hence can be called from within it)
+    void suspend_read();
+
+    /// Restarts reading after suspend_read()
+    Result resume_read();
+
     /// Writes raw data, returns status code
     Result write(const void* data, size_t size, bool flush=true) {
         return write(SharedBuffer(data, size), flush);
@@ -80,6 +91,10 @@ public:
     /// Enables tcp keep-alive
     void enable_keepalive(unsigned initialDelaySecs);
 
+    /// Detaches the socket, so that it could be attached to a stream of another reactor (possibly on another thread).
+    /// The stream becomes disconnected, the socket is owned by the caller. Must be called before anything is written.
+    Result detach_socket(uv_os_sock_t& sock);
+
 protected:
     TcpStream();
 
@@ -88,6 +103,7 @@ protected:
 
 private:
     static void read_cb(uv_stream_t* handle, ssize_t nread, const uv_buf_t* buf);
+    static void read_alloc_cb(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf);
 
     friend class TcpServer;
     friend class SslServer;
@@ -97,14 +113,26 @@ private:
     void alloc_read_buffer();
     void free_read_buffer();
 
-    // sends async write request if flush == true
+    // sends async write request if flush == true, unless it can be coalesced with the subsequent data
     Result do_write(bool flush);
 
+    // sends all the buffered data in a single write request
+    Result issue_write();
+
     // callback from write request
     void on_data_written(ErrorCode errorCode, size_t n);
 
+    // accounts for the queued data drained since the last call, updates the drain rate
+    void update_drain_rate();
+
     uv_buf_t _readBuffer={0, 0};
     BufferChain _writeBuffer;
+    std::deque<uint64_t> _writeTimes; // when the write requests in progress were issued (uv_hrtime)
+    size_t _drainQueued=0; // write queue size as of the last update_drain_rate()
+    uint64_t _drainStart=0; // uv_hrtime of the current measurement, 0 if nothing is queued
+    uint64_t _drainBytes=0; // drained since then
+    bool _drainMeasured=false; // the data remained queued for the whole measurement window at least once since it was queued
+    size_t _maxWriteFragments=0;
     Callback _callback;
     State _state;
     Reactor::OnDataWritten _onDataWritten;
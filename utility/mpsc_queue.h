@@ -0,0 +1,74 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <atomic>
+
+namespace beam
+{
+	// Lock-free intrusive multi-producer single-consumer queue. T must have a 'T* m_pNext' member.
+	// Producers push onto a singly-linked stack (CAS on the head). The consumer detaches the whole stack at once and reverses it,
+	// so that the order is FIFO per producer. Since the consumer never pops individual elements from the shared head - there's no ABA problem.
+	template <typename T>
+	class MpscQueue
+	{
+		std::atomic<T*> m_pHead;
+		T* m_pReady; // consumer-only, already in FIFO order
+
+	public:
+
+		MpscQueue()
+			:m_pHead(nullptr)
+			,m_pReady(nullptr)
+		{
+		}
+
+		// any thread. Returns true if the queue was empty, i.e. the consumer should be signaled
+		bool Push(T& x)
+		{
+			T* pHead = m_pHead.load(std::memory_order_relaxed);
+			do
+				x.m_pNext = pHead;
+			while (!m_pHead.compare_exchange_weak(pHead, &x, std::memory_order_release, std::memory_order_relaxed));
+
+			return !pHead;
+		}
+
+		// consumer thread only
+		T* Pop()
+		{
+			if (!m_pReady)
+			{
+				T* p = m_pHead.exchange(nullptr, std::memory_order_acquire);
+
+				// reverse
+				while (p)
+				{
+					T* pNext = p->m_pNext;
+					p->m_pNext = m_pReady;
+					m_pReady = p;
+					p = pNext;
+				}
+
+				if (!m_pReady)
+					return nullptr;
+			}
+
+			T* pRes = m_pReady;
+			m_pReady = pRes->m_pNext;
+			return pRes;
+		}
+	};
+
+} // namespace beam
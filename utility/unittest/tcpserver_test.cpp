@@ -78,6 +78,85 @@ void tcpserver_test() {
     }
 }
 
+// many small writes. They must arrive intact and in order, while the stream coalesces them if the socket is backed up
+const uint32_t nMsgs = 50000;
+const uint32_t nMsgSize = 100;
+TcpStream::Ptr serverStream, clientStream;
+uint64_t nReceived = 0;
+uint64_t nWriteRequests = 0;
+bool bDataValid = true;
+
+bool on_data_received(ErrorCode errorCode, void* data, size_t size) {
+    if (errorCode != EC_OK) {
+        LOG_ERROR() << "Error code=" << errorCode;
+        reactor->stop();
+        return false;
+    }
+
+    const uint8_t* p = (const uint8_t*) data;
+    for (size_t i = 0; i < size; i++, nReceived++) {
+        if (p[i] != (uint8_t) (nReceived / nMsgSize)) bDataValid = false;
+    }
+
+    if (nReceived == uint64_t(nMsgs) * nMsgSize) reactor->stop();
+    return true;
+}
+
+void tcpstream_writes_test() {
+    try {
+        reactor = Reactor::create();
+        Address addr(serverIp, serverPort + 1);
+
+        TcpServer::Ptr server = TcpServer::create(
+            *reactor,
+            addr,
+            [](TcpStream::Ptr&& newStream, int errorCode) {
+                if (errorCode == 0) {
+                    serverStream = std::move(newStream);
+                    serverStream->enable_read(on_data_received);
+                } else {
+                    LOG_ERROR() << "Error code=" << errorCode;
+                    reactor->stop();
+                }
+            }
+        );
+
+        reactor->tcp_connect(addr, 2, [](uint64_t, TcpStream::Ptr&& newStream, ErrorCode errorCode) {
+            if (errorCode != EC_OK) {
+                LOG_ERROR() << "Error code=" << errorCode;
+                reactor->stop();
+                return;
+            }
+
+            clientStream = std::move(newStream);
+
+            uint8_t pBuf[nMsgSize];
+            for (uint32_t i = 0; i < nMsgs; i++) {
+                memset(pBuf, (uint8_t) i, sizeof(pBuf));
+                if (!clientStream->write(pBuf, sizeof(pBuf))) bDataValid = false;
+            }
+
+            LOG_DEBUG() << "write requests in progress: " << clientStream->state().writes << ", unsent: " << clientStream->state().unsent;
+        }, 1000, false, false, Address(clientIp, 0));
+
+        timer = Timer::create(*reactor);
+        timer->start(10000, false, []() { reactor->stop(); });
+
+        reactor->run();
+
+        nWriteRequests = clientStream->state().writeRequests;
+        LOG_DEBUG() << "received " << nReceived << ", write requests: " << nWriteRequests;
+
+        timer.reset();
+        clientStream.reset();
+        serverStream.reset();
+    }
+    catch (const std::exception& e) {
+        LOG_ERROR() << e.what();
+        bDataValid = false;
+    }
+}
+
 int main() {
     int logLevel = LOG_LEVEL_DEBUG;
 #if LOG_VERBOSE_ENABLED
@@ -85,7 +164,11 @@ int main() {
 #endif
     auto logger = Logger::create(logLevel, logLevel);
     tcpserver_test();
-    return wasAccepted ? 0 : 1;
+    tcpstream_writes_test();
+
+    // the writes are coalesced: at most one request per io.stream_write_max_fragments (512 by default) messages, plus the flushes on completion
+    bool bWritesOk = bDataValid && (nReceived == uint64_t(nMsgs) * nMsgSize) && nWriteRequests && (nWriteRequests <= nMsgs / 256);
+    return (wasAccepted && bWritesOk) ? 0 : 1;
 }
 
 
@@ -60,29 +60,43 @@ void BbsMiner::Thread(uint32_t iThread)
         proto::Bbs::NonceType nonce = iThread;
         bool bSuccess = false;
 
-        for (uint32_t i = 0; ; i++)
+        // several nonces are tried at once, the finalization is batched (SIMD lanes)
+        const uint32_t nBatch = 8;
+        ECC::Hash::Processor pHp[nBatch];
+        ECC::Hash::Value pHv[nBatch];
+
+        for (uint32_t i = 0; !bSuccess; i++)
         {
             if (pTask->m_Done || m_Shutdown)
                 break;
 
-            if (!(i & 0xff))
+            if (!(i & 0x1f))
                 ts = getTimestamp();
 
             // attempt to mine it
-            ECC::Hash::Value hv;
-            ECC::Hash::Processor hp = pTask->m_hpPartial;
-            hp
-                << ts
-                << nonce
-                >> hv;
-
-            if (proto::Bbs::IsHashValid(hv))
+            proto::Bbs::NonceType pNonce[nBatch];
+            for (uint32_t j = 0; j < nBatch; j++)
             {
-                bSuccess = true;
-                break;
+                pNonce[j] = nonce;
+                nonce += nStep;
+
+                pHp[j] = pTask->m_hpPartial;
+                pHp[j]
+                    << ts
+                    << pNonce[j];
             }
 
-            nonce += nStep;
+            ECC::Hash::Processor::FinalizeMulti(pHp, pHv, nBatch);
+
+            for (uint32_t j = 0; j < nBatch; j++)
+            {
+                if (proto::Bbs::IsHashValid(pHv[j]))
+                {
+                    nonce = pNonce[j];
+                    bSuccess = true;
+                    break;
+                }
+            }
         }
 
         if (bSuccess)